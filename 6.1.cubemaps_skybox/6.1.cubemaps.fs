@@ -7,7 +7,6 @@ in vec3 FragPos;
 
 uniform sampler2D texture_diffuse1; // Model loader binds diffuse maps as this name
 uniform vec3 lightDir; // directional light direction (world space)
-uniform vec3 viewPos;
 
 void main()
 {
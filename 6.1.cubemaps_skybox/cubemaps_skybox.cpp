@@ -12,11 +12,21 @@
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
 
+#include "../common/fixed_step.h"
+#include "../common/asset_loader.h"
+#include "../common/frame_constants.h"
+#include "../common/input_replay.h"
+#include "../common/shader_reflect.h"
+
 #include <iostream>
+#include <memory>
+#include <string>
 #include <vector>
 #include <cmath>
 #include <cfloat> // FLT_MAX
 #include <algorithm>
+#include <chrono>
+#include <mutex>
 
 // compute normalization transform (center -> scale -> translate)
 glm::mat4 getNormalizationTransform(const Model& m, float targetSize, const glm::vec3& worldPos = glm::vec3(0.0f))
@@ -57,9 +67,11 @@ glm::mat4 getNormalizationTransform(const Model& m, float targetSize, const glm:
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
-void processInput(GLFWwindow* window);
-unsigned int loadTexture(const char* path);
-unsigned int loadCubemap(const std::vector<std::string>& faces);
+InputFrame pollInput(GLFWwindow* window);
+void processInput(const InputFrame& input);
+uint64_t carHash();
+unsigned int uploadTexture(const DecodedImage& image);
+unsigned int uploadCubemap(const DecodedImage* faces);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
@@ -70,24 +82,82 @@ Camera camera(glm::vec3(0.0f, 3.0f, 6.0f));
 float lastX = (float)SCR_WIDTH / 2.0;
 float lastY = (float)SCR_HEIGHT / 2.0;
 bool firstMouse = true;
+InputFrame pendingInput; // mouse and wheel movement gathered by the callbacks until the next poll
 
 // timing
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-// --- Car state (global so processInput can modify) ---
+// --- Car state (owned by the simulation thread once it runs) ---
 glm::vec3 carPosition(0.0f, 0.0f, 0.0f); // Y should match your model's ground
 float carRotation = 0.0f; // degrees around Y axis, 0 means +Z forward
 float carSpeed = 0.0f;
 
+// car controls, written by processInput and read by the simulation thread
+struct CarInput
+{
+    bool forward = false;
+    bool backward = false;
+    bool left = false;
+    bool right = false;
+};
+std::mutex carInputMutex;
+CarInput carInput; // guarded by carInputMutex
+
+// what the renderer needs from one simulation tick
+struct CarSnapshot
+{
+    glm::vec3 prevPosition = glm::vec3(0.0f);
+    glm::vec3 position = glm::vec3(0.0f);
+    float prevRotation = 0.0f;
+    float rotation = 0.0f;
+};
+
+const double SIM_STEP = 1.0 / 60.0; // fixed simulation tick
+void stepCar(const CarInput& input, float dt);
+
 const float MAX_SPEED = 15.0f;         // units per second
 const float ACCELERATION = 10.0f;      // units per second^2
 const float BRAKE = 12.0f;            // braking deceleration
 const float TURN_SPEED = 90.0f;       // degrees per second (steering rate)
 const float FRICTION = 4.0f;          // natural slow down
 
-int main()
+int main(int argc, char** argv)
 {
+    // --record FILE / --replay FILE [--headless]: see input_replay.h
+    const InputOptions inputOptions = parseInputOptions(argc, argv);
+    InputReplay replay;
+    InputRecorder recorder;
+    const bool replaying = !inputOptions.replayPath.empty();
+    if (replaying && !replay.Load(inputOptions.replayPath))
+        return -1;
+    if (!inputOptions.recordPath.empty() && !recorder.Open(inputOptions.recordPath, 0, (float)SIM_STEP))
+        return -1;
+    // a replay ticks the car by the log's step on the recorded timeline instead of on its own thread
+    const float replayStep = replay.Step() > 0.0f ? replay.Step() : (float)SIM_STEP;
+    unsigned long long replayTicks = 0;
+
+    // You might need to tune initial car position/scale depending on model origin/size:
+    carPosition = glm::vec3(112.0f, 26.5f, -120.0f);
+    carRotation = 180.0f; // face towards -Z or +Z depending on your model
+
+    // without a window: just the car and the follow camera's yaw and zoom
+    if (replaying && inputOptions.headless)
+    {
+        FrameTimeStats stats;
+        InputFrame input;
+        while (replay.Next(input))
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            processInput(input);
+            for (unsigned int n = replayStepsDue(input.time, replayStep, replayTicks); n > 0; --n, ++replayTicks)
+                stepCar(carInput, replayStep);
+            stats.Add(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+        }
+        stats.Print(carHash());
+        return 0;
+    }
+
     // glfw init
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -124,6 +194,10 @@ int main()
     // shaders (use your existing shader files or model loading shaders)
     Shader shader("6.1.cubemaps.vs", "6.1.cubemaps.fs");       // use a shader that supports textures and basic lighting
     Shader skyboxShader("6.1.skybox.vs", "6.1.skybox.fs");
+    // camera matrices reach both programs through one buffer, written once per frame
+    FrameConstantsBuffer frameConstants;
+    frameConstants.Attach(shader.ID);
+    frameConstants.Attach(skyboxShader.ID);
 
     // --- (keep your cube and skybox vertex data) ---
     float cubeVertices[] = {
@@ -240,9 +314,8 @@ int main()
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glBindVertexArray(0);
 
-    // load textures
-    unsigned int cubeTexture = loadTexture(FileSystem::getPath("resources/textures/container.jpg").c_str());
-
+    // load textures and models as a job graph: images decode on worker
+    // threads, GL uploads and the models (which need GL) run on this one
     std::vector<std::string> faces
     {
         FileSystem::getPath("resources/textures/skybox/right.jpg"),
@@ -252,47 +325,115 @@ int main()
         FileSystem::getPath("resources/textures/skybox/front.jpg"),
         FileSystem::getPath("resources/textures/skybox/back.jpg")
     };
-    stbi_set_flip_vertically_on_load(false);
-    unsigned int cubemapTexture = loadCubemap(faces);
-    stbi_set_flip_vertically_on_load(true);
+    DecodedImage cubeImage;
+    DecodedImage faceImages[6];
+    unsigned int cubeTexture = 0;
+    unsigned int cubemapTexture = 0;
+    std::unique_ptr<Model> city, car;
+
+    AssetLoader loader;
+    loader.OnProgress([&](int done, int total, const std::string& name) {
+        std::string title = "Loading " + std::to_string(done) + "/" + std::to_string(total) + ": " + name;
+        glfwSetWindowTitle(window, title.c_str());
+    });
+    loader.Add("container.jpg",
+        [&]() { return decodeImage(FileSystem::getPath("resources/textures/container.jpg"), cubeImage); },
+        [&]() { cubeTexture = uploadTexture(cubeImage); freeImage(cubeImage); return true; });
+    // cubemap faces are stored top row first, the opposite of the flip set above
+    std::vector<int> faceJobs;
+    for (int i = 0; i < 6; ++i)
+        faceJobs.push_back(loader.Add(faces[i].substr(faces[i].find_last_of("/\\") + 1),
+            [&, i]() { return decodeImage(faces[i], faceImages[i], true); }, nullptr));
+    loader.Add("skybox", nullptr, [&]() {
+        cubemapTexture = uploadCubemap(faceImages);
+        for (DecodedImage& face : faceImages)
+            freeImage(face);
+        return true;
+    }, faceJobs);
+    // Ensure these paths match your resources layout.
+    loader.Add("city.obj", nullptr, [&]() { city.reset(new Model(FileSystem::getPath("resources/objects/city/city.obj"))); return true; });
+    loader.Add("car.obj", nullptr, [&]() { car.reset(new Model(FileSystem::getPath("resources/objects/car/car.obj"))); return true; });
+
+    if (!loader.Run())
+    {
+        glfwTerminate();
+        return -1;
+    }
+    loader.PrintTimings();
+    glfwSetWindowTitle(window, "Driving Demo");
 
     shader.use();
     shader.setInt("texture1", 0);
+    // per-draw uniforms go through reflected handles instead of name lookups
+    ReflectedShader reflected(shader.ID);
+    Uniform<glm::mat4> modelU = reflected.Find<glm::mat4>("model");
+    ModelSamplers samplers;
+    samplers.Find(reflected);
 
     skyboxShader.use();
     skyboxShader.setInt("skybox", 0);
 
-    // --- Load models (car & city) ---
-    // Ensure these paths match your resources layout.
-    Model city(FileSystem::getPath("resources/objects/city/city.obj"));
-    Model car(FileSystem::getPath("resources/objects/car/car.obj"));
-    glm::mat4 cityBase = getNormalizationTransform(city, 200.0f, glm::vec3(0.0f));    // city scaled to ~200 units
-    glm::mat4 carBase = getNormalizationTransform(car, 10.0f, glm::vec3(0.0f));
+    // --- Place models (car & city) ---
+    glm::mat4 cityBase = getNormalizationTransform(*city, 200.0f, glm::vec3(0.0f));    // city scaled to ~200 units
+    glm::mat4 carBase = getNormalizationTransform(*car, 10.0f, glm::vec3(0.0f));
 
-    // You might need to tune initial car position/scale depending on model origin/size:
-    carPosition = glm::vec3(112.0f, 26.5f, -120.0f);
-    carRotation = 180.0f; // face towards -Z or +Z depending on your model
+    // car physics runs at a fixed rate on its own thread
+    SnapshotExchange<CarSnapshot> snapshots;
+    snapshots.WriteSlot() = CarSnapshot{ carPosition, carPosition, carRotation, carRotation };
+    snapshots.Publish();
+    snapshots.Acquire();
+
+    auto tick = [&](float dt) {
+        CarInput input;
+        {
+            std::lock_guard<std::mutex> lock(carInputMutex);
+            input = carInput;
+        }
+        CarSnapshot& snap = snapshots.WriteSlot();
+        snap.prevPosition = carPosition;
+        snap.prevRotation = carRotation;
+        stepCar(input, dt);
+        snap.position = carPosition;
+        snap.rotation = carRotation;
+        snapshots.Publish();
+    };
+    FixedStepThread simThread(SIM_STEP, tick);
+    if (!replaying)
+        simThread.Start();
 
     // render loop
+    FrameTimeStats replayStats;
+    unsigned long long frames = 0;
+    uniformStats().Reset();
+    auto frameStart = std::chrono::steady_clock::now();
     while (!glfwWindowShouldClose(window))
     {
+        // input, live or from the log
+        InputFrame input;
+        if (!replaying)
+            input = pollInput(window);
+        else if (!replay.Next(input))
+            break;
+        recorder.Record(input);
+
         // per-frame time logic
-        float currentFrame = static_cast<float>(glfwGetTime());
+        float currentFrame = input.time;
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
-        // input
-        processInput(window);
+        processInput(input);
+        if (replaying)
+            for (unsigned int n = replayStepsDue(input.time, replayStep, replayTicks); n > 0; --n, ++replayTicks)
+                tick(replayStep);
 
-        // simple friction
-        if (fabs(carSpeed) > 0.01f)
-        {
-            float sign = (carSpeed > 0.0f) ? 1.0f : -1.0f;
-            carSpeed -= sign * FRICTION * deltaTime;
-            if (sign > 0.0f && carSpeed < 0.0f) carSpeed = 0.0f;
-            if (sign < 0.0f && carSpeed > 0.0f) carSpeed = 0.0f;
-        }
-        else carSpeed = 0.0f;
+        // car pose between the last two simulation ticks
+        snapshots.Acquire();
+        const CarSnapshot& snap = snapshots.ReadSlot();
+        const float alpha = replaying
+            ? glm::clamp((input.time - replayTicks * replayStep) / replayStep, 0.0f, 1.0f)
+            : snapshots.InterpolationAlpha(simThread.StepSeconds());
+        const glm::vec3 renderCarPosition = glm::mix(snap.prevPosition, snap.position, alpha);
+        const float renderCarRotation = snap.prevRotation + (snap.rotation - snap.prevRotation) * alpha;
 
         // update camera to follow the car (third-person)
         const float camDistance = 22.0f;
@@ -309,41 +450,36 @@ int main()
         camDir.z = cos(pitchRad) * cos(yawRad);
 
         // place the camera behind the car along the direction (offset origin to car position)
-        camera.Position = carPosition - camDir * camDistance + glm::vec3(0.0f, camHeight, 0.0f);
+        camera.Position = renderCarPosition - camDir * camDistance + glm::vec3(0.0f, camHeight, 0.0f);
 
         // Ensure the camera looks at the car  this sets the view but does not override yaw/pitch values
-        camera.Front = glm::normalize(carPosition - camera.Position);
+        camera.Front = glm::normalize(renderCarPosition - camera.Position);
         // render
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // set common matrices
-        shader.use();
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 1000.0f);
         glm::mat4 view = camera.GetViewMatrix();
-        shader.setMat4("view", view);
-        shader.setMat4("projection", projection);
+        frameConstants.Update(view, projection, camera.Position, currentFrame);
+        shader.use();
 
         // --- Draw city ---
         glm::mat4 model = cityBase; // already includes scale & recenter
-        shader.setMat4("model", model);
-        city.Draw(shader);
+        reflected.Set(modelU, model);
+        drawModel(*city, reflected, samplers);
 
         // --- Draw car (nanosuit) at carPosition with rotation and the carBase normalization ---
         model = glm::mat4(1.0f);
-        model = glm::translate(model, carPosition);
-        model = glm::rotate(model, glm::radians(carRotation), glm::vec3(0.0f, 1.0f, 0.0f));
+        model = glm::translate(model, renderCarPosition);
+        model = glm::rotate(model, glm::radians(renderCarRotation), glm::vec3(0.0f, 1.0f, 0.0f));
         model = model * carBase; // apply normalization after translation/rotation so it's aligned correctly
-        shader.setMat4("model", model);
-        car.Draw(shader);
+        reflected.Set(modelU, model);
+        drawModel(*car, reflected, samplers);
 
         // --- Draw skybox last ---
         glDepthFunc(GL_LEQUAL);
-        skyboxShader.use();
-        // remove translation from view for skybox
-        glm::mat4 skyboxView = glm::mat4(glm::mat3(camera.GetViewMatrix()));
-        skyboxShader.setMat4("view", skyboxView);
-        skyboxShader.setMat4("projection", projection);
+        skyboxShader.use(); // drops the view's translation itself
 
         glBindVertexArray(skyboxVAO);
         glActiveTexture(GL_TEXTURE0);
@@ -354,8 +490,20 @@ int main()
 
         glfwSwapBuffers(window);
         glfwPollEvents();
+
+        auto frameEnd = std::chrono::steady_clock::now();
+        if (replaying)
+            replayStats.Add(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+        frameStart = frameEnd;
+        ++frames;
     }
 
+    simThread.Stop();
+    uniformStats().Print(frames);
+    if (replaying)
+        replayStats.Print(carHash());
+    recorder.Close();
+
     // cleanup
     glDeleteVertexArrays(1, &cubeVAO);
     glDeleteVertexArrays(1, &skyboxVAO);
@@ -366,28 +514,77 @@ int main()
     return 0;
 }
 
-// process input -> car control (W/S to accelerate/brake, A/D to steer)
-void processInput(GLFWwindow* window)
+// this frame's keys plus the mouse movement gathered since the last poll
+InputFrame pollInput(GLFWwindow* window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
+    InputFrame input = pendingInput;
+    pendingInput = InputFrame();
+    input.time = static_cast<float>(glfwGetTime());
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) input.keys |= INPUT_KEY_W;
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) input.keys |= INPUT_KEY_S;
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) input.keys |= INPUT_KEY_A;
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) input.keys |= INPUT_KEY_D;
+    return input;
+}
+
+// input -> car control (W/S to accelerate/brake, A/D to steer) and follow camera
+void processInput(const InputFrame& frame)
+{
     // acceleration/brake
-    bool forward = glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS;
-    bool backward = glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS;
-    bool left = glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS;
-    bool right = glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS;
+    CarInput input;
+    input.forward = (frame.keys & INPUT_KEY_W) != 0;
+    input.backward = (frame.keys & INPUT_KEY_S) != 0;
+    input.left = (frame.keys & INPUT_KEY_A) != 0;
+    input.right = (frame.keys & INPUT_KEY_D) != 0;
+    {
+        std::lock_guard<std::mutex> lock(carInputMutex);
+        carInput = input;
+    }
 
+    if (frame.mouseX != 0.0f)
+    {
+        // only allow horizontal rotation (yaw), no pitch
+        const float sensitivity = 0.1f;
+        camera.Yaw += frame.mouseX * sensitivity;
+
+        // update camera Front vector manually since we're not using ProcessMouseMovement
+        glm::vec3 front;
+        front.x = cos(glm::radians(camera.Pitch)) * cos(glm::radians(camera.Yaw));
+        front.y = sin(glm::radians(camera.Pitch));   // pitch stays fixed
+        front.z = cos(glm::radians(camera.Pitch)) * sin(glm::radians(camera.Yaw));
+        camera.Front = glm::normalize(front);
+    }
+    if (frame.scroll != 0.0f)
+        camera.ProcessMouseScroll(frame.scroll);
+}
+
+uint64_t carHash()
+{
+    StateHash hash;
+    hash.Add(carPosition);
+    hash.Add(carRotation);
+    hash.Add(carSpeed);
+    hash.Add(camera.Yaw);
+    hash.Add(camera.Zoom);
+    return hash.Value();
+}
+
+// one fixed simulation tick of the car (called from the simulation thread)
+void stepCar(const CarInput& input, float dt)
+{
     // accelerate / brake
-    if (forward)
+    if (input.forward)
     {
-        carSpeed += ACCELERATION * deltaTime;
+        carSpeed += ACCELERATION * dt;
     }
-    else if (backward)
+    else if (input.backward)
     {
         // if moving forward, stronger braking
-        if (carSpeed > 0.0f) carSpeed -= BRAKE * deltaTime;
-        else carSpeed -= ACCELERATION * deltaTime;
+        if (carSpeed > 0.0f) carSpeed -= BRAKE * dt;
+        else carSpeed -= ACCELERATION * dt;
     }
 
     // clamp speed
@@ -396,32 +593,42 @@ void processInput(GLFWwindow* window)
 
     // steering - steering effectiveness depends on speed sign
     float steerDirection = 0.0f;
-    if (left) steerDirection = 1.0f;
-    if (right) steerDirection = -1.0f;
+    if (input.left) steerDirection = 1.0f;
+    if (input.right) steerDirection = -1.0f;
 
     if (fabs(carSpeed) > 0.01f)
     {
         // steering scaled by speed magnitude (faster -> more effective steering)
         float steer = TURN_SPEED * (carSpeed / MAX_SPEED) * steerDirection;
-        carRotation += steer * deltaTime;
+        carRotation += steer * dt;
     }
     else
     {
         // when stopped: allow slow in-place turning so player can orient car while idle
         const float INPLACE_FACTOR = 0.6f; // tweak (0.0 .. 1.0)
-        carRotation += TURN_SPEED * INPLACE_FACTOR * steerDirection * deltaTime;
+        carRotation += TURN_SPEED * INPLACE_FACTOR * steerDirection * dt;
     }
 
 
     // move car forward in its facing direction
     float rad = glm::radians(carRotation);
     glm::vec3 forwardVec = glm::vec3(sin(rad), 0.0f, cos(rad));
-    carPosition += forwardVec * carSpeed * deltaTime;
+    carPosition += forwardVec * carSpeed * dt;
 
     // simple boundary clamp to keep car inside some area (tweak as needed)
     float BOUND = 500.0f;
     carPosition.x = glm::clamp(carPosition.x, -BOUND, BOUND);
     carPosition.z = glm::clamp(carPosition.z, -BOUND, BOUND);
+
+    // simple friction
+    if (fabs(carSpeed) > 0.01f)
+    {
+        float sign = (carSpeed > 0.0f) ? 1.0f : -1.0f;
+        carSpeed -= sign * FRICTION * dt;
+        if (sign > 0.0f && carSpeed < 0.0f) carSpeed = 0.0f;
+        if (sign < 0.0f && carSpeed > 0.0f) carSpeed = 0.0f;
+    }
+    else carSpeed = 0.0f;
 }
 
 // callbacks
@@ -443,90 +650,52 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
         firstMouse = false;
     }
 
-    float xoffset = xpos - lastX;
+    // only horizontal movement is used (yaw), see processInput
+    pendingInput.mouseX += xpos - lastX;
     lastX = xpos;
-
-    // only allow horizontal rotation (yaw), no pitch
-    const float sensitivity = 0.1f;
-    xoffset *= sensitivity;
-
-    camera.Yaw += xoffset;
-
-    // update camera Front vector manually since we're not using ProcessMouseMovement
-    glm::vec3 front;
-    front.x = cos(glm::radians(camera.Pitch)) * cos(glm::radians(camera.Yaw));
-    front.y = sin(glm::radians(camera.Pitch));   // pitch stays fixed
-    front.z = cos(glm::radians(camera.Pitch)) * sin(glm::radians(camera.Yaw));
-    camera.Front = glm::normalize(front);
 }
 
 
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
-    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+    pendingInput.scroll += static_cast<float>(yoffset);
 }
 
-// texture loader
-unsigned int loadTexture(const char* path)
+// create a mipmapped, repeating 2D texture from a decoded image
+unsigned int uploadTexture(const DecodedImage& image)
 {
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format = GL_RGB;
-        if (nrComponents == 1) format = GL_RED;
-        else if (nrComponents == 3) format = GL_RGB;
-        else if (nrComponents == 4) format = GL_RGBA;
+    if (!image.pixels)
+        return textureID; // failed to decode (already logged); left without storage
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+    GLenum format = imageFormat(image);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels);
+    glGenerateMipmap(GL_TEXTURE_2D);
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
     return textureID;
 }
 
-// cubemap loader (robust to 3 or 4 channels)
-unsigned int loadCubemap(const std::vector<std::string>& faces)
+// cubemap from six decoded faces in +X, -X, +Y, -Y, +Z, -Z order (robust to 3 or 4 channels)
+unsigned int uploadCubemap(const DecodedImage* faces)
 {
     unsigned int textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < faces.size(); i++)
+    for (unsigned int i = 0; i < 6; i++)
     {
-        unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data)
-        {
-            GLenum format = GL_RGB;
-            if (nrChannels == 1) format = GL_RED;
-            else if (nrChannels == 3) format = GL_RGB;
-            else if (nrChannels == 4) format = GL_RGBA;
-
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
-        }
-        else
-        {
-            std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
-        }
+        if (!faces[i].pixels)
+            continue; // failed to decode (already logged)
+        GLenum format = imageFormat(faces[i]);
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, format, faces[i].width, faces[i].height, 0, format, GL_UNSIGNED_BYTE, faces[i].pixels);
     }
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
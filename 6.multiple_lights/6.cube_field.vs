@@ -0,0 +1,37 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;      // cube vertex position
+layout (location = 1) in vec3 aNormal;   // cube normal (object space)
+layout (location = 2) in vec2 aTexCoords;
+
+// per-instance animated centre, written once per frame by 6.instance_update.vs
+layout (location = 3) in vec3 aInstPos;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+flat out vec3 InstOffset; // pass to fragment shader for color mapping
+
+// per-frame constants from common/frame_constants.h; this stage reads viewProjection
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 cameraPosition;
+    float time;
+};
+
+uniform float baseScale;  // uniform scale of cubes
+
+void main()
+{
+    // model = translate(aInstPos) * scale(baseScale); with a uniform scale the
+    // normal matrix is the identity up to a factor, so normals pass through
+    FragPos = aInstPos + baseScale * aPos;
+    Normal = aNormal;
+    TexCoords = aTexCoords;
+    InstOffset = aInstPos;
+
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
+}
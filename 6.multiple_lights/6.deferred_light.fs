@@ -0,0 +1,80 @@
+#version 330 core
+// Lighting pass of the deferred path: directional light, camera spotlight and
+// the ambient floor, once per covered pixel. Point lights are added on top by
+// 6.light_volume.fs.
+out vec4 FragColor;
+
+struct DirLight { vec3 direction; vec3 ambient; vec3 diffuse; vec3 specular; };
+struct SpotLight {
+    vec3 position; vec3 direction; float cutOff; float outerCutOff;
+    float constant; float linear; float quadratic;
+    vec3 ambient; vec3 diffuse; vec3 specular;
+};
+
+// per-frame constants from common/frame_constants.h; this stage reads cameraPosition
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 cameraPosition;
+    float time;
+};
+uniform DirLight dirLight;
+uniform SpotLight spotLight;
+uniform float material_shininess;
+
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedo;
+
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 baseColor);
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 baseColor);
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec4 albedo = texelFetch(gAlbedo, pixel, 0);
+    if (albedo.a == 0.0)
+        discard; // background keeps the clear colour
+    vec3 fragPos = texelFetch(gPosition, pixel, 0).xyz;
+    vec3 norm = texelFetch(gNormal, pixel, 0).xyz;
+    vec3 viewDir = normalize(cameraPosition - fragPos);
+    vec3 baseColor = albedo.rgb;
+
+    vec3 result = CalcDirLight(dirLight, norm, viewDir, baseColor);
+    result += CalcSpotLight(spotLight, norm, fragPos, viewDir, baseColor);
+    FragColor = vec4(clamp(result + 0.04 * baseColor, 0.0, 1.0), 1.0);
+}
+
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 baseColor)
+{
+    vec3 lightDir = normalize(-light.direction);
+    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material_shininess);
+    vec3 ambient = light.ambient * baseColor;
+    vec3 diffuse = light.diffuse * diff * baseColor;
+    vec3 specularColor = 0.18 * baseColor + 0.22; // small tint toward baseColor, keep some neutral
+    vec3 specular = light.specular * spec * specularColor;
+    return ambient + diffuse + specular;
+}
+
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 baseColor)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material_shininess);
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    float theta = dot(lightDir, normalize(-light.direction));
+    float epsilon = light.cutOff - light.outerCutOff;
+    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+    vec3 ambient = light.ambient * baseColor;
+    vec3 diffuse = light.diffuse * diff * baseColor;
+    vec3 specularColor = 0.18 * baseColor + 0.22;
+    vec3 specular = light.specular * spec * specularColor;
+    ambient *= attenuation * intensity; diffuse *= attenuation * intensity; specular *= attenuation * intensity;
+    return ambient + diffuse + specular;
+}
@@ -0,0 +1,31 @@
+#version 330 core
+// Geometry pass of the deferred path: the cube field's surface attributes,
+// lit later by 6.deferred_light.fs and 6.light_volume.fs.
+layout (location = 0) out vec4 gPosition; // world position
+layout (location = 1) out vec4 gNormal;   // world normal
+layout (location = 2) out vec4 gAlbedo;   // base colour, alpha 1 where there is geometry
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+flat in vec3 InstOffset;
+
+// same colour mapping as 6.multiple_lights.fs
+vec3 hsv2rgb(vec3 c)
+{
+    vec3 rgb = clamp( abs(mod(c.x*6.0 + vec3(0.0,4.0,2.0), 6.0) - 3.0) - 1.0, 0.0, 1.0 );
+    rgb = rgb*rgb*(3.0 - 2.0*rgb);
+    return c.z * mix(vec3(1.0), rgb, c.y);
+}
+
+void main()
+{
+    float height = InstOffset.y;
+    float hue = fract(0.12 * InstOffset.x + 0.08 * InstOffset.z + 0.07 * height + 0.35);
+    float sat = clamp(0.5 + 0.6 * height, 0.15, 1.0);
+    float val = clamp(0.6 + 0.5 * sin(2.1 * height + InstOffset.x * 0.2), 0.2, 1.0);
+
+    gPosition = vec4(FragPos, 1.0);
+    gNormal = vec4(normalize(Normal), 0.0);
+    gAlbedo = vec4(hsv2rgb(vec3(hue, sat, val)), 1.0);
+}
@@ -0,0 +1,33 @@
+#version 330 core
+// Forward shading of the far cubes (6.impostor.vs): the cube colour under the
+// directional light's ambient and diffuse only. Specular, point lights and
+// the spotlight are left out; at this distance a cube is a few pixels.
+out vec4 FragColor;
+
+struct DirLight { vec3 direction; vec3 ambient; vec3 diffuse; vec3 specular; };
+
+in vec3 Normal;
+flat in vec3 InstOffset;
+
+uniform DirLight dirLight;
+
+// same colour mapping as 6.multiple_lights.fs
+vec3 hsv2rgb(vec3 c)
+{
+    vec3 rgb = clamp( abs(mod(c.x*6.0 + vec3(0.0,4.0,2.0), 6.0) - 3.0) - 1.0, 0.0, 1.0 );
+    rgb = rgb*rgb*(3.0 - 2.0*rgb);
+    return c.z * mix(vec3(1.0), rgb, c.y);
+}
+
+void main()
+{
+    float height = InstOffset.y;
+    float hue = fract(0.12 * InstOffset.x + 0.08 * InstOffset.z + 0.07 * height + 0.35);
+    float sat = clamp(0.5 + 0.6 * height, 0.15, 1.0);
+    float val = clamp(0.6 + 0.5 * sin(2.1 * height + InstOffset.x * 0.2), 0.2, 1.0);
+    vec3 baseColor = hsv2rgb(vec3(hue, sat, val));
+
+    float diff = max(dot(Normal, normalize(-dirLight.direction)), 0.0);
+    vec3 result = (dirLight.ambient + dirLight.diffuse * diff) * baseColor;
+    FragColor = vec4(clamp(result + 0.04 * baseColor, 0.0, 1.0), 1.0);
+}
@@ -0,0 +1,35 @@
+#version 330 core
+// Far level of detail of the cube field: one point sprite per cube instead of
+// its 36 vertices, sized to the cube's projected width. Reads the centres the
+// instance pass wrote; feeds 6.impostor.fs (forward) or 6.gbuffer.fs (deferred).
+layout (location = 0) in vec3 aInstPos; // animated cube centre
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+flat out vec3 InstOffset; // same colour mapping as the cube meshes
+
+// per-frame constants from common/frame_constants.h; this stage reads projection and viewProjection
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 cameraPosition;
+    float time;
+};
+
+uniform float baseScale;      // cube size
+uniform float viewportHeight; // framebuffer height in pixels
+
+void main()
+{
+    FragPos = aInstPos;
+    Normal = vec3(0.0, 1.0, 0.0); // from afar the tops are what shows
+    TexCoords = vec2(0.5);
+    InstOffset = aInstPos;
+
+    gl_Position = viewProjection * vec4(aInstPos, 1.0);
+    // projection[1][1] / w turns a world size at this depth into NDC, half the viewport per NDC unit
+    gl_PointSize = max(baseScale * projection[1][1] / gl_Position.w * 0.5 * viewportHeight, 1.0);
+}
@@ -0,0 +1,42 @@
+#version 330 core
+// Culling stage of the instance pass: passes a cube's animated centre on
+// only when its box touches the view frustum and its distance from the
+// camera falls in the pass's level-of-detail range. Transform feedback packs
+// the survivors, so the output is the visible-instance buffer for the draw.
+layout (points) in;
+layout (points, max_vertices = 1) out;
+
+in vec3 InstancePosition[];  // from 6.instance_update.vs, or 6.instance_passthrough.vs over its output
+out vec3 VisiblePosition;
+
+// per-frame constants from common/frame_constants.h; this stage reads cameraPosition
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 cameraPosition;
+    float time;
+};
+
+uniform vec4 frustumPlanes[6]; // xyz = inward normal, w = distance (common/frustum.h)
+uniform float baseScale;       // cube size, half of it is the box extent
+uniform vec2 lodRange;         // kept distances from the camera: [x, y)
+
+void main()
+{
+    vec3 center = InstancePosition[0];
+    float distance = length(center - cameraPosition);
+    if (distance < lodRange.x || distance >= lodRange.y)
+        return;
+    vec3 extent = vec3(0.5 * baseScale);
+    for (int i = 0; i < 6; ++i)
+    {
+        vec4 p = frustumPlanes[i];
+        if (dot(p.xyz, center) + p.w < -dot(abs(p.xyz), extent))
+            return;
+    }
+    VisiblePosition = center;
+    EmitVertex();
+    EndPrimitive();
+}
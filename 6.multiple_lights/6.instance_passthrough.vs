@@ -0,0 +1,12 @@
+#version 330 core
+// Hands centres the instance pass has already animated (6.instance_update.vs,
+// captured by InstanceAnimator) to 6.instance_cull.gs unchanged, so a culling
+// pass can run again over them without evaluating the wave a second time.
+layout (location = 0) in vec3 aCenter;
+
+out vec3 InstancePosition; // as 6.instance_update.vs names it
+
+void main()
+{
+    InstancePosition = aCenter;
+}
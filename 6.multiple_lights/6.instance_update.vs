@@ -0,0 +1,71 @@
+#version 330 core
+// Per-instance animation pass: one vertex per cube, captured with transform
+// feedback (nothing is rasterised). Evaluates the layered wave once per cube
+// per frame; 6.cube_field.vs then only offsets and scales the 36 vertices.
+
+// per-instance packed vec4: x = offsetX, y = offsetZ, z = phase, w = distFromCenter
+// (not bound when proceduralInstances is set)
+layout (location = 0) in vec4 aInst;
+
+out vec3 InstancePosition; // animated cube centre
+
+// per-frame constants from common/frame_constants.h; this stage reads time
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 cameraPosition;
+    float time;
+};
+
+// animation uniforms
+uniform float timeScale;  // animation speed, applied to the frame time
+uniform float amplitude;  // global amplitude
+uniform float freq;       // primary freq
+uniform float freq2;      // secondary freq
+uniform float rippleFreq; // radial ripple freq
+uniform float heightPow;  // exponent to smooth peaks
+
+// procedural instancing: with no instance buffer the inputs are rebuilt from
+// the vertex index (one point per cube), row by row, as buildCubeFieldInstances computes them
+uniform bool proceduralInstances;
+uniform int gridSide;   // cubes per grid row
+uniform float spacing;  // distance between cubes
+
+// Twin of proceduralInputs in 6.multiple_lights.vs: GLSL 3.30 has no
+// #include, so a change here has to be made there too (and in
+// buildCubeFieldInstances, which fills the buffer this replaces).
+vec4 proceduralInputs(int index)
+{
+    float x = float(index % gridSide);
+    float z = float(index / gridSide);
+    float ox = (x - float(gridSide) / 2.0) * spacing;
+    float oz = (z - float(gridSide) / 2.0) * spacing;
+    return vec4(ox, oz, (x * 0.7 + z * 1.3) * 0.6, sqrt(ox * ox + oz * oz));
+}
+
+void main()
+{
+    vec4 inst = proceduralInstances ? proceduralInputs(gl_VertexID) : aInst;
+    float ox = inst.x;
+    float oz = inst.y;
+    float phase = inst.z;
+    float dist = inst.w;
+    float t = time * timeScale;
+
+    // layered mathy motion (the same wave as 6.multiple_lights.vs; keep both,
+    // and MAX_WAVE_HEIGHT in multiple_lights.cpp, in sync):
+    float y1 = sin(t * 1.0 + phase * freq) * 0.95;
+    float y2 = sin(t * 0.6 + (ox * 0.9 + oz * 1.1) * freq2 + phase * 0.8) * 0.6;
+    float ripple = sin(t * 1.3 - dist * rippleFreq) * 0.55;
+    float lissa = 0.15 * sin(1.2 * t + 0.9 * ox + 1.7 * oz);
+
+    float raw = (y1 + y2 + ripple) * 0.6 + lissa;
+    float h = raw * amplitude;
+
+    // soften peaks:
+    h = sign(h) * pow(abs(h), heightPow);
+
+    InstancePosition = vec3(ox, h, oz);
+}
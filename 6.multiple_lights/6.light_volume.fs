@@ -0,0 +1,53 @@
+#version 330 core
+// Point-light pass of the deferred path: runs only on the pixels a light's
+// volume covers and is added onto the lighting pass (additive blending).
+out vec4 FragColor;
+
+flat in int LightIndex;
+
+// per-frame constants from common/frame_constants.h; this stage reads cameraPosition
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 cameraPosition;
+    float time;
+};
+uniform float material_shininess;
+uniform samplerBuffer lightData; // 2 texels per light: position + radius, colour + specular
+
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedo;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec4 albedo = texelFetch(gAlbedo, pixel, 0);
+    if (albedo.a == 0.0)
+        discard;
+    vec3 fragPos = texelFetch(gPosition, pixel, 0).xyz;
+    vec4 positionRadius = texelFetch(lightData, 2 * LightIndex);
+    vec3 toLight = positionRadius.xyz - fragPos;
+    float d2 = dot(toLight, toLight) / (positionRadius.w * positionRadius.w);
+    if (d2 >= 1.0)
+        discard; // inside the volume's screen area but out of the light's reach
+
+    // same model as CalcPointLight in 6.multiple_lights.fs
+    vec4 colorSpecular = texelFetch(lightData, 2 * LightIndex + 1);
+    vec3 normal = texelFetch(gNormal, pixel, 0).xyz;
+    vec3 baseColor = albedo.rgb;
+    vec3 viewDir = normalize(cameraPosition - fragPos);
+    vec3 lightDir = normalize(toLight);
+    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material_shininess);
+    float window = 1.0 - d2;
+    float attenuation = window * window / (1.0 + 4.0 * d2);
+    vec3 ambient = 0.02 * colorSpecular.rgb * baseColor;
+    vec3 diffuse = colorSpecular.rgb * diff * baseColor;
+    vec3 specularColor = 0.18 * baseColor + 0.22;
+    vec3 specular = colorSpecular.a * spec * specularColor;
+    FragColor = vec4((ambient + diffuse + specular) * attenuation, 0.0);
+}
@@ -0,0 +1,25 @@
+#version 330 core
+// One sphere per point light, sized to the light's radius; the light is
+// found through gl_InstanceID in the same buffer the forward path reads.
+layout (location = 0) in vec3 aPos; // unit sphere, pushed out so its faces enclose the sphere
+
+// per-frame constants from common/frame_constants.h; this stage reads viewProjection
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 cameraPosition;
+    float time;
+};
+
+uniform samplerBuffer lightData; // 2 texels per light: position + radius, colour + specular
+
+flat out int LightIndex;
+
+void main()
+{
+    vec4 positionRadius = texelFetch(lightData, 2 * gl_InstanceID);
+    LightIndex = gl_InstanceID;
+    gl_Position = viewProjection * vec4(positionRadius.xyz + aPos * positionRadius.w, 1.0);
+}
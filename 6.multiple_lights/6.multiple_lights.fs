@@ -2,32 +2,41 @@
 out vec4 FragColor;
 
 struct DirLight { vec3 direction; vec3 ambient; vec3 diffuse; vec3 specular; };
-struct PointLight {
-    vec3 position;
-    float constant; float linear; float quadratic;
-    vec3 ambient; vec3 diffuse; vec3 specular;
-};
 struct SpotLight {
     vec3 position; vec3 direction; float cutOff; float outerCutOff;
     float constant; float linear; float quadratic;
     vec3 ambient; vec3 diffuse; vec3 specular;
 };
 
-#define NR_POINT_LIGHTS 4
-
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 flat in vec3 InstOffset;
 
-uniform vec3 viewPos;
+// per-frame constants from common/frame_constants.h; this stage reads view and cameraPosition
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 cameraPosition;
+    float time;
+};
 uniform DirLight dirLight;
-uniform PointLight pointLights[NR_POINT_LIGHTS];
 uniform SpotLight spotLight;
 uniform float material_shininess;
 
+// clustered point lights (see clustered_lights.h)
+uniform samplerBuffer lightData;      // 2 texels per light: position + radius, colour + specular
+uniform usamplerBuffer clusterRanges; // per cluster: first index, count
+uniform usamplerBuffer lightIndices;  // per-cluster light lists, concatenated
+uniform ivec3 clusterCount;           // tiles x, tiles y, depth slices
+uniform vec2 clusterTileSize;         // tile size in pixels
+uniform vec2 clusterDepth;            // near plane, slices per unit of log(depth)
+
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 baseColor);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 baseColor);
+vec3 CalcPointLight(int index, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 baseColor);
+int ClusterIndex(vec3 fragPos);
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 baseColor);
 
 vec3 hsv2rgb(vec3 c)
@@ -40,7 +49,7 @@ vec3 hsv2rgb(vec3 c)
 void main()
 {
     vec3 norm = normalize(Normal);
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(cameraPosition - FragPos);
 
     float height = InstOffset.y;
     float hue = fract(0.12 * InstOffset.x + 0.08 * InstOffset.z + 0.07 * height + 0.35);
@@ -51,8 +60,10 @@ void main()
     vec3 result = vec3(0.0);
     result += CalcDirLight(dirLight, norm, viewDir, baseColor);
 
-    for (int i = 0; i < NR_POINT_LIGHTS; ++i)
-        result += CalcPointLight(pointLights[i], norm, FragPos, viewDir, baseColor);
+    // only the lights whose range reaches this fragment's cluster
+    uvec2 range = texelFetch(clusterRanges, ClusterIndex(FragPos)).xy;
+    for (uint i = 0u; i < range.y; ++i)
+        result += CalcPointLight(int(texelFetch(lightIndices, int(range.x + i)).x), norm, FragPos, viewDir, baseColor);
 
     result += CalcSpotLight(spotLight, norm, FragPos, viewDir, baseColor);
 
@@ -73,20 +84,34 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 baseColor)
     return ambient + diffuse + specular;
 }
 
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 baseColor)
+// Cluster of a fragment: screen tile from gl_FragCoord, slice from the log of its view depth.
+int ClusterIndex(vec3 fragPos)
 {
-    vec3 lightDir = normalize(light.position - fragPos);
+    ivec2 tile = min(ivec2(gl_FragCoord.xy / clusterTileSize), clusterCount.xy - 1);
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    int slice = clamp(int(floor(log(max(depth / clusterDepth.x, 1.0)) * clusterDepth.y)), 0, clusterCount.z - 1);
+    return (slice * clusterCount.y + tile.y) * clusterCount.x + tile.x;
+}
+
+vec3 CalcPointLight(int index, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 baseColor)
+{
+    vec4 positionRadius = texelFetch(lightData, 2 * index);
+    vec4 colorSpecular = texelFetch(lightData, 2 * index + 1);
+    vec3 toLight = positionRadius.xyz - fragPos;
+    vec3 lightDir = normalize(toLight);
     float diff = max(dot(normal, lightDir), 0.0);
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material_shininess);
-    float distance = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
-    vec3 ambient = light.ambient * baseColor;
-    vec3 diffuse = light.diffuse * diff * baseColor;
+    // inverse-square falloff windowed to reach exactly zero at the light's radius,
+    // so lights outside a cluster really contribute nothing there
+    float d2 = dot(toLight, toLight) / (positionRadius.w * positionRadius.w);
+    float window = clamp(1.0 - d2, 0.0, 1.0);
+    float attenuation = window * window / (1.0 + 4.0 * d2);
+    vec3 ambient = 0.02 * colorSpecular.rgb * baseColor;
+    vec3 diffuse = colorSpecular.rgb * diff * baseColor;
     vec3 specularColor = 0.18 * baseColor + 0.22;
-    vec3 specular = light.specular * spec * specularColor;
-    ambient *= attenuation; diffuse *= attenuation; specular *= attenuation;
-    return ambient + diffuse + specular;
+    vec3 specular = colorSpecular.a * spec * specularColor;
+    return (ambient + diffuse + specular) * attenuation;
 }
 
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 baseColor)
@@ -5,6 +5,7 @@ layout (location = 1) in vec3 aNormal;   // cube normal (object space)
 layout (location = 2) in vec2 aTexCoords;
 
 // per-instance packed vec4: x = offsetX, y = offsetZ, z = phase, w = distFromCenter
+// (not bound when proceduralInstances is set)
 layout (location = 3) in vec4 aInst;
 
 out vec3 FragPos;
@@ -12,11 +13,18 @@ out vec3 Normal;
 out vec2 TexCoords;
 flat out vec3 InstOffset; // pass to fragment shader for color mapping
 
-uniform mat4 view;
-uniform mat4 projection;
+// per-frame constants from common/frame_constants.h; this stage reads viewProjection and time
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 cameraPosition;
+    float time;
+};
 
 // animation uniforms
-uniform float time;       // scaled time
+uniform float timeScale;  // animation speed, applied to the frame time
 uniform float amplitude;  // global amplitude
 uniform float freq;       // primary freq
 uniform float freq2;      // secondary freq
@@ -24,18 +32,39 @@ uniform float rippleFreq; // radial ripple freq
 uniform float heightPow;  // exponent to smooth peaks
 uniform float baseScale;  // uniform scale of cubes
 
+// procedural instancing: with no instance buffer the inputs are rebuilt from
+// the instance index, row by row, as buildCubeFieldInstances computes them
+uniform bool proceduralInstances;
+uniform int gridSide;   // cubes per grid row
+uniform float spacing;  // distance between cubes
+
+// Twin of proceduralInputs in 6.instance_update.vs: GLSL 3.30 has no
+// #include, so a change here has to be made there too (and in
+// buildCubeFieldInstances, which fills the buffer this replaces).
+vec4 proceduralInputs(int index)
+{
+    float x = float(index % gridSide);
+    float z = float(index / gridSide);
+    float ox = (x - float(gridSide) / 2.0) * spacing;
+    float oz = (z - float(gridSide) / 2.0) * spacing;
+    return vec4(ox, oz, (x * 0.7 + z * 1.3) * 0.6, sqrt(ox * ox + oz * oz));
+}
+
 void main()
 {
-    float ox = aInst.x;
-    float oz = aInst.y;
-    float phase = aInst.z;
-    float dist = aInst.w;
+    vec4 inst = proceduralInstances ? proceduralInputs(gl_InstanceID) : aInst;
+    float ox = inst.x;
+    float oz = inst.y;
+    float phase = inst.z;
+    float dist = inst.w;
+    float t = time * timeScale;
 
-    // layered mathy motion:
-    float y1 = sin(time * 1.0 + phase * freq) * 0.95;
-    float y2 = sin(time * 0.6 + (ox * 0.9 + oz * 1.1) * freq2 + phase * 0.8) * 0.6;
-    float ripple = sin(time * 1.3 - dist * rippleFreq) * 0.55;
-    float lissa = 0.15 * sin(1.2 * time + 0.9 * ox + 1.7 * oz);
+    // layered mathy motion (the same wave as 6.instance_update.vs; keep both,
+    // and MAX_WAVE_HEIGHT in multiple_lights.cpp, in sync):
+    float y1 = sin(t * 1.0 + phase * freq) * 0.95;
+    float y2 = sin(t * 0.6 + (ox * 0.9 + oz * 1.1) * freq2 + phase * 0.8) * 0.6;
+    float ripple = sin(t * 1.3 - dist * rippleFreq) * 0.55;
+    float lissa = 0.15 * sin(1.2 * t + 0.9 * ox + 1.7 * oz);
 
     float raw = (y1 + y2 + ripple) * 0.6 + lissa;
     float h = raw * amplitude;
@@ -64,5 +93,5 @@ void main()
     TexCoords = aTexCoords;
     InstOffset = vec3(ox, h, oz);
 
-    gl_Position = projection * view * vec4(FragPos, 1.0);
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
 }
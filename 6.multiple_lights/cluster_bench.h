@@ -0,0 +1,122 @@
+// cluster_bench.h
+// --cluster-bench: headless timing of the clustered light assignment at
+// increasing light counts, from the demo's starting camera. No window or GL
+// context is needed.
+//
+//   --cluster-bench [options]
+//       --frames N       frames animated and assigned per light count (default 200)
+//       --workers N      job system workers (default: hardware threads)
+//
+// Prints CSV: per light count, the CPU time to animate the lights and to
+// assign them to clusters, the average and largest list per cluster, and the
+// number of lights a brute-force check found in range of a sample point but
+// missing from its cluster's list (must be 0).
+
+#ifndef CLUSTER_BENCH_H
+#define CLUSTER_BENCH_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "clustered_lights.h"
+#include "../common/job_system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Lights within range of world-space points that the cluster lists miss. The
+// cluster of each point is found the way the fragment shader does it.
+inline unsigned int countMissedLights(const LightField& field, const LightClusters& clusters, const glm::mat4& view,
+                                      const glm::mat4& projection, float halfExtent, unsigned int samples)
+{
+    std::mt19937 rng(99u);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    glm::vec2 depthParams = clusters.DepthParams();
+    const std::vector<uint32_t>& ranges = clusters.Ranges();
+    const std::vector<uint32_t>& indices = clusters.Indices();
+    unsigned int missed = 0;
+    for (unsigned int s = 0; s < samples; ++s)
+    {
+        glm::vec3 p((unit(rng) * 2.0f - 1.0f) * halfExtent, unit(rng) * 3.0f - 1.0f, (unit(rng) * 2.0f - 1.0f) * halfExtent);
+        glm::vec4 clip = projection * view * glm::vec4(p, 1.0f);
+        if (clip.w <= 0.0f)
+            continue;
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        if (std::abs(ndc.x) >= 1.0f || std::abs(ndc.y) >= 1.0f || std::abs(ndc.z) >= 1.0f)
+            continue;
+        int x = std::min((int)((ndc.x * 0.5f + 0.5f) * CLUSTER_X), CLUSTER_X - 1);
+        int y = std::min((int)((ndc.y * 0.5f + 0.5f) * CLUSTER_Y), CLUSTER_Y - 1);
+        float depth = -(view * glm::vec4(p, 1.0f)).z;
+        int z = (int)std::floor(std::log(std::max(depth / depthParams.x, 1.0f)) * depthParams.y);
+        z = std::min(std::max(z, 0), CLUSTER_Z - 1);
+        int c = (z * CLUSTER_Y + y) * CLUSTER_X + x;
+        const uint32_t* first = indices.data() + ranges[c * 2];
+        const uint32_t* last = first + ranges[c * 2 + 1];
+        for (uint32_t i = 0; i < field.lights.size(); ++i)
+        {
+            glm::vec3 d = field.lights[i].position - p;
+            if (glm::dot(d, d) < field.lights[i].radius * field.lights[i].radius && std::find(first, last, i) == last)
+                ++missed;
+        }
+    }
+    return missed;
+}
+
+inline int runClusterBench(int argc, char** argv, const glm::mat4& view, const glm::mat4& projection, float fovY,
+                           float aspect, float nearPlane, float farPlane, float halfExtent, const glm::vec3* bigColors,
+                           unsigned int bigCount)
+{
+    unsigned int frames = 200;
+    unsigned int workers = 0;
+    for (int i = 2; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (hasValue && std::strcmp(argv[i], "--frames") == 0) frames = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else if (hasValue && std::strcmp(argv[i], "--workers") == 0) workers = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            std::cout << "Unknown cluster-bench option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (frames == 0)
+        frames = 1;
+
+    JobSystem jobs(workers);
+    LightClusters clusters;
+    clusters.Configure(fovY, aspect, nearPlane, farPlane);
+
+    std::cout << "lights,animate_ms,assign_ms,refs_per_cluster,max_per_cluster,missed\n";
+    const unsigned int counts[] = { 1000, 2000, 4000, 6000, 8000, 10000 };
+    for (unsigned int count : counts)
+    {
+        LightField field;
+        field.Init(count, halfExtent, bigColors, bigCount);
+        double animateMs = 0.0, assignMs = 0.0, refs = 0.0;
+        unsigned int most = 0;
+        for (unsigned int f = 0; f < frames; ++f)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            field.Animate(f / 60.0f, jobs);
+            auto t1 = std::chrono::steady_clock::now();
+            clusters.Assign(field.lights.data(), (unsigned int)field.lights.size(), view, jobs);
+            auto t2 = std::chrono::steady_clock::now();
+            animateMs += std::chrono::duration<double, std::milli>(t1 - t0).count();
+            assignMs += std::chrono::duration<double, std::milli>(t2 - t1).count();
+            refs += clusters.Indices().size();
+            most = std::max(most, clusters.MaxPerCluster());
+        }
+        unsigned int missed = countMissedLights(field, clusters, view, projection, halfExtent, 2000);
+        std::cout << count << ',' << animateMs / frames << ',' << assignMs / frames << ','
+                  << refs / frames / LightClusters::COUNT << ',' << most << ',' << missed << '\n';
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,446 @@
+// clustered_lights.h
+// Clustered forward shading for many point lights.
+//
+// The view frustum is cut into a grid of clusters ("froxels"): CLUSTER_X x
+// CLUSTER_Y screen tiles times CLUSTER_Z depth slices, the slices spaced
+// exponentially between the near and far plane so near clusters are not
+// stretched thin. Every frame LightClusters finds, for each cluster, the
+// lights whose sphere of influence touches it, and stores that as one flat
+// index list plus a (first, count) range per cluster. The fragment shader
+// works out its cluster from gl_FragCoord and its view depth and loops over
+// that range only, so the cost per fragment follows the lights nearby rather
+// than the total number of lights.
+//
+// Assignment runs on the CPU in two parallel passes: per light (view-space
+// bounds, slice and tile range), then per depth slice (sphere against each
+// candidate cluster's view-space box), so every slice builds its part of the
+// lists without locks. Point lights have a finite radius; the shader fades
+// them to exactly zero there, which is what makes the culling exact.
+//
+// ClusteredLightBuffers hands the result to GL 3.3 as texture buffers:
+//   lightData      RGBA32F, two texels per light: position + radius, colour + specular
+//   clusterRanges  RG32UI, one texel per cluster: first index, count
+//   lightIndices   R32UI, the concatenated per-cluster lists
+
+#ifndef CLUSTERED_LIGHTS_H
+#define CLUSTERED_LIGHTS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "../common/job_system.h"
+#include "../common/shader_reflect.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+const int CLUSTER_X = 16;
+const int CLUSTER_Y = 9;
+const int CLUSTER_Z = 24; // the shader gets all three through clusterCount
+const unsigned int MAX_CLUSTER_LIGHTS = 1u << 20; // light indices share a word with the tile while sorting
+const unsigned int MAX_BIG_LIGHTS = 8;             // large orbiting lights LightField keeps colours for
+
+struct PointLightData
+{
+    glm::vec3 position;
+    float radius;   // influence ends here
+    glm::vec3 color;
+    float specular;
+};
+
+class LightClusters
+{
+public:
+    // Rebuild the cluster boxes for a projection; cheap to call every frame,
+    // it only does work when something changed.
+    void Configure(float fovY, float aspect, float nearPlane, float farPlane)
+    {
+        if (fovY == configFov && aspect == configAspect && nearPlane == zNear && farPlane == zFar)
+            return;
+        configFov = fovY;
+        configAspect = aspect;
+        zNear = nearPlane;
+        zFar = farPlane;
+        tanY = std::tan(0.5f * fovY);
+        tanX = tanY * aspect;
+        logScale = CLUSTER_Z / std::log(zFar / zNear);
+
+        boxMin.resize(COUNT);
+        boxMax.resize(COUNT);
+        for (int z = 0; z < CLUSTER_Z; ++z)
+        {
+            float d0 = sliceDepth(z), d1 = sliceDepth(z + 1);
+            for (int y = 0; y < CLUSTER_Y; ++y)
+                for (int x = 0; x < CLUSTER_X; ++x)
+                {
+                    float nx0 = -1.0f + 2.0f * x / CLUSTER_X, nx1 = -1.0f + 2.0f * (x + 1) / CLUSTER_X;
+                    float ny0 = -1.0f + 2.0f * y / CLUSTER_Y, ny1 = -1.0f + 2.0f * (y + 1) / CLUSTER_Y;
+                    // view space looks down -z; x and y grow with depth
+                    glm::vec3 lo(std::min(nx0 * tanX * d0, nx0 * tanX * d1), std::min(ny0 * tanY * d0, ny0 * tanY * d1), -d1);
+                    glm::vec3 hi(std::max(nx1 * tanX * d0, nx1 * tanX * d1), std::max(ny1 * tanY * d0, ny1 * tanY * d1), -d0);
+                    boxMin[index(x, y, z)] = lo;
+                    boxMax[index(x, y, z)] = hi;
+                }
+        }
+    }
+
+    // Assign count lights to the clusters of the frustum seen through view.
+    void Assign(const PointLightData* lights, unsigned int count, const glm::mat4& view, JobSystem& jobs)
+    {
+        bounds.resize(count);
+        jobs.ParallelFor(0, count, 256, [&](unsigned int first, unsigned int last, unsigned int) {
+            for (unsigned int i = first; i < last; ++i)
+                bounds[i] = lightBounds(lights[i], view);
+        });
+
+        slices.resize(CLUSTER_Z);
+        jobs.ParallelFor(0, CLUSTER_Z, 1, [&](unsigned int first, unsigned int last, unsigned int) {
+            for (unsigned int z = first; z < last; ++z)
+                fillSlice((int)z, count);
+        });
+
+        // slice lists one after another; ranges point into the joined list
+        unsigned int total = 0;
+        for (SliceLists& slice : slices)
+        {
+            slice.base = total;
+            total += (unsigned int)slice.indices.size();
+        }
+        indices.resize(total);
+        ranges.resize(COUNT * 2);
+        jobs.ParallelFor(0, CLUSTER_Z, 1, [&](unsigned int first, unsigned int last, unsigned int) {
+            for (unsigned int z = first; z < last; ++z)
+            {
+                const SliceLists& slice = slices[z];
+                std::copy(slice.indices.begin(), slice.indices.end(), indices.begin() + slice.base);
+                for (int c = 0; c < TILES; ++c)
+                {
+                    ranges[(z * TILES + c) * 2] = slice.base + slice.offset[c];
+                    ranges[(z * TILES + c) * 2 + 1] = slice.count[c];
+                }
+            }
+        });
+    }
+
+    const std::vector<uint32_t>& Ranges() const { return ranges; }   // first, count per cluster
+    const std::vector<uint32_t>& Indices() const { return indices; }
+
+    // Depth slice parameters for the shader: near plane and slices per unit of log(depth).
+    glm::vec2 DepthParams() const { return glm::vec2(zNear, logScale); }
+
+    unsigned int MaxPerCluster() const
+    {
+        uint32_t most = 0;
+        for (size_t c = 1; c < ranges.size(); c += 2)
+            most = std::max(most, ranges[c]);
+        return most;
+    }
+
+    static const int TILES = CLUSTER_X * CLUSTER_Y;
+    static const int COUNT = TILES * CLUSTER_Z;
+
+private:
+    struct LightBounds
+    {
+        glm::vec3 center; // view space
+        float radius;
+        int x0, x1, y0, y1, z0, z1; // inclusive cluster ranges, z0 > z1 when not visible
+    };
+
+    // One depth slice's lists, grouped by tile.
+    struct SliceLists
+    {
+        std::vector<uint32_t> pairs;   // tile << 20 | light, before grouping
+        std::vector<uint32_t> indices;
+        uint32_t count[TILES];
+        uint32_t offset[TILES];
+        unsigned int base = 0;
+    };
+
+    float configFov = 0.0f, configAspect = 0.0f;
+    float zNear = 0.1f, zFar = 100.0f;
+    float tanX = 1.0f, tanY = 1.0f, logScale = 1.0f;
+    std::vector<glm::vec3> boxMin, boxMax;
+    std::vector<LightBounds> bounds;
+    std::vector<SliceLists> slices;
+    std::vector<uint32_t> ranges;
+    std::vector<uint32_t> indices;
+
+    static int index(int x, int y, int z) { return (z * CLUSTER_Y + y) * CLUSTER_X + x; }
+
+    float sliceDepth(int z) const { return zNear * std::pow(zFar / zNear, (float)z / CLUSTER_Z); }
+
+    int sliceOf(float depth) const
+    {
+        int z = (int)std::floor(std::log(std::max(depth / zNear, 1.0f)) * logScale);
+        return std::min(std::max(z, 0), CLUSTER_Z - 1);
+    }
+
+    LightBounds lightBounds(const PointLightData& light, const glm::mat4& view) const
+    {
+        LightBounds b;
+        b.center = glm::vec3(view * glm::vec4(light.position, 1.0f));
+        b.radius = light.radius;
+        b.z0 = 1;
+        b.z1 = 0;
+        float depth = -b.center.z;
+        float dMin = depth - light.radius, dMax = depth + light.radius;
+        if (dMax < zNear || dMin > zFar)
+            return b;
+        dMin = std::max(dMin, zNear);
+        dMax = std::min(dMax, zFar);
+        b.z0 = sliceOf(dMin);
+        b.z1 = sliceOf(dMax);
+
+        // x / depth is monotonic in both, so the screen rect of the sphere's
+        // box (cut at the near plane) comes from its corners
+        float nx0 = 1e30f, nx1 = -1e30f, ny0 = 1e30f, ny1 = -1e30f;
+        for (float d : { dMin, dMax })
+            for (float s : { -1.0f, 1.0f })
+            {
+                float nx = (b.center.x + s * light.radius) / (d * tanX);
+                float ny = (b.center.y + s * light.radius) / (d * tanY);
+                nx0 = std::min(nx0, nx); nx1 = std::max(nx1, nx);
+                ny0 = std::min(ny0, ny); ny1 = std::max(ny1, ny);
+            }
+        if (nx1 < -1.0f || nx0 > 1.0f || ny1 < -1.0f || ny0 > 1.0f)
+        {
+            b.z0 = 1;
+            b.z1 = 0;
+            return b;
+        }
+        b.x0 = tileOf(nx0, CLUSTER_X);
+        b.x1 = tileOf(nx1, CLUSTER_X);
+        b.y0 = tileOf(ny0, CLUSTER_Y);
+        b.y1 = tileOf(ny1, CLUSTER_Y);
+        return b;
+    }
+
+    static int tileOf(float ndc, int tiles)
+    {
+        int t = (int)std::floor((ndc * 0.5f + 0.5f) * tiles);
+        return std::min(std::max(t, 0), tiles - 1);
+    }
+
+    void fillSlice(int z, unsigned int count)
+    {
+        SliceLists& slice = slices[z];
+        slice.pairs.clear();
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            const LightBounds& b = bounds[i];
+            if (z < b.z0 || z > b.z1)
+                continue;
+            float r2 = b.radius * b.radius;
+            for (int y = b.y0; y <= b.y1; ++y)
+                for (int x = b.x0; x <= b.x1; ++x)
+                {
+                    int c = index(x, y, z);
+                    glm::vec3 p = glm::clamp(b.center, boxMin[c], boxMax[c]);
+                    glm::vec3 d = p - b.center;
+                    if (glm::dot(d, d) <= r2)
+                        slice.pairs.push_back((uint32_t)(y * CLUSTER_X + x) << 20 | i);
+                }
+        }
+
+        // group by tile (counting sort keeps each tile's lights in light order)
+        std::fill(slice.count, slice.count + TILES, 0u);
+        for (uint32_t pair : slice.pairs)
+            ++slice.count[pair >> 20];
+        uint32_t running = 0;
+        for (int c = 0; c < TILES; ++c)
+        {
+            slice.offset[c] = running;
+            running += slice.count[c];
+        }
+        slice.indices.resize(slice.pairs.size());
+        uint32_t cursor[TILES];
+        std::copy(slice.offset, slice.offset + TILES, cursor);
+        for (uint32_t pair : slice.pairs)
+            slice.indices[cursor[pair >> 20]++] = pair & 0xFFFFFu;
+    }
+};
+
+// Lights drifting over the cube field: a few large coloured ones plus many
+// small ones sized so that about the same number overlap any point whatever
+// the count.
+class LightField
+{
+public:
+    std::vector<PointLightData> lights;
+
+    void Init(unsigned int count, float halfExtent, const glm::vec3* bigColors, unsigned int bigCount)
+    {
+        std::mt19937 rng(1234u);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        lights.resize(count);
+        motion.resize(count);
+        big = std::min(std::min(bigCount, MAX_BIG_LIGHTS), count); // extra colours are ignored
+        for (unsigned int i = 0; i < big; ++i)
+            bigColor[i] = bigColors[i];
+
+        const float OVERLAP = 12.0f; // small lights covering an average point
+        unsigned int small = count > big ? count - big : 1;
+        float area = 4.0f * halfExtent * halfExtent;
+        float radius = std::sqrt(OVERLAP * area / (3.14159265f * small));
+        for (unsigned int i = big; i < count; ++i)
+        {
+            Motion& m = motion[i];
+            m.center = glm::vec2((unit(rng) * 2.0f - 1.0f) * halfExtent, (unit(rng) * 2.0f - 1.0f) * halfExtent);
+            m.orbit = 0.2f + 0.8f * unit(rng);
+            m.speed = (0.3f + 0.9f * unit(rng)) * (unit(rng) < 0.5f ? -1.0f : 1.0f);
+            m.phase = 6.2831853f * unit(rng);
+            m.height = 1.2f + 1.0f * unit(rng);
+            lights[i].radius = radius * (0.75f + 0.5f * unit(rng));
+            float hue = unit(rng);
+            lights[i].color = hueColor(hue) * (0.8f + 0.6f * unit(rng));
+            lights[i].specular = 0.6f;
+        }
+    }
+
+    // Move every light to where it is at time t.
+    void Animate(float t, JobSystem& jobs)
+    {
+        for (unsigned int i = 0; i < big; ++i)
+        {
+            // the original three orbiting lights
+            float s = t * (0.3f + 0.08f * i);
+            float r = 6.5f + 1.2f * i;
+            lights[i].position = glm::vec3(r * std::cos(s * (0.6f + 0.1f * i)), 1.8f + 0.8f * std::sin(s * (0.7f + 0.05f * i)),
+                                           r * std::sin(s * (0.6f + 0.1f * i)));
+            lights[i].color = bigColor[i] * 0.95f * (0.75f + 0.25f * (0.5f + 0.5f * std::sin(s * (0.9f + 0.06f * i))));
+            lights[i].radius = 14.0f;
+            lights[i].specular = 1.0f;
+        }
+        jobs.ParallelFor(big, (unsigned int)lights.size(), 1024, [&](unsigned int first, unsigned int last, unsigned int) {
+            for (unsigned int i = first; i < last; ++i)
+            {
+                const Motion& m = motion[i];
+                float a = m.phase + m.speed * t;
+                lights[i].position = glm::vec3(m.center.x + m.orbit * std::cos(a), m.height + 0.3f * std::sin(1.7f * a),
+                                               m.center.y + m.orbit * std::sin(a));
+            }
+        });
+    }
+
+private:
+    struct Motion
+    {
+        glm::vec2 center;
+        float orbit, speed, phase, height;
+    };
+    std::vector<Motion> motion;
+    unsigned int big = 0;
+    glm::vec3 bigColor[MAX_BIG_LIGHTS];
+
+    // fully saturated colour of hue h in [0, 1), as hsv2rgb in the fragment shader
+    static glm::vec3 hueColor(float h)
+    {
+        auto channel = [h](float offset) {
+            return std::min(std::max(std::abs(std::fmod(h * 6.0f + offset, 6.0f) - 3.0f) - 1.0f, 0.0f), 1.0f);
+        };
+        return glm::vec3(channel(0.0f), channel(4.0f), channel(2.0f));
+    }
+};
+
+// The three texture buffers the lighting shader reads, refilled every frame.
+class ClusteredLightBuffers
+{
+public:
+    static const int LIGHT_UNIT = 1; // texture units; 0 stays free for material textures
+    static const int RANGE_UNIT = 2;
+    static const int INDEX_UNIT = 3;
+
+    ClusteredLightBuffers()
+    {
+        createTexture(lightBuffer, lightTexture);
+        createTexture(rangeBuffer, rangeTexture);
+        createTexture(indexBuffer, indexTexture);
+    }
+
+    ClusteredLightBuffers(const ClusteredLightBuffers&) = delete;
+    ClusteredLightBuffers& operator=(const ClusteredLightBuffers&) = delete;
+
+    // Upload this frame's lights (orphaning last frame's storage).
+    void UploadLights(const std::vector<PointLightData>& lights)
+    {
+        upload(lightBuffer, lightTexture, GL_RGBA32F, lights.data(), lights.size() * sizeof(PointLightData));
+    }
+
+    // Upload this frame's cluster lists.
+    void UploadClusters(const LightClusters& clusters)
+    {
+        upload(rangeBuffer, rangeTexture, GL_RG32UI, clusters.Ranges().data(), clusters.Ranges().size() * sizeof(uint32_t));
+        upload(indexBuffer, indexTexture, GL_R32UI, clusters.Indices().data(), clusters.Indices().size() * sizeof(uint32_t));
+    }
+
+    void Bind() const
+    {
+        glActiveTexture(GL_TEXTURE0 + LIGHT_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, lightTexture);
+        glActiveTexture(GL_TEXTURE0 + RANGE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, rangeTexture);
+        glActiveTexture(GL_TEXTURE0 + INDEX_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, indexTexture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+private:
+    unsigned int lightBuffer = 0, lightTexture = 0;
+    unsigned int rangeBuffer = 0, rangeTexture = 0;
+    unsigned int indexBuffer = 0, indexTexture = 0;
+
+    static void createTexture(unsigned int& buffer, unsigned int& texture)
+    {
+        glGenBuffers(1, &buffer);
+        glGenTextures(1, &texture);
+    }
+
+    static void upload(unsigned int buffer, unsigned int texture, GLenum format, const void* data, size_t bytes)
+    {
+        // an empty buffer texture is not allowed to be sampled, keep at least one texel
+        size_t size = std::max<size_t>(bytes, 16);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, size, NULL, GL_STREAM_DRAW);
+        if (bytes)
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+};
+
+// The lighting shader's cluster uniforms.
+struct ClusterUniforms
+{
+    Uniform<int> lightData, clusterRanges, lightIndices;
+    Uniform<glm::ivec3> clusterCount;
+    Uniform<glm::vec2> clusterTileSize, clusterDepth;
+
+    void Find(const ReflectedShader& shader)
+    {
+        lightData = shader.Find<int>("lightData");
+        clusterRanges = shader.Find<int>("clusterRanges");
+        lightIndices = shader.Find<int>("lightIndices");
+        clusterCount = shader.Find<glm::ivec3>("clusterCount");
+        clusterTileSize = shader.Find<glm::vec2>("clusterTileSize");
+        clusterDepth = shader.Find<glm::vec2>("clusterDepth");
+    }
+
+    // Per-frame values; the shader must be in use.
+    void Set(ReflectedShader& shader, const LightClusters& clusters, int framebufferWidth, int framebufferHeight) const
+    {
+        shader.Set(lightData, ClusteredLightBuffers::LIGHT_UNIT);
+        shader.Set(clusterRanges, ClusteredLightBuffers::RANGE_UNIT);
+        shader.Set(lightIndices, ClusteredLightBuffers::INDEX_UNIT);
+        shader.Set(clusterCount, glm::ivec3(CLUSTER_X, CLUSTER_Y, CLUSTER_Z));
+        shader.Set(clusterTileSize, glm::vec2((float)framebufferWidth / CLUSTER_X, (float)framebufferHeight / CLUSTER_Y));
+        shader.Set(clusterDepth, clusters.DepthParams());
+    }
+};
+
+#endif
@@ -0,0 +1,232 @@
+// deferred_renderer.h
+// Deferred path for the cube field: the G-buffer and the fixed geometry of
+// the lighting passes.
+//
+//   1. geometry pass  - the cubes write world position, normal and base colour
+//                       into the G-buffer (6.gbuffer.fs); nothing is lit yet,
+//                       so overdrawn fragments cost only the writes
+//   2. lighting pass  - a full-screen triangle adds directional light,
+//                       spotlight and ambient once per pixel (6.deferred_light.fs)
+//   3. light volumes  - one sphere per point light, instanced, adds that light
+//                       to the pixels inside it (6.light_volume.*)
+//
+// Light volumes draw their back faces with depth test GEQUAL against the
+// scene depth (blitted from the G-buffer), so a pixel is shaded only when the
+// visible surface lies in front of the far side of the sphere; this still
+// works with the camera inside a volume. The lights come from the same
+// texture buffer as the clustered forward path.
+
+#ifndef DEFERRED_RENDERER_H
+#define DEFERRED_RENDERER_H
+
+#include <glad/glad.h>
+
+#include "../common/shader_reflect.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+class DeferredRenderer
+{
+public:
+    static const int POSITION_UNIT = 4; // after the light buffers' units 1-3
+    static const int NORMAL_UNIT = 5;
+    static const int ALBEDO_UNIT = 6;
+
+    DeferredRenderer()
+    {
+        glGenVertexArrays(1, &fullscreenVAO); // the full-screen triangle has no attributes
+        buildVolumeMesh();
+    }
+
+    DeferredRenderer(const DeferredRenderer&) = delete;
+    DeferredRenderer& operator=(const DeferredRenderer&) = delete;
+
+    // (Re)create the G-buffer for the framebuffer size; cheap when unchanged.
+    bool Resize(int width, int height)
+    {
+        if (width == gbufferWidth && height == gbufferHeight)
+            return true;
+        releaseGBuffer();
+        gbufferWidth = width;
+        gbufferHeight = height;
+
+        glGenFramebuffers(1, &gbuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, gbuffer);
+        positionTexture = attachTexture(0, GL_RGBA16F, GL_RGBA, GL_FLOAT);
+        normalTexture = attachTexture(1, GL_RGBA16F, GL_RGBA, GL_FLOAT);
+        albedoTexture = attachTexture(2, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+        const GLenum attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+        glDrawBuffers(3, attachments);
+
+        // same format as the default framebuffer's depth, so it can be blitted there
+        glGenRenderbuffers(1, &depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        if (!complete)
+            std::cout << "ERROR::DEFERRED: G-buffer framebuffer is not complete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return complete;
+    }
+
+    // Geometry pass target; clears position, normal, colour (alpha 0 = empty) and depth.
+    void BeginGeometry() const
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, gbuffer);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    // Back to the default framebuffer, carrying the scene depth over for the light volumes.
+    void EndGeometry() const
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, gbuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, gbufferWidth, gbufferHeight, 0, 0, gbufferWidth, gbufferHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void BindGBuffer() const
+    {
+        glActiveTexture(GL_TEXTURE0 + POSITION_UNIT);
+        glBindTexture(GL_TEXTURE_2D, positionTexture);
+        glActiveTexture(GL_TEXTURE0 + NORMAL_UNIT);
+        glBindTexture(GL_TEXTURE_2D, normalTexture);
+        glActiveTexture(GL_TEXTURE0 + ALBEDO_UNIT);
+        glBindTexture(GL_TEXTURE_2D, albedoTexture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // Lighting pass: one full-screen triangle, no depth test.
+    void DrawFullscreen() const
+    {
+        glDisable(GL_DEPTH_TEST);
+        glBindVertexArray(fullscreenVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glEnable(GL_DEPTH_TEST);
+    }
+
+    // Point-light pass: lightCount instanced spheres, added onto the lit image.
+    void DrawLightVolumes(unsigned int lightCount) const
+    {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        glDepthFunc(GL_GEQUAL);
+        glDepthMask(GL_FALSE);
+        glBindVertexArray(volumeVAO);
+        glDrawElementsInstanced(GL_TRIANGLES, volumeIndexCount, GL_UNSIGNED_SHORT, (void*)0, lightCount);
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LESS);
+        glCullFace(GL_BACK);
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_BLEND);
+    }
+
+    int Width() const { return gbufferWidth; }
+    int Height() const { return gbufferHeight; }
+
+private:
+    static const int VOLUME_SEGMENTS = 16; // around the equator
+    static const int VOLUME_RINGS = 8;     // pole to pole
+
+    unsigned int gbuffer = 0, depthBuffer = 0;
+    unsigned int positionTexture = 0, normalTexture = 0, albedoTexture = 0;
+    int gbufferWidth = 0, gbufferHeight = 0;
+    unsigned int fullscreenVAO = 0;
+    unsigned int volumeVAO = 0, volumeVBO = 0, volumeEBO = 0;
+    int volumeIndexCount = 0;
+
+    unsigned int attachTexture(int attachment, GLint internalFormat, GLenum format, GLenum type) const
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, gbufferWidth, gbufferHeight, 0, format, type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + attachment, GL_TEXTURE_2D, texture, 0);
+        return texture;
+    }
+
+    void releaseGBuffer()
+    {
+        if (!gbuffer)
+            return;
+        glDeleteFramebuffers(1, &gbuffer);
+        glDeleteRenderbuffers(1, &depthBuffer);
+        unsigned int textures[3] = { positionTexture, normalTexture, albedoTexture };
+        glDeleteTextures(3, textures);
+        gbuffer = 0;
+    }
+
+    // UV sphere scaled so its flat faces stay outside the unit sphere: the
+    // polygon's faces sit up to cos(half a step) closer to the centre than
+    // its vertices.
+    void buildVolumeMesh()
+    {
+        const float PI = 3.14159265f;
+        float enclose = 1.0f / (std::cos(PI / VOLUME_SEGMENTS) * std::cos(PI / (2.0f * VOLUME_RINGS)));
+        std::vector<float> positions;
+        for (int r = 0; r <= VOLUME_RINGS; ++r)
+        {
+            float theta = PI * r / VOLUME_RINGS;
+            for (int s = 0; s <= VOLUME_SEGMENTS; ++s)
+            {
+                float phi = 2.0f * PI * s / VOLUME_SEGMENTS;
+                positions.push_back(enclose * std::sin(theta) * std::cos(phi));
+                positions.push_back(enclose * std::cos(theta));
+                positions.push_back(enclose * std::sin(theta) * std::sin(phi));
+            }
+        }
+        // counter-clockwise seen from outside, so culling front faces keeps the far side
+        std::vector<unsigned short> indices;
+        for (int r = 0; r < VOLUME_RINGS; ++r)
+            for (int s = 0; s < VOLUME_SEGMENTS; ++s)
+            {
+                unsigned short a = (unsigned short)(r * (VOLUME_SEGMENTS + 1) + s);
+                unsigned short b = (unsigned short)(a + VOLUME_SEGMENTS + 1);
+                indices.insert(indices.end(), { a, (unsigned short)(a + 1), b, b, (unsigned short)(a + 1), (unsigned short)(b + 1) });
+            }
+        volumeIndexCount = (int)indices.size();
+
+        glGenVertexArrays(1, &volumeVAO);
+        glGenBuffers(1, &volumeVBO);
+        glGenBuffers(1, &volumeEBO);
+        glBindVertexArray(volumeVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, volumeVBO);
+        glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(float), positions.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, volumeEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), indices.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glBindVertexArray(0);
+    }
+};
+
+// The G-buffer samplers of the deferred lighting programs.
+struct GBufferUniforms
+{
+    Uniform<int> position, normal, albedo;
+
+    void Find(const ReflectedShader& shader)
+    {
+        position = shader.Find<int>("gPosition");
+        normal = shader.Find<int>("gNormal");
+        albedo = shader.Find<int>("gAlbedo");
+    }
+
+    void Set(ReflectedShader& shader) const
+    {
+        shader.Set(position, DeferredRenderer::POSITION_UNIT);
+        shader.Set(normal, DeferredRenderer::NORMAL_UNIT);
+        shader.Set(albedo, DeferredRenderer::ALBEDO_UNIT);
+    }
+};
+
+#endif
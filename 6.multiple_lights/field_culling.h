@@ -0,0 +1,194 @@
+// field_culling.h
+// Layout of the cube field's instances in tiles, and the CPU frustum culling
+// that works on that layout.
+//
+// The grid is cut into CULL_TILE x CULL_TILE tiles and each tile's cubes are
+// stored contiguously, tiles in Morton (Z-curve) order. Any aligned square of
+// tiles - a node of a quadtree over the tile grid - is then one contiguous
+// range of instances, so the hierarchical cull below turns a fully visible
+// node into a single run no matter how many cubes it holds, and neighbouring
+// visible nodes merge into longer runs. Draws and the instance pass then
+// touch only the runs, one call each.
+//
+// Tile bounds are conservative: x and z from the grid, y from the largest
+// height the wave can reach. The GPU path (6.instance_cull.gs) tests each
+// cube's real animated box instead.
+//
+// The same walk splits the field for the level of detail: nodes wholly
+// beyond the LOD distance from the eye go to the far runs (drawn as
+// impostors), the rest to the near runs. A tile that straddles the distance
+// keeps its meshes.
+
+#ifndef FIELD_CULLING_H
+#define FIELD_CULLING_H
+
+#include <glm/glm.hpp>
+
+#include "../common/frustum.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+const unsigned int CULL_TILE = 32; // cubes per tile side
+
+// A contiguous range of instances.
+struct InstanceRun
+{
+    unsigned int first;
+    unsigned int count;
+};
+
+class CubeFieldTiles
+{
+public:
+    struct Tile
+    {
+        unsigned int x, z;       // tile coordinates
+        unsigned int first;      // first instance
+        unsigned int count;      // cubes in the tile (edge tiles can be partial)
+    };
+
+    void Build(unsigned int gridSide)
+    {
+        grid = gridSide;
+        tilesPerSide = (grid + CULL_TILE - 1) / CULL_TILE;
+        rootSize = 1;
+        while (rootSize < tilesPerSide)
+            rootSize *= 2;
+
+        tiles.clear();
+        codes.clear();
+        for (unsigned int z = 0; z < tilesPerSide; ++z)
+            for (unsigned int x = 0; x < tilesPerSide; ++x)
+                tiles.push_back(Tile{ x, z, 0, tileCubes(x) * tileCubes(z) });
+        std::sort(tiles.begin(), tiles.end(), [](const Tile& a, const Tile& b) { return morton(a.x, a.z) < morton(b.x, b.z); });
+        unsigned int first = 0;
+        for (Tile& tile : tiles)
+        {
+            tile.first = first;
+            first += tile.count;
+            codes.push_back(morton(tile.x, tile.z));
+        }
+    }
+
+    unsigned int Grid() const { return grid; }
+    const std::vector<Tile>& Tiles() const { return tiles; }
+
+    // Instance index of the cube at grid cell (x, z).
+    unsigned int InstanceIndex(const Tile& tile, unsigned int x, unsigned int z) const
+    {
+        return tile.first + (z - tile.z * CULL_TILE) * tileCubes(tile.x) + (x - tile.x * CULL_TILE);
+    }
+
+    // Collect the instance runs that may be visible, split at lodDistance
+    // from eye (0 puts everything in nearRuns). maxHeight bounds the cubes'
+    // centres above and below the plane; halfSize is half a cube. Without a
+    // frustum every tile counts as visible.
+    void Cull(const Frustum* frustum, float spacing, float maxHeight, float halfSize, const glm::vec3& eye, float lodDistance,
+              std::vector<InstanceRun>& nearRuns, std::vector<InstanceRun>& farRuns) const
+    {
+        nearRuns.clear();
+        farRuns.clear();
+        NodeQuery query{ frustum, spacing, maxHeight, halfSize, eye, lodDistance, nearRuns, farRuns };
+        cullNode(query, 0, 0, rootSize);
+    }
+
+private:
+    unsigned int grid = 0;
+    unsigned int tilesPerSide = 0;
+    unsigned int rootSize = 1; // quadtree root side in tiles, a power of two
+    std::vector<Tile> tiles;   // Morton order
+    std::vector<uint32_t> codes;
+
+    unsigned int tileCubes(unsigned int t) const { return std::min(CULL_TILE, grid - t * CULL_TILE); }
+
+    static uint32_t spread(uint32_t v)
+    {
+        v &= 0xFFFF;
+        v = (v | (v << 8)) & 0x00FF00FF;
+        v = (v | (v << 4)) & 0x0F0F0F0F;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    }
+    static uint32_t morton(uint32_t x, uint32_t z) { return spread(x) | (spread(z) << 1); }
+
+    struct NodeQuery
+    {
+        const Frustum* frustum;
+        float spacing, maxHeight, halfSize;
+        glm::vec3 eye;
+        float lodDistance;
+        std::vector<InstanceRun>& nearRuns;
+        std::vector<InstanceRun>& farRuns;
+    };
+
+    enum NodeLod { LOD_NEAR, LOD_FAR, LOD_MIXED };
+
+    // Nearest and farthest points of the box from the eye against the LOD distance.
+    static NodeLod classify(const NodeQuery& q, const glm::vec3& center, const glm::vec3& extent)
+    {
+        if (q.lodDistance <= 0.0f)
+            return LOD_NEAR;
+        float nearest = 0.0f, farthest = 0.0f;
+        for (int i = 0; i < 3; ++i)
+        {
+            float d = std::abs(q.eye[i] - center[i]);
+            float inside = std::max(d - extent[i], 0.0f);
+            nearest += inside * inside;
+            farthest += (d + extent[i]) * (d + extent[i]);
+        }
+        float limit = q.lodDistance * q.lodDistance;
+        if (nearest >= limit)
+            return LOD_FAR;
+        return farthest < limit ? LOD_NEAR : LOD_MIXED;
+    }
+
+    static void appendRun(std::vector<InstanceRun>& runs, unsigned int first, unsigned int count)
+    {
+        if (!runs.empty() && runs.back().first + runs.back().count == first)
+            runs.back().count += count;
+        else
+            runs.push_back(InstanceRun{ first, count });
+    }
+
+    void cullNode(const NodeQuery& q, unsigned int tx, unsigned int tz, unsigned int size) const
+    {
+        if (tx >= tilesPerSide || tz >= tilesPerSide)
+            return;
+        // cube centres sit at (i - grid/2) * spacing
+        float x0 = ((float)(tx * CULL_TILE) - grid / 2.0f) * q.spacing - q.halfSize;
+        float x1 = ((float)(std::min((tx + size) * CULL_TILE, grid) - 1) - grid / 2.0f) * q.spacing + q.halfSize;
+        float z0 = ((float)(tz * CULL_TILE) - grid / 2.0f) * q.spacing - q.halfSize;
+        float z1 = ((float)(std::min((tz + size) * CULL_TILE, grid) - 1) - grid / 2.0f) * q.spacing + q.halfSize;
+        glm::vec3 center(0.5f * (x0 + x1), 0.0f, 0.5f * (z0 + z1));
+        glm::vec3 extent(0.5f * (x1 - x0), q.maxHeight + q.halfSize, 0.5f * (z1 - z0));
+        FrustumTest test = q.frustum ? q.frustum->TestBox(center, extent) : FRUSTUM_INSIDE;
+        if (test == FRUSTUM_OUTSIDE)
+            return;
+        NodeLod lod = classify(q, center, extent);
+        if ((test == FRUSTUM_INSIDE && lod != LOD_MIXED) || size == 1)
+        {
+            // the node's tiles are the Morton codes [code, code + size * size)
+            uint32_t code = morton(tx, tz);
+            size_t a = std::lower_bound(codes.begin(), codes.end(), code) - codes.begin();
+            size_t b = std::lower_bound(codes.begin(), codes.end(), code + size * size) - codes.begin();
+            if (a == b)
+                return;
+            unsigned int first = tiles[a].first;
+            unsigned int last = tiles[b - 1].first + tiles[b - 1].count;
+            appendRun(lod == LOD_FAR ? q.farRuns : q.nearRuns, first, last - first);
+            return;
+        }
+        unsigned int half = size / 2;
+        // children in Morton order, so runs come out sorted and mergeable
+        cullNode(q, tx, tz, half);
+        cullNode(q, tx + half, tz, half);
+        cullNode(q, tx, tz + half, half);
+        cullNode(q, tx + half, tz + half, half);
+    }
+};
+
+#endif
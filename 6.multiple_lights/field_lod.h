@@ -0,0 +1,66 @@
+// field_lod.h
+// Level of detail for the cube field. Cubes farther from the camera than the
+// LOD distance are drawn as impostors: one screen-aligned point sprite per
+// cube (6.impostor.vs), one vertex instead of the mesh's 36, with the cube's
+// colour. Forward shading lights them with the directional light alone
+// (6.impostor.fs); the deferred path writes them into the G-buffer facing up.
+//
+// The split comes with the culling. The GPU path animates each cube the tile
+// cull keeps once and then culls the animated centres twice, for the near
+// and the far range, each into its own buffer (6.instance_passthrough.vs +
+// 6.instance_cull.gs, no second wave); the CPU path sorts the tiles while it
+// walks them (field_culling.h). Either way the near and far instance counts tell how
+// many vertices the impostors saved.
+
+#ifndef FIELD_LOD_H
+#define FIELD_LOD_H
+
+#include <glad/glad.h>
+
+#include "field_culling.h"
+#include "../common/shader_reflect.h"
+
+#include <vector>
+
+const unsigned int CUBE_VERTICES = 36;    // per mesh cube; an impostor is one
+const float DEFAULT_LOD_DISTANCE = 30.0f; // --lod-distance D
+
+// Point an impostor VAO's centres (location 0) at centreBuffer.
+inline void setImpostorSource(unsigned int vao, unsigned int centreBuffer)
+{
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, centreBuffer);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+}
+
+// VAO drawing the vec3 centres in centreBuffer as points (location 0).
+inline unsigned int createImpostorVAO(unsigned int centreBuffer)
+{
+    unsigned int vao;
+    glGenVertexArrays(1, &vao);
+    setImpostorSource(vao, centreBuffer);
+    return vao;
+}
+
+// One impostor per instance in runs. Points are not instanced, so the run's
+// first instance is simply the first vertex; no attribute re-pointing.
+inline void drawImpostorRuns(unsigned int vao, const std::vector<InstanceRun>& runs)
+{
+    glBindVertexArray(vao);
+    for (const InstanceRun& run : runs)
+        glDrawArrays(GL_POINTS, run.first, run.count);
+}
+
+// Sprite sizing of the impostor programs.
+struct ImpostorUniforms
+{
+    Uniform<float> viewportHeight;
+
+    void Find(const ReflectedShader& shader) { viewportHeight = shader.Find<float>("viewportHeight"); }
+
+    void Set(ReflectedShader& shader, int framebufferHeight) const { shader.Set(viewportHeight, (float)framebufferHeight); }
+};
+
+#endif
@@ -0,0 +1,422 @@
+// instance_update.h
+// Cube field instances: the static per-cube inputs, and the per-frame pass
+// that animates them once per cube instead of once per vertex.
+//
+// 6.multiple_lights.vs evaluates the layered wave, builds the model matrix
+// and inverts it for the normal in every one of a cube's 36 vertices.
+// InstanceAnimator moves that work to one vertex per cube: it draws the
+// instance inputs as points through 6.instance_update.vs with the rasteriser
+// off and captures each cube's animated centre (a vec3) with transform
+// feedback. The cube programs (6.cube_field.vs) read that buffer as a
+// per-instance attribute and only add the scaled vertex offset; the scale is
+// uniform, so the normal needs no matrix at all.
+//
+// With a geometry shader (6.instance_cull.gs) the same pass also culls: only
+// cubes whose animated box touches the frustum are written, packed at the
+// start of the output, and a query reports how many. GL 3.3 has no indirect
+// draws, so that count has to come back to the CPU for the instanced draw.
+// Waiting for it would stall every frame on the pass, so a culling pass
+// writes into a ring of CULL_FRAMES outputs, each with its own query, and
+// the draw uses the newest one whose count is already available: the
+// visible set is usually a frame or two old, which only shows as cubes at
+// the screen edge appearing a frame late. The pass is fed the runs the CPU
+// tile cull keeps (field_culling.h), so its cost follows what is on screen
+// rather than the size of the field. A culling
+// pass can also start from centres that are already animated: with
+// 6.instance_passthrough.vs as its vertex stage it reads another animator's
+// Output() as its source, so the wave is evaluated once however many ranges
+// are culled from it.
+//
+// Procedural instancing drops the input buffer altogether: the shaders rebuild
+// each cube's inputs from its index (gl_VertexID in the pass, gl_InstanceID in
+// 6.multiple_lights.vs) in plain row order, so nothing is built or uploaded at
+// startup. That order has no tiles, so the CPU cull is not available with it.
+
+#ifndef INSTANCE_UPDATE_H
+#define INSTANCE_UPDATE_H
+
+#include <glad/glad.h>
+
+#include "field_culling.h"
+#include "../common/job_system.h"
+#include "../common/shader_reflect.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Static per-cube inputs, packed vec4: x, z, phase, distance from the centre,
+// in the tile order of field_culling.h. Built one tile per job item.
+inline std::vector<float> buildCubeFieldInstances(const CubeFieldTiles& layout, float spacing, JobSystem& jobs)
+{
+    const unsigned int grid = layout.Grid();
+    const std::vector<CubeFieldTiles::Tile>& tiles = layout.Tiles();
+    std::vector<float> instanceData((size_t)grid * grid * 4);
+    jobs.ParallelFor(0, (unsigned int)tiles.size(), 4, [&](unsigned int first, unsigned int last, unsigned int) {
+        for (unsigned int t = first; t < last; ++t)
+        {
+            const CubeFieldTiles::Tile& tile = tiles[t];
+            unsigned int x1 = std::min((tile.x + 1) * CULL_TILE, grid), z1 = std::min((tile.z + 1) * CULL_TILE, grid);
+            for (unsigned int z = tile.z * CULL_TILE; z < z1; ++z)
+            {
+                for (unsigned int x = tile.x * CULL_TILE; x < x1; ++x)
+                {
+                    float fx = ((float)x - (float)grid / 2.0f) * spacing;
+                    float fz = ((float)z - (float)grid / 2.0f) * spacing;
+                    float phase = (x * 0.7f + z * 1.3f) * 0.6f; // as proceduralInputs in the shaders
+                    float dist = std::sqrt(fx * fx + fz * fz);
+                    float* inst = &instanceData[(size_t)layout.InstanceIndex(tile, x, z) * 4];
+                    inst[0] = fx;
+                    inst[1] = fz;
+                    inst[2] = phase;
+                    inst[3] = dist;
+                }
+            }
+        }
+    });
+    return instanceData;
+}
+
+// The cube field's animation uniforms. The per-vertex programs have them all;
+// with the instance pass the update program has the wave and the cube
+// programs only the scale (the rest then stay invalid and are skipped).
+struct CubeFieldUniforms
+{
+    Uniform<float> timeScale, amplitude, freq, freq2, rippleFreq, heightPow, baseScale;
+
+    void Find(const ReflectedShader& shader)
+    {
+        timeScale = shader.Find<float>("timeScale");
+        amplitude = shader.Find<float>("amplitude");
+        freq = shader.Find<float>("freq");
+        freq2 = shader.Find<float>("freq2");
+        rippleFreq = shader.Find<float>("rippleFreq");
+        heightPow = shader.Find<float>("heightPow");
+        baseScale = shader.Find<float>("baseScale");
+    }
+};
+
+// Where the cube programs get their per-cube inputs: the instance buffer, or
+// computed from the index. Programs without the inputs skip these.
+struct InstanceSourceUniforms
+{
+    Uniform<bool> procedural;
+    Uniform<int> gridSide;
+    Uniform<float> spacing;
+
+    void Find(const ReflectedShader& shader)
+    {
+        procedural = shader.Find<bool>("proceduralInstances");
+        gridSide = shader.Find<int>("gridSide");
+        spacing = shader.Find<float>("spacing");
+    }
+
+    void Set(ReflectedShader& shader, bool proceduralInstances, unsigned int grid, float cubeSpacing) const
+    {
+        shader.Set(procedural, proceduralInstances);
+        shader.Set(gridSide, (int)grid);
+        shader.Set(spacing, cubeSpacing);
+    }
+};
+
+// The culling stage's own uniforms (6.instance_cull.gs): the frustum, and the
+// range of distances from the camera this pass keeps.
+struct CullUniforms
+{
+    Uniform<glm::vec4> frustumPlanes[6];
+    Uniform<glm::vec2> lodRange;
+
+    void Find(const ReflectedShader& shader)
+    {
+        for (int i = 0; i < 6; ++i)
+            frustumPlanes[i] = shader.Find<glm::vec4>("frustumPlanes[" + std::to_string(i) + "]");
+        lodRange = shader.Find<glm::vec2>("lodRange");
+    }
+
+    void Set(ReflectedShader& shader, const Frustum& frustum, float minDistance, float maxDistance) const
+    {
+        for (int i = 0; i < 6; ++i)
+            shader.Set(frustumPlanes[i], frustum.planes[i]);
+        shader.Set(lodRange, glm::vec2(minDistance, maxDistance));
+    }
+};
+
+// VAO with the cube's position, normal and texcoords (locations 0-2) from cubeVBO.
+inline unsigned int createCubeVAO(unsigned int cubeVBO)
+{
+    unsigned int vao;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0); // pos
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float))); // normal
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float))); // texcoords
+    glEnableVertexAttribArray(2);
+    glBindVertexArray(0);
+    return vao;
+}
+
+// Point a cube VAO's per-instance attribute (location 3) at buffer.
+inline void bindCubeInstanceAttribute(unsigned int vao, unsigned int buffer, int components)
+{
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, components, GL_FLOAT, GL_FALSE, components * sizeof(float), (void*)0);
+    glVertexAttribDivisor(3, 1);
+    glBindVertexArray(0);
+}
+
+// Draw the cube (36 vertices) for every instance in runs. Without base
+// instances in GL 3.3, each run re-points the VAO's per-instance attribute
+// at its first element; the pointer is left back at the start.
+inline void drawInstanceRuns(unsigned int vao, unsigned int buffer, int components, const std::vector<InstanceRun>& runs)
+{
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    const size_t stride = components * sizeof(float);
+    for (const InstanceRun& run : runs)
+    {
+        glVertexAttribPointer(3, components, GL_FLOAT, GL_FALSE, (GLsizei)stride, (void*)(run.first * stride));
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 36, run.count);
+    }
+    glVertexAttribPointer(3, components, GL_FLOAT, GL_FALSE, (GLsizei)stride, (void*)0);
+}
+
+const unsigned int CULL_FRAMES = 3; // culling outputs: the one drawn, plus passes waiting for their counts
+
+// A culling pass's packed output and how many instances it holds.
+struct CulledInstances
+{
+    unsigned int buffer;
+    unsigned int count;
+};
+
+class InstanceAnimator
+{
+public:
+    unsigned int ID = 0; // the update program; set its uniforms through ReflectedShader as usual
+
+    InstanceAnimator() = default;
+    InstanceAnimator(const InstanceAnimator&) = delete;
+    InstanceAnimator& operator=(const InstanceAnimator&) = delete;
+
+    // Compile the update shaders and link them with varying (the vec3 per
+    // cube) as the captured output, which has to be declared before linking.
+    // A geometry shader makes this a culling pass.
+    bool Load(const char* vertexPath, const char* geometryPath = nullptr, const char* varying = "InstancePosition")
+    {
+        unsigned int vertex = compile(vertexPath, GL_VERTEX_SHADER);
+        if (!vertex)
+            return false;
+        unsigned int geometry = 0;
+        if (geometryPath && !(geometry = compile(geometryPath, GL_GEOMETRY_SHADER)))
+        {
+            glDeleteShader(vertex);
+            return false;
+        }
+        ID = glCreateProgram();
+        glAttachShader(ID, vertex);
+        if (geometry)
+            glAttachShader(ID, geometry);
+        glTransformFeedbackVaryings(ID, 1, &varying, GL_INTERLEAVED_ATTRIBS);
+        glLinkProgram(ID);
+        glDeleteShader(vertex);
+        if (geometry)
+        {
+            glDeleteShader(geometry);
+            outputCount = CULL_FRAMES;
+            glGenQueries(CULL_FRAMES, writtenQuery);
+        }
+        return checkStatus(ID, GL_LINK_STATUS, "PROGRAM_LINKING_ERROR");
+    }
+
+    // Read count instances from sourceBuffer (components floats per cube: the
+    // packed vec4 inputs, or another pass's vec3 centres) and size the output
+    // for them. Source 0 binds nothing, for procedural instances.
+    void SetSource(unsigned int sourceBuffer, unsigned int count, int components = 4)
+    {
+        if (!vao)
+        {
+            glGenVertexArrays(1, &vao);
+            glGenBuffers(outputCount, outputs);
+        }
+        instanceCount = count;
+        glBindVertexArray(vao);
+        if (sourceBuffer)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, sourceBuffer);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, components, GL_FLOAT, GL_FALSE, components * sizeof(float), (void*)0);
+        }
+        else
+            glDisableVertexAttribArray(0);
+        glBindVertexArray(0);
+
+        for (unsigned int slot = 0; slot < outputCount; ++slot)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, outputs[slot]);
+            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)count * 3 * sizeof(float), NULL, GL_DYNAMIC_COPY);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // Animate every instance for this frame. The update program must be in
+    // use with its uniforms set; the frame constants supply the time.
+    void Update() const { Update(InstanceRun{ 0, instanceCount }); }
+
+    // Animate one run of instances, written to the same place in the output.
+    void Update(const InstanceRun& run) const
+    {
+        glEnable(GL_RASTERIZER_DISCARD);
+        glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, outputs[0], (GLintptr)run.first * 3 * sizeof(float),
+                          (GLsizeiptr)run.count * 3 * sizeof(float));
+        glBeginTransformFeedback(GL_POINTS);
+        glBindVertexArray(vao);
+        glDrawArrays(GL_POINTS, run.first, run.count);
+        glEndTransformFeedback();
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        glDisable(GL_RASTERIZER_DISCARD);
+    }
+
+    // Culling pass over runs, packed into the next free output of the ring.
+    // The culling program must be in use with its uniforms set.
+    void Cull(const std::vector<InstanceRun>& runs)
+    {
+        unsigned int slot = freeSlot();
+        glEnable(GL_RASTERIZER_DISCARD);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, outputs[slot]);
+        glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, writtenQuery[slot]);
+        glBeginTransformFeedback(GL_POINTS);
+        glBindVertexArray(vao);
+        for (const InstanceRun& run : runs)
+            glDrawArrays(GL_POINTS, run.first, run.count);
+        glEndTransformFeedback();
+        glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        glDisable(GL_RASTERIZER_DISCARD);
+        pending[slot] = ++passes;
+    }
+
+    // Newest culling pass whose count is already available, without waiting
+    // for the GPU; the last one returned while none has finished since. Only
+    // before any pass has ever finished does it wait, for the oldest.
+    CulledInstances Latest()
+    {
+        // newest pass first; queries finish in order, so the first available one is the newest
+        int oldest = -1;
+        unsigned long long below = ~0ull;
+        for (;;)
+        {
+            int slot = -1;
+            for (unsigned int s = 0; s < CULL_FRAMES; ++s)
+                if (pending[s] && pending[s] < below && (slot < 0 || pending[s] > pending[slot]))
+                    slot = (int)s;
+            if (slot < 0)
+                break;
+            GLuint available = 0;
+            glGetQueryObjectuiv(writtenQuery[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+            {
+                show(slot);
+                break;
+            }
+            below = pending[slot];
+            oldest = slot;
+        }
+        if (shown < 0 && oldest >= 0)
+            show(oldest); // nothing to draw yet: wait, once
+        return CulledInstances{ shown >= 0 ? outputs[shown] : 0, shownCount };
+    }
+
+    // Animated centres, one vec3 per instance (a plain animation pass's output).
+    unsigned int Output() const { return outputs[0]; }
+
+private:
+    unsigned int vao = 0;
+    unsigned int outputs[CULL_FRAMES] = {};
+    unsigned int outputCount = 1; // CULL_FRAMES for a culling pass
+    unsigned int instanceCount = 0;
+    // culling passes only: per output, its count query and the number of the
+    // pass waiting on it (0 for none), and the output being drawn
+    unsigned int writtenQuery[CULL_FRAMES] = {};
+    unsigned long long pending[CULL_FRAMES] = {};
+    unsigned long long passes = 0;
+    int shown = -1;
+    unsigned int shownCount = 0;
+
+    // Draw slot from now on (waiting for its count if need be); passes older
+    // than it are dropped, their outputs free again.
+    void show(int slot)
+    {
+        GLuint written = 0;
+        glGetQueryObjectuiv(writtenQuery[slot], GL_QUERY_RESULT, &written);
+        for (unsigned int s = 0; s < CULL_FRAMES; ++s)
+            if (pending[s] && pending[s] < pending[slot])
+                pending[s] = 0;
+        pending[slot] = 0;
+        shown = slot;
+        shownCount = written;
+    }
+
+    // Output for the next pass: never the one being drawn; a free one, or
+    // else the oldest still waiting (the GPU is that far behind).
+    unsigned int freeSlot() const
+    {
+        int best = -1;
+        for (unsigned int slot = 0; slot < CULL_FRAMES; ++slot)
+            if ((int)slot != shown && (best < 0 || pending[slot] < pending[best]))
+                best = (int)slot;
+        return (unsigned int)best;
+    }
+
+    static unsigned int compile(const char* path, GLenum type)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+            return 0;
+        }
+        std::stringstream stream;
+        stream << file.rdbuf();
+        std::string code = stream.str();
+        const char* source = code.c_str();
+
+        unsigned int shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, NULL);
+        glCompileShader(shader);
+        if (!checkStatus(shader, GL_COMPILE_STATUS, "SHADER_COMPILATION_ERROR"))
+        {
+            glDeleteShader(shader);
+            return 0;
+        }
+        return shader;
+    }
+
+    static bool checkStatus(unsigned int object, GLenum status, const char* what)
+    {
+        int success = 0;
+        char infoLog[1024];
+        if (status == GL_COMPILE_STATUS)
+            glGetShaderiv(object, status, &success);
+        else
+            glGetProgramiv(object, status, &success);
+        if (success)
+            return true;
+        if (status == GL_COMPILE_STATUS)
+            glGetShaderInfoLog(object, 1024, NULL, infoLog);
+        else
+            glGetProgramInfoLog(object, 1024, NULL, infoLog);
+        std::cout << "ERROR::" << what << " of type: INSTANCE_UPDATE\n" << infoLog << std::endl;
+        return false;
+    }
+};
+
+#endif
@@ -0,0 +1,85 @@
+// lod_bench.h
+// --lod-bench: headless report of what the impostor level of detail saves,
+// seen from a few camera positions at several LOD distances. It uses the CPU
+// split (the tile walk of field_culling.h, what --cull cpu draws), so no
+// window or GL context is needed. The GPU path splits per cube and shows its
+// own counts in the title and at exit.
+//
+//   --lod-bench [options]
+//       --grid N         grid side (default 500)
+//
+// Prints CSV: camera, LOD distance, cubes left after frustum culling drawn as
+// meshes and as impostors, vertices per frame with the impostors and with
+// meshes only, and the share of vertices saved.
+
+#ifndef LOD_BENCH_H
+#define LOD_BENCH_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "field_culling.h"
+#include "field_lod.h"
+#include "../common/frustum.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+inline int runLodBench(int argc, char** argv, const glm::mat4& projection, float spacing, float halfSize, float maxHeight)
+{
+    unsigned int grid = 500;
+    for (int i = 2; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (hasValue && std::strcmp(argv[i], "--grid") == 0) grid = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            std::cout << "Unknown lod-bench option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (grid == 0)
+        grid = 1;
+
+    CubeFieldTiles tiles;
+    tiles.Build(grid);
+    const float halfExtent = grid / 2.0f * spacing;
+    struct Viewpoint
+    {
+        const char* name;
+        glm::vec3 eye, target;
+    };
+    const Viewpoint viewpoints[] = {
+        { "start", glm::vec3(0.0f, 6.0f, 18.0f), glm::vec3(0.0f, 6.0f, 17.0f) }, // the demo's camera, facing -z
+        { "centre", glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 1.0f, -8.0f) },
+        { "corner", glm::vec3(-halfExtent, 3.0f, halfExtent), glm::vec3(0.0f) },
+        { "overhead", glm::vec3(0.0f, 60.0f, 1.0f), glm::vec3(0.0f) },
+    };
+    const float distances[] = { 10.0f, 20.0f, 30.0f, 50.0f, 80.0f };
+
+    std::cout << "camera,lod_distance,mesh_cubes,impostors,vertices,mesh_only_vertices,saved_pct\n";
+    std::vector<InstanceRun> nearRuns, farRuns;
+    for (const Viewpoint& viewpoint : viewpoints)
+    {
+        Frustum frustum;
+        frustum.Extract(projection * glm::lookAt(viewpoint.eye, viewpoint.target, glm::vec3(0.0f, 1.0f, 0.0f)));
+        for (float distance : distances)
+        {
+            tiles.Cull(&frustum, spacing, maxHeight, halfSize, viewpoint.eye, distance, nearRuns, farRuns);
+            unsigned long long meshes = 0, impostors = 0;
+            for (const InstanceRun& run : nearRuns)
+                meshes += run.count;
+            for (const InstanceRun& run : farRuns)
+                impostors += run.count;
+            unsigned long long vertices = meshes * CUBE_VERTICES + impostors;
+            unsigned long long meshOnly = (meshes + impostors) * CUBE_VERTICES;
+            std::cout << viewpoint.name << ',' << distance << ',' << meshes << ',' << impostors << ',' << vertices << ','
+                      << meshOnly << ',' << (meshOnly ? 100.0 * (meshOnly - vertices) / meshOnly : 0.0) << '\n';
+        }
+    }
+    return 0;
+}
+
+#endif
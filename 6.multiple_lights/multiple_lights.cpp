@@ -14,7 +14,25 @@
 #include <learnopengl/shader_m.h>
 #include <learnopengl/camera.h>
 
+#include "clustered_lights.h"
+#include "cluster_bench.h"
+#include "deferred_renderer.h"
+#include "field_lod.h"
+#include "instance_update.h"
+#include "lod_bench.h"
+#include "vertex_bench.h"
+#include "../common/frame_constants.h"
+#include "../common/gpu_timer.h"
+#include "../common/input_replay.h"
+#include "../common/job_system.h"
+#include "../common/shader_reflect.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <vector>
 #include <cmath>
 #include <string>
@@ -23,33 +41,168 @@
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
-void processInput(GLFWwindow* window);
+InputFrame pollInput(GLFWwindow* window);
+void processInput(const InputFrame& input);
+uint64_t cameraHash();
 unsigned int loadTexture(const char* path);
 
+// one light struct of the lighting shader, resolved once after linking
+struct LightUniforms
+{
+    Uniform<glm::vec3> position, direction, ambient, diffuse, specular;
+    Uniform<float> constant, linear, quadratic, cutOff, outerCutOff;
+};
+LightUniforms findLightUniforms(const ReflectedShader& shader, const std::string& name);
+
 // settings
 const unsigned int SCR_WIDTH = 1280;
 const unsigned int SCR_HEIGHT = 720;
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 120.0f;
+const unsigned int DEFAULT_LIGHTS = 1000;
+
+// Instancing parameters
+const unsigned int DEFAULT_GRID = 120; // grid x grid instances (120 -> 14,400 cubes), --grid N
+const float SPACING = 0.13f;           // distance between cubes
+const float SCALE = 0.85f;             // base cube scale
+
+// animation params (tweakable)
+const float GLOBAL_AMPLITUDE = 1.6f;
+const float GLOBAL_SPEED = 0.9f;
+const float PRIMARY_FREQ = 1.8f;
+const float SECONDARY_FREQ = 0.9f;
+const float RIPPLE_FREQ = 0.95f;
+const float HEIGHT_EXPONENT = 0.95f;
+// highest a cube centre gets above or below the plane: the wave's raw sum
+// stays within (0.95 + 0.6 + 0.55) * 0.6 + 0.15 = 1.41 before scaling
+const float MAX_WAVE_HEIGHT = std::pow(std::max(1.41f * GLOBAL_AMPLITUDE, 1.0f), HEIGHT_EXPONENT);
+
+// colors of the three large moving lights; the rest get random hues
+const glm::vec3 BIG_LIGHT_COLORS[3] = {
+    glm::vec3(1.0f, 0.55f, 0.12f),
+    glm::vec3(0.12f, 0.55f, 1.0f),
+    glm::vec3(0.9f, 0.2f, 0.9f)
+};
 
 // camera
 Camera camera(glm::vec3(0.0f, 6.0f, 18.0f));
 float lastX = (float)SCR_WIDTH / 2.0f;
 float lastY = (float)SCR_HEIGHT / 2.0f;
 bool firstMouse = true;
+InputFrame pendingInput; // mouse and wheel movement gathered by the callbacks until the next poll
+uint32_t previousKeys = 0;
+
+// rendering path, Tab switches
+bool deferredShading = false;
+
+// cube culling, C cycles: none, GPU (the instance pass drops hidden cubes),
+// CPU (quadtree over the field's tiles, see field_culling.h)
+enum CullMode { CULL_NONE, CULL_GPU, CULL_CPU };
+const char* const CULL_MODE_NAMES[3] = { "none", "gpu", "cpu" };
+CullMode cullMode = CULL_GPU;
+
+// far cubes as impostors (field_lod.h), L switches
+bool lodEnabled = true;
 
 // timing
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-int main()
+int main(int argc, char** argv)
 {
+    if (argc > 1 && std::strcmp(argv[1], "--cluster-bench") == 0)
+        return runClusterBench(argc, argv, camera.GetViewMatrix(),
+                               glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE),
+                               glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE,
+                               DEFAULT_GRID / 2.0f * SPACING, BIG_LIGHT_COLORS, 3);
+    if (argc > 1 && std::strcmp(argv[1], "--lod-bench") == 0)
+        return runLodBench(argc, argv,
+                           glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE),
+                           SPACING, 0.5f * SCALE, MAX_WAVE_HEIGHT);
+    const bool vertexBench = argc > 1 && std::strcmp(argv[1], "--vertex-bench") == 0;
+
+    unsigned int lightCount = DEFAULT_LIGHTS;
+    unsigned int grid = DEFAULT_GRID;
+    bool perVertexAnimation = false; // animate in every cube vertex instead of once per cube
+    bool proceduralInstances = false; // rebuild the per-cube inputs from the index instead of a buffer
+    float lodDistance = DEFAULT_LOD_DISTANCE;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--no-uniform-cache") == 0)
+            uniformStats().caching = false; // look up and send every uniform every frame, for comparison
+        else if (std::strcmp(argv[i], "--deferred") == 0)
+            deferredShading = true;
+        else if (std::strcmp(argv[i], "--per-vertex-animation") == 0)
+            perVertexAnimation = true;
+        else if (std::strcmp(argv[i], "--procedural-instances") == 0)
+            proceduralInstances = true;
+        else if (std::strcmp(argv[i], "--no-lod") == 0)
+            lodEnabled = false;
+        else if (std::strcmp(argv[i], "--lod-distance") == 0 && i + 1 < argc)
+            lodDistance = std::max(0.0f, (float)std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--cull") == 0 && i + 1 < argc)
+        {
+            ++i;
+            if (std::strcmp(argv[i], "none") == 0) cullMode = CULL_NONE;
+            else if (std::strcmp(argv[i], "gpu") == 0) cullMode = CULL_GPU;
+            else if (std::strcmp(argv[i], "cpu") == 0) cullMode = CULL_CPU;
+            else std::cout << "Unknown cull mode: " << argv[i] << " (none, gpu or cpu)" << std::endl;
+        }
+        else if (std::strcmp(argv[i], "--grid") == 0 && i + 1 < argc)
+            grid = (unsigned int)std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--lights") == 0 && i + 1 < argc)
+            lightCount = std::min((unsigned int)std::max(1, std::atoi(argv[++i])), MAX_CLUSTER_LIGHTS);
+    }
+
+    // --record FILE / --replay FILE [--headless]: see input_replay.h. A replay
+    // refuses a different grid or light count and reports the other flags.
+    const InputOptions inputOptions = parseInputOptions(argc, argv);
+    InputReplay replay;
+    InputRecorder recorder;
+    const char* const cullNames[] = { "none", "gpu", "cpu" };
+    InputScenario scenario;
+    scenario.Add("grid", grid).Add("lights", lightCount).Add("cull", cullNames[cullMode])
+        .Add("lod", lodEnabled ? 1 : 0).Add("lod-distance", lodDistance).Add("deferred", deferredShading ? 1 : 0)
+        .Add("per-vertex-animation", perVertexAnimation ? 1 : 0).Add("procedural-instances", proceduralInstances ? 1 : 0);
+    const bool replaying = !inputOptions.replayPath.empty();
+    if (replaying && (!replay.Load(inputOptions.replayPath)
+                      || !replay.MatchesScenario(scenario, { "cull", "lod", "lod-distance", "deferred",
+                                                             "per-vertex-animation", "procedural-instances" })))
+        return -1;
+    if (!inputOptions.recordPath.empty() && !recorder.Open(inputOptions.recordPath, 0, 0.0f, scenario))
+        return -1;
+    const float fieldHalfExtent = grid / 2.0f * SPACING;
+
+    // without a window only the camera moves, which is all the hash covers
+    if (replaying && inputOptions.headless)
+    {
+        FrameTimeStats stats;
+        InputFrame input;
+        while (replay.Next(input))
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            deltaTime = input.time - lastFrame;
+            lastFrame = input.time;
+            processInput(input);
+            stats.Add(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+        }
+        stats.Print(cameraHash());
+        return 0;
+    }
+
     // GLFW init
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // the deferred path blits G-buffer depth into the window, which needs the same DEPTH24_STENCIL8 format
+    glfwWindowHint(GLFW_DEPTH_BITS, 24);
+    glfwWindowHint(GLFW_STENCIL_BITS, 8);
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
+    if (vertexBench)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Instanced Art - Thousands of Cubes (fixed)", NULL, NULL);
     if (!window) { std::cout << "Failed to create GLFW window\n"; glfwTerminate(); return -1; }
@@ -62,10 +215,26 @@ int main()
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) { std::cout << "Failed to initialize GLAD\n"; return -1; }
 
     glEnable(GL_DEPTH_TEST);
+    glEnable(GL_PROGRAM_POINT_SIZE); // impostor sprites size themselves
 
-    // shaders
-    Shader lightingShader("6.multiple_lights.vs", "6.multiple_lights.fs");
+    // shaders; by default the wave runs once per cube in the instance pass
+    const char* cubeVertexShader = perVertexAnimation ? "6.multiple_lights.vs" : "6.cube_field.vs";
+    Shader lightingShader(cubeVertexShader, "6.multiple_lights.fs");
     Shader lightCubeShader("6.light_cube.vs", "6.light_cube.fs");
+    Shader gbufferShader(cubeVertexShader, "6.gbuffer.fs");
+    InstanceAnimator animator;
+    if (!animator.Load("6.instance_update.vs")) { glfwTerminate(); return -1; }
+    // the same pass, writing only the cubes inside the frustum
+    InstanceAnimator culler;
+    if (!culler.Load("6.instance_update.vs", "6.instance_cull.gs", "VisiblePosition")) { glfwTerminate(); return -1; }
+    // with impostors: the animator's centres culled twice, near ones and far ones, without redoing the wave
+    InstanceAnimator nearCuller, farCuller;
+    if (!nearCuller.Load("6.instance_passthrough.vs", "6.instance_cull.gs", "VisiblePosition")) { glfwTerminate(); return -1; }
+    if (!farCuller.Load("6.instance_passthrough.vs", "6.instance_cull.gs", "VisiblePosition")) { glfwTerminate(); return -1; }
+    Shader impostorShader("6.impostor.vs", "6.impostor.fs");
+    Shader impostorGBufferShader("6.impostor.vs", "6.gbuffer.fs");
+    Shader deferredLightShader("6.deferred_light.vs", "6.deferred_light.fs");
+    Shader lightVolumeShader("6.light_volume.vs", "6.light_volume.fs");
 
     // cube geometry (36 vertices)
     float vertices[] = {
@@ -114,54 +283,53 @@ int main()
     };
 
     // cube VAO/VBO
-    unsigned int cubeVAO, cubeVBO;
-    glGenVertexArrays(1, &cubeVAO);
+    unsigned int cubeVBO;
     glGenBuffers(1, &cubeVBO);
-    glBindVertexArray(cubeVAO);
     glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    // attributes
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0); // pos
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float))); // normal
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float))); // texcoords
-    glEnableVertexAttribArray(2);
-
-    // Instancing parameters
-    const unsigned int GRID = 120;      // GRID x GRID instances (120 -> 14,400 cubes)
-    const float SPACING = 0.13f;        // distance between cubes
-    const float SCALE = 0.85f;          // base cube scale
-
-    // prepare instance data (packed vec4: x, z, phase, dist)
-    std::vector<float> instanceData;
-    instanceData.reserve(GRID * GRID * 4);
-    for (unsigned int x = 0; x < GRID; ++x)
+    unsigned int cubeVAO = createCubeVAO(cubeVBO);
+
+    // prepare instance data (packed vec4: x, z, phase, dist) in culling tile order, one tile per item;
+    // procedural instances have no buffer, the shaders compute the same values
+    JobSystem jobs;
+    CubeFieldTiles fieldTiles;
+    unsigned int instanceVBO = 0;
+    if (!proceduralInstances)
     {
-        for (unsigned int z = 0; z < GRID; ++z)
-        {
-            float fx = ((float)x - (float)GRID / 2.0f) * SPACING;
-            float fz = ((float)z - (float)GRID / 2.0f) * SPACING;
-            float phase = (x * 0.7f + z * 1.3f) * 0.6f;
-            float dist = std::sqrt(fx * fx + fz * fz);
-            instanceData.push_back(fx);
-            instanceData.push_back(fz);
-            instanceData.push_back(phase);
-            instanceData.push_back(dist);
-        }
+        auto buildStart = std::chrono::steady_clock::now();
+        fieldTiles.Build(grid);
+        std::vector<float> instanceData = buildCubeFieldInstances(fieldTiles, SPACING, jobs);
+        auto buildEnd = std::chrono::steady_clock::now();
+        glGenBuffers(1, &instanceVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, instanceData.size() * sizeof(float), instanceData.data(), GL_STATIC_DRAW);
+        glFinish(); // so the upload is in the timing
+        auto uploadEnd = std::chrono::steady_clock::now();
+        std::cout << grid * grid << " cube instances: " << instanceData.size() * sizeof(float) / (1024.0 * 1024.0)
+                  << " MB buffer, built in " << std::chrono::duration<double, std::milli>(buildEnd - buildStart).count()
+                  << " ms, uploaded in " << std::chrono::duration<double, std::milli>(uploadEnd - buildEnd).count() << " ms"
+                  << std::endl;
     }
-
-    unsigned int instanceVBO;
-    glGenBuffers(1, &instanceVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-    glBufferData(GL_ARRAY_BUFFER, instanceData.size() * sizeof(float), instanceData.data(), GL_STATIC_DRAW);
-
-    // set instanced attribute: layout(location = 3) vec4 aInst
-    glBindVertexArray(cubeVAO);
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-    glVertexAttribDivisor(3, 1);
+    else
+        std::cout << grid * grid << " cube instances: procedural, no instance buffer" << std::endl;
+
+    // per-instance attribute (location 3): the raw inputs for the per-vertex
+    // shader (none when procedural), otherwise the centres the instance pass
+    // writes each frame
+    animator.SetSource(instanceVBO, grid * grid);
+    if (!perVertexAnimation)
+        bindCubeInstanceAttribute(cubeVAO, animator.Output(), 3);
+    else if (instanceVBO)
+        bindCubeInstanceAttribute(cubeVAO, instanceVBO, 4);
+    // GPU culling draws the packed visible centres instead, from whichever of
+    // the culling pass's outputs is current; the VAOs are pointed at it each frame
+    culler.SetSource(instanceVBO, grid * grid);
+    nearCuller.SetSource(animator.Output(), grid * grid, 3);
+    farCuller.SetSource(animator.Output(), grid * grid, 3);
+    unsigned int culledVAO = createCubeVAO(cubeVBO);
+    unsigned int impostorVAO = createImpostorVAO(animator.Output());
+    unsigned int farImpostorVAO;
+    glGenVertexArrays(1, &farImpostorVAO);
 
     // light cube VAO (reuse cubeVBO but only position)
     unsigned int lightCubeVAO;
@@ -171,122 +339,459 @@ int main()
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
-    // shader initial uniforms
-    lightingShader.use();
-    lightingShader.setFloat("baseScale", SCALE);
+    // camera matrices, camera position and time reach every program through one buffer
+    FrameConstantsBuffer frameConstants;
+    frameConstants.Attach(lightingShader.ID);
+    frameConstants.Attach(lightCubeShader.ID);
+    frameConstants.Attach(gbufferShader.ID);
+    frameConstants.Attach(deferredLightShader.ID);
+    frameConstants.Attach(lightVolumeShader.ID);
+    frameConstants.Attach(animator.ID);
+    frameConstants.Attach(culler.ID);
+    frameConstants.Attach(nearCuller.ID);
+    frameConstants.Attach(farCuller.ID);
+    frameConstants.Attach(impostorShader.ID);
+    frameConstants.Attach(impostorGBufferShader.ID);
+
+    // lighting shader uniforms, looked up once here instead of by name every frame
+    ReflectedShader lighting(lightingShader.ID);
+    CubeFieldUniforms cubeFieldU;
+    cubeFieldU.Find(lighting);
+    InstanceSourceUniforms instanceSourceU;
+    instanceSourceU.Find(lighting);
+    const LightUniforms dirLightU = findLightUniforms(lighting, "dirLight");
+    const LightUniforms spotLightU = findLightUniforms(lighting, "spotLight");
+    ClusterUniforms clusterU;
+    clusterU.Find(lighting);
+
+    // deferred path: geometry pass (same vertex shader), lighting pass, light volumes
+    ReflectedShader gbuffer(gbufferShader.ID);
+    CubeFieldUniforms gbufferCubeFieldU;
+    gbufferCubeFieldU.Find(gbuffer);
+    InstanceSourceUniforms gbufferInstanceSourceU;
+    gbufferInstanceSourceU.Find(gbuffer);
+    ReflectedShader deferredLight(deferredLightShader.ID);
+    const LightUniforms deferredDirLightU = findLightUniforms(deferredLight, "dirLight");
+    const LightUniforms deferredSpotLightU = findLightUniforms(deferredLight, "spotLight");
+    GBufferUniforms deferredGBufferU;
+    deferredGBufferU.Find(deferredLight);
+    ReflectedShader lightVolume(lightVolumeShader.ID);
+    GBufferUniforms volumeGBufferU;
+    volumeGBufferU.Find(lightVolume);
+    const Uniform<int> volumeLightDataU = lightVolume.Find<int>("lightData");
+    DeferredRenderer deferredRenderer;
+
+    // per-instance animation pass
+    ReflectedShader update(animator.ID);
+    CubeFieldUniforms updateCubeFieldU;
+    updateCubeFieldU.Find(update);
+    InstanceSourceUniforms updateInstanceSourceU;
+    updateInstanceSourceU.Find(update);
+    ReflectedShader cull(culler.ID);
+    CubeFieldUniforms cullCubeFieldU;
+    cullCubeFieldU.Find(cull);
+    InstanceSourceUniforms cullInstanceSourceU;
+    cullInstanceSourceU.Find(cull);
+    CullUniforms cullU;
+    cullU.Find(cull);
+    ReflectedShader nearCull(nearCuller.ID);
+    CubeFieldUniforms nearCullCubeFieldU; // only the cube size, for the box
+    nearCullCubeFieldU.Find(nearCull);
+    CullUniforms nearCullU;
+    nearCullU.Find(nearCull);
+    ReflectedShader farCull(farCuller.ID);
+    CubeFieldUniforms farCullCubeFieldU;
+    farCullCubeFieldU.Find(farCull);
+    CullUniforms farCullU;
+    farCullU.Find(farCull);
+
+    // impostors, forward and into the G-buffer
+    ReflectedShader impostor(impostorShader.ID);
+    CubeFieldUniforms impostorCubeFieldU;
+    impostorCubeFieldU.Find(impostor);
+    ImpostorUniforms impostorU;
+    impostorU.Find(impostor);
+    const LightUniforms impostorDirLightU = findLightUniforms(impostor, "dirLight");
+    const LightUniforms impostorSpotLightU = findLightUniforms(impostor, "spotLight"); // none; lets setSceneLights serve it too
+    ReflectedShader impostorGBuffer(impostorGBufferShader.ID);
+    CubeFieldUniforms impostorGBufferCubeFieldU;
+    impostorGBufferCubeFieldU.Find(impostorGBuffer);
+    ImpostorUniforms impostorGBufferU;
+    impostorGBufferU.Find(impostorGBuffer);
+
+    // point lights: animated on the job system, assigned to clusters every frame
+    LightField lightField;
+    lightField.Init(lightCount, fieldHalfExtent, BIG_LIGHT_COLORS, 3);
+    LightClusters clusters;
+    ClusteredLightBuffers lightBuffers;
+
+    // the cube field's animation, for every program that has a part of it
+    auto setCubeField = [&](ReflectedShader& shader, const CubeFieldUniforms& u) {
+        shader.Set(u.timeScale, GLOBAL_SPEED);
+        shader.Set(u.amplitude, GLOBAL_AMPLITUDE);
+        shader.Set(u.freq, PRIMARY_FREQ);
+        shader.Set(u.freq2, SECONDARY_FREQ);
+        shader.Set(u.rippleFreq, RIPPLE_FREQ);
+        shader.Set(u.heightPow, HEIGHT_EXPONENT);
+        shader.Set(u.baseScale, SCALE);
+    };
 
-    // colors for moving lights
-    glm::vec3 baseColors[3] = {
-        glm::vec3(1.0f, 0.55f, 0.12f),
-        glm::vec3(0.12f, 0.55f, 1.0f),
-        glm::vec3(0.9f, 0.2f, 0.9f)
+    // directional light and camera spotlight, for both lighting programs
+    auto setSceneLights = [&](ReflectedShader& shader, const LightUniforms& dirLight, const LightUniforms& spotLight) {
+        shader.Set(dirLight.direction, glm::vec3(-0.2f, -1.0f, -0.25f));
+        shader.Set(dirLight.ambient, glm::vec3(0.02f, 0.02f, 0.03f));
+        shader.Set(dirLight.diffuse, glm::vec3(0.32f, 0.32f, 0.36f));
+        shader.Set(dirLight.specular, glm::vec3(0.5f, 0.5f, 0.5f));
+
+        shader.Set(spotLight.position, camera.Position);
+        shader.Set(spotLight.direction, camera.Front);
+        shader.Set(spotLight.ambient, glm::vec3(0.0f));
+        shader.Set(spotLight.diffuse, glm::vec3(1.0f));
+        shader.Set(spotLight.specular, glm::vec3(1.0f));
+        shader.Set(spotLight.constant, 1.0f);
+        shader.Set(spotLight.linear, 0.09f);
+        shader.Set(spotLight.quadratic, 0.032f);
+        shader.Set(spotLight.cutOff, glm::cos(glm::radians(12.5f)));
+        shader.Set(spotLight.outerCutOff, glm::cos(glm::radians(15.0f)));
     };
 
-    // animation params (tweakable)
-    const float GLOBAL_AMPLITUDE = 1.6f;
-    const float GLOBAL_SPEED = 0.9f;
-    const float PRIMARY_FREQ = 1.8f;
-    const float SECONDARY_FREQ = 0.9f;
-    const float RIPPLE_FREQ = 0.95f;
-    const float HEIGHT_EXPONENT = 0.95f;
+    if (vertexBench)
+    {
+        int result = runVertexBench(argc, argv, cubeVBO, frameConstants, camera.GetViewMatrix(),
+                                    glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE),
+                                    camera.Position, SPACING, jobs, setCubeField);
+        glfwTerminate();
+        return result;
+    }
+
+    // stage timings: CPU animate + assign, CPU upload, and per GPU pass its time
+    // and the fragments it let through (overdraw once divided by the pixel count)
+    GpuTimer updateTimer, shadingTimer, geometryTimer, lightingTimer, volumeTimer;
+    GpuSampleCounter shadingSamples, geometrySamples, volumeSamples;
+    double assignMs = 0.0, uploadMs = 0.0, titleAssignMs = 0.0;
+    double visibleTotal = 0.0, impostorTotal = 0.0;
+    std::vector<InstanceRun> cubeRuns, impostorRuns, farCullRuns;
+    unsigned long long titleFrames = 0;
+    float lastTitle = 0.0f;
 
     // render loop
+    FrameTimeStats replayStats;
+    unsigned long long frames = 0;
+    uniformStats().Reset();
+    auto frameStart = std::chrono::steady_clock::now();
+    int framebufferWidth = SCR_WIDTH, framebufferHeight = SCR_HEIGHT;
     while (!glfwWindowShouldClose(window))
     {
-        float currentFrame = (float)glfwGetTime();
+        InputFrame input;
+        if (!replaying)
+            input = pollInput(window);
+        else if (!replay.Next(input))
+            break;
+        recorder.Record(input);
+
+        float currentFrame = input.time;
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
-        processInput(window);
+        processInput(input);
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
 
-        // animate 3 point lights
-        glm::vec3 lightPos[3];
-        glm::vec3 lightCol[3];
-        for (int i = 0; i < 3; ++i)
+        // per-frame constants, once for every program
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE);
+        glm::mat4 view = camera.GetViewMatrix();
+        frameConstants.Update(view, projection, camera.Position, currentFrame);
+
+        // animate the cubes once each and cull them; the per-vertex shaders
+        // need the raw inputs, so they fall back to the CPU cull, which in
+        // turn needs the tiled buffer
+        unsigned int amount = grid * grid;
+        CullMode frameCull = (perVertexAnimation && cullMode == CULL_GPU) ? CULL_CPU : cullMode;
+        if (proceduralInstances && frameCull == CULL_CPU)
+            frameCull = perVertexAnimation ? CULL_NONE : CULL_GPU;
+        // impostors are drawn from the animated centres, and split by the GPU pass or the tiles
+        bool frameLod = lodEnabled && lodDistance > 0.0f && !perVertexAnimation && (frameCull == CULL_GPU || !proceduralInstances);
+        Frustum frustum;
+        frustum.Extract(projection * view);
+        cubeRuns.clear();
+        impostorRuns.clear();
+        if (frameCull == CULL_GPU)
         {
-            float t = currentFrame * (0.3f + 0.08f * i);
-            float r = 6.5f + 1.2f * i;
-            lightPos[i] = glm::vec3(r * cos(t * (0.6f + 0.1f * i)), 1.8f + 0.8f * sin(t * (0.7f + 0.05f * i)), r * sin(t * (0.6f + 0.1f * i)));
-            lightCol[i] = baseColors[i] * (0.75f + 0.25f * (0.5f + 0.5f * sin(t * (0.9f + 0.06f * i))));
+            // the tile cull first, so the pass only sees cubes that may be on
+            // screen (procedural instances have no tiles: all of them); far runs
+            // are wholly beyond the LOD distance, straddling tiles stay near
+            if (!proceduralInstances)
+                fieldTiles.Cull(&frustum, SPACING, MAX_WAVE_HEIGHT, 0.5f * SCALE, camera.Position, frameLod ? lodDistance : 0.0f,
+                                cubeRuns, impostorRuns);
+            else
+                cubeRuns.push_back(InstanceRun{ 0, amount });
+
+            const float NO_LIMIT = std::numeric_limits<float>::max();
+            updateTimer.Begin();
+            if (!frameLod)
+            {
+                glUseProgram(culler.ID);
+                setCubeField(cull, cullCubeFieldU);
+                cullInstanceSourceU.Set(cull, proceduralInstances, grid, SPACING);
+                cullU.Set(cull, frustum, 0.0f, NO_LIMIT);
+                culler.Cull(cubeRuns);
+            }
+            else
+            {
+                // one wave per kept cube, then the two ranges culled from its centres
+                glUseProgram(animator.ID);
+                setCubeField(update, updateCubeFieldU);
+                updateInstanceSourceU.Set(update, proceduralInstances, grid, SPACING);
+                for (const InstanceRun& run : cubeRuns)
+                    animator.Update(run);
+                for (const InstanceRun& run : impostorRuns)
+                    animator.Update(run);
+                glUseProgram(nearCuller.ID);
+                setCubeField(nearCull, nearCullCubeFieldU);
+                nearCullU.Set(nearCull, frustum, 0.0f, lodDistance);
+                nearCuller.Cull(cubeRuns);
+                farCullRuns.assign(cubeRuns.begin(), cubeRuns.end());
+                farCullRuns.insert(farCullRuns.end(), impostorRuns.begin(), impostorRuns.end());
+                glUseProgram(farCuller.ID);
+                setCubeField(farCull, farCullCubeFieldU);
+                farCullU.Set(farCull, frustum, lodDistance, NO_LIMIT);
+                farCuller.Cull(farCullRuns);
+            }
+            updateTimer.End();
+        }
+        else
+        {
+            if (!proceduralInstances)
+                fieldTiles.Cull(frameCull == CULL_CPU ? &frustum : nullptr, SPACING, MAX_WAVE_HEIGHT, 0.5f * SCALE,
+                                camera.Position, frameLod ? lodDistance : 0.0f, cubeRuns, impostorRuns);
+            else
+                cubeRuns.push_back(InstanceRun{ 0, amount });
+            if (!perVertexAnimation)
+            {
+                glUseProgram(animator.ID);
+                setCubeField(update, updateCubeFieldU);
+                updateInstanceSourceU.Set(update, proceduralInstances, grid, SPACING);
+                updateTimer.Begin();
+                for (const InstanceRun& run : cubeRuns)
+                    animator.Update(run);
+                for (const InstanceRun& run : impostorRuns)
+                    animator.Update(run);
+                updateTimer.End();
+            }
         }
 
-        // clear
-        glClearColor(0.02f, 0.02f, 0.03f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // use lighting shader
-        lightingShader.use();
-        lightingShader.setVec3("viewPos", camera.Position);
-
-        // directional light (use glm::vec3 for setVec3)
-        lightingShader.setVec3("dirLight.direction", glm::vec3(-0.2f, -1.0f, -0.25f));
-        lightingShader.setVec3("dirLight.ambient", glm::vec3(0.02f, 0.02f, 0.03f));
-        lightingShader.setVec3("dirLight.diffuse", glm::vec3(0.32f, 0.32f, 0.36f));
-        lightingShader.setVec3("dirLight.specular", glm::vec3(0.5f, 0.5f, 0.5f));
-
-        // set point lights (first 3); shader expects pointLights[0..3]
-        for (int i = 0; i < 3; ++i)
+        // move the point lights; the forward path also sorts them into the view's clusters
+        auto assignStart = std::chrono::steady_clock::now();
+        lightField.Animate(currentFrame, jobs);
+        if (!deferredShading)
+        {
+            clusters.Configure(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE);
+            clusters.Assign(lightField.lights.data(), (unsigned int)lightField.lights.size(), view, jobs);
+        }
+        auto uploadStart = std::chrono::steady_clock::now();
+        lightBuffers.UploadLights(lightField.lights);
+        if (!deferredShading)
+            lightBuffers.UploadClusters(clusters);
+        auto uploadEnd = std::chrono::steady_clock::now();
+        double frameAssignMs = std::chrono::duration<double, std::milli>(uploadStart - assignStart).count();
+        assignMs += frameAssignMs;
+        titleAssignMs += frameAssignMs;
+        uploadMs += std::chrono::duration<double, std::milli>(uploadEnd - uploadStart).count();
+        lightBuffers.Bind();
+
+        // the GPU cull's newest finished outputs; usually a frame or two old, never waited for
+        unsigned int visibleCubes = 0, impostorCount = 0;
+        if (frameCull == CULL_GPU)
+        {
+            CulledInstances cubes = frameLod ? nearCuller.Latest() : culler.Latest();
+            bindCubeInstanceAttribute(culledVAO, cubes.buffer, 3);
+            visibleCubes = cubes.count;
+            if (frameLod)
+            {
+                CulledInstances impostors = farCuller.Latest();
+                setImpostorSource(farImpostorVAO, impostors.buffer);
+                impostorCount = impostors.count;
+            }
+        }
+        else
+        {
+            for (const InstanceRun& run : cubeRuns)
+                visibleCubes += run.count;
+            for (const InstanceRun& run : impostorRuns)
+                impostorCount += run.count;
+        }
+        visibleTotal += visibleCubes;
+        impostorTotal += impostorCount;
+        auto drawCubes = [&]() {
+            if (frameCull == CULL_GPU)
+            {
+                glBindVertexArray(culledVAO);
+                glDrawArraysInstanced(GL_TRIANGLES, 0, 36, visibleCubes);
+            }
+            else if (perVertexAnimation && proceduralInstances)
+            {
+                glBindVertexArray(cubeVAO); // nothing per instance to re-point, and never culled
+                glDrawArraysInstanced(GL_TRIANGLES, 0, 36, amount);
+            }
+            else
+                drawInstanceRuns(cubeVAO, perVertexAnimation ? instanceVBO : animator.Output(), perVertexAnimation ? 4 : 3, cubeRuns);
+        };
+        // far cubes, one point each; the program must be in use
+        auto drawImpostors = [&]() {
+            if (frameCull == CULL_GPU)
+            {
+                glBindVertexArray(farImpostorVAO);
+                glDrawArrays(GL_POINTS, 0, impostorCount);
+            }
+            else
+                drawImpostorRuns(impostorVAO, impostorRuns);
+        };
+
+        if (!deferredShading)
         {
-            std::string base = "pointLights[" + std::to_string(i) + "]";
-            lightingShader.setVec3(base + ".position", lightPos[i]);
-            lightingShader.setVec3(base + ".ambient", lightCol[i] * 0.02f);
-            lightingShader.setVec3(base + ".diffuse", lightCol[i] * 0.95f);
-            lightingShader.setVec3(base + ".specular", glm::vec3(1.0f));
-            lightingShader.setFloat(base + ".constant", 1.0f);
-            lightingShader.setFloat(base + ".linear", 0.07f);
-            lightingShader.setFloat(base + ".quadratic", 0.017f);
+            // forward: every cube fragment that passes the depth test is fully lit
+            glClearColor(0.02f, 0.02f, 0.03f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            // use lighting shader; unchanged values are filtered out by ReflectedShader
+            lightingShader.use();
+            setSceneLights(lighting, dirLightU, spotLightU);
+            clusterU.Set(lighting, clusters, framebufferWidth, framebufferHeight);
+            setCubeField(lighting, cubeFieldU);
+            instanceSourceU.Set(lighting, proceduralInstances, grid, SPACING);
+
+            // draw instanced cubes
+            shadingTimer.Begin();
+            shadingSamples.Begin();
+            drawCubes();
+            if (impostorCount)
+            {
+                impostorShader.use();
+                setSceneLights(impostor, impostorDirLightU, impostorSpotLightU);
+                setCubeField(impostor, impostorCubeFieldU);
+                impostorU.Set(impostor, framebufferHeight);
+                drawImpostors();
+            }
+            shadingSamples.End();
+            shadingTimer.End();
         }
-        // disable the 4th point light
+        else
         {
-            std::string base = "pointLights[3]";
-            lightingShader.setVec3(base + ".position", glm::vec3(0.0f, -50.0f, 0.0f));
-            lightingShader.setVec3(base + ".ambient", glm::vec3(0.0f));
-            lightingShader.setVec3(base + ".diffuse", glm::vec3(0.0f));
-            lightingShader.setVec3(base + ".specular", glm::vec3(0.0f));
-            lightingShader.setFloat(base + ".constant", 1.0f);
-            lightingShader.setFloat(base + ".linear", 0.09f);
-            lightingShader.setFloat(base + ".quadratic", 0.032f);
+            // deferred: cubes into the G-buffer, then each pixel lit once
+            deferredRenderer.Resize(framebufferWidth, framebufferHeight);
+            deferredRenderer.BeginGeometry();
+            gbufferShader.use();
+            setCubeField(gbuffer, gbufferCubeFieldU);
+            gbufferInstanceSourceU.Set(gbuffer, proceduralInstances, grid, SPACING);
+            geometryTimer.Begin();
+            geometrySamples.Begin();
+            drawCubes();
+            if (impostorCount)
+            {
+                impostorGBufferShader.use();
+                setCubeField(impostorGBuffer, impostorGBufferCubeFieldU);
+                impostorGBufferU.Set(impostorGBuffer, framebufferHeight);
+                drawImpostors();
+            }
+            geometrySamples.End();
+            geometryTimer.End();
+            deferredRenderer.EndGeometry();
+
+            glClearColor(0.02f, 0.02f, 0.03f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            deferredRenderer.BindGBuffer();
+            deferredLightShader.use();
+            setSceneLights(deferredLight, deferredDirLightU, deferredSpotLightU);
+            deferredGBufferU.Set(deferredLight);
+            lightingTimer.Begin();
+            deferredRenderer.DrawFullscreen();
+            lightingTimer.End();
+
+            lightVolumeShader.use();
+            volumeGBufferU.Set(lightVolume);
+            lightVolume.Set(volumeLightDataU, ClusteredLightBuffers::LIGHT_UNIT);
+            volumeTimer.Begin();
+            volumeSamples.Begin();
+            deferredRenderer.DrawLightVolumes((unsigned int)lightField.lights.size());
+            volumeSamples.End();
+            volumeTimer.End();
         }
 
-        // spotlight from camera
-        lightingShader.setVec3("spotLight.position", camera.Position);
-        lightingShader.setVec3("spotLight.direction", camera.Front);
-        lightingShader.setVec3("spotLight.ambient", glm::vec3(0.0f));
-        lightingShader.setVec3("spotLight.diffuse", glm::vec3(1.0f));
-        lightingShader.setVec3("spotLight.specular", glm::vec3(1.0f));
-        lightingShader.setFloat("spotLight.constant", 1.0f);
-        lightingShader.setFloat("spotLight.linear", 0.09f);
-        lightingShader.setFloat("spotLight.quadratic", 0.032f);
-        lightingShader.setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-        lightingShader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
-
-        // projection / view
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 120.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        lightingShader.setMat4("projection", projection);
-        lightingShader.setMat4("view", view);
-
-        // pass animation uniforms
-        lightingShader.setFloat("time", currentFrame * GLOBAL_SPEED);
-        lightingShader.setFloat("amplitude", GLOBAL_AMPLITUDE);
-        lightingShader.setFloat("freq", PRIMARY_FREQ);
-        lightingShader.setFloat("freq2", SECONDARY_FREQ);
-        lightingShader.setFloat("rippleFreq", RIPPLE_FREQ);
-        lightingShader.setFloat("heightPow", HEIGHT_EXPONENT);
-        lightingShader.setFloat("baseScale", SCALE);
-
-        // draw instanced cubes
-        glBindVertexArray(cubeVAO);
-        unsigned int amount = GRID * GRID;
-        glDrawArraysInstanced(GL_TRIANGLES, 0, 36, amount);
+        ++titleFrames;
+        if (currentFrame - lastTitle >= 0.5f)
+        {
+            double pixels = (double)framebufferWidth * framebufferHeight;
+            std::string title = "Instanced Art - " + std::to_string(visibleCubes) + " of " + std::to_string(amount) + " cubes ("
+                + CULL_MODE_NAMES[frameCull] + " cull), " + std::to_string(lightField.lights.size()) + " lights | ";
+            if (frameLod)
+            {
+                double meshOnly = (double)(visibleCubes + impostorCount) * CUBE_VERTICES;
+                title += std::to_string(impostorCount) + " impostors beyond " + std::to_string((int)lodDistance) + ", "
+                    + std::to_string(meshOnly > 0.0 ? 100.0 * impostorCount * (CUBE_VERTICES - 1) / meshOnly : 0.0)
+                    + "% vertices saved | ";
+            }
+            if (!perVertexAnimation)
+                title += "instance pass " + std::to_string(updateTimer.LastMs()) + " ms | ";
+            if (!deferredShading)
+                title += "forward | assign " + std::to_string(titleAssignMs / titleFrames) + " ms | shade "
+                    + std::to_string(shadingTimer.LastMs()) + " ms | overdraw " + std::to_string(shadingSamples.Last() / pixels)
+                    + " | " + std::to_string(clusters.Indices().size()) + " refs, max " + std::to_string(clusters.MaxPerCluster())
+                    + " per cluster";
+            else
+                title += "deferred | geometry " + std::to_string(geometryTimer.LastMs()) + " ms, lighting "
+                    + std::to_string(lightingTimer.LastMs()) + " ms, volumes " + std::to_string(volumeTimer.LastMs())
+                    + " ms | overdraw " + std::to_string(geometrySamples.Last() / pixels) + " | light fragments/pixel "
+                    + std::to_string(volumeSamples.Last() / pixels);
+            glfwSetWindowTitle(window, title.c_str());
+            titleAssignMs = 0.0;
+            titleFrames = 0;
+            lastTitle = currentFrame;
+        }
 
         // swap
         glfwSwapBuffers(window);
         glfwPollEvents();
+
+        auto frameEnd = std::chrono::steady_clock::now();
+        if (replaying)
+            replayStats.Add(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+        frameStart = frameEnd;
+        ++frames;
     }
+    uniformStats().Print(frames);
+    if (frames)
+    {
+        double pixels = (double)framebufferWidth * framebufferHeight;
+        std::cout << lightField.lights.size() << " lights: animate+assign " << assignMs / frames << " ms, upload "
+                  << uploadMs / frames << " ms per frame" << std::endl;
+        if (!perVertexAnimation)
+            std::cout << grid * grid << " cubes: instance pass " << updateTimer.AverageMs() << " ms" << std::endl;
+        std::cout << "culling: " << visibleTotal / frames << " cubes drawn, " << grid * grid - (visibleTotal + impostorTotal) / frames
+                  << " culled per frame on average" << std::endl;
+        if (impostorTotal > 0.0)
+        {
+            double vertices = (visibleTotal * CUBE_VERTICES + impostorTotal) / frames;
+            double meshOnly = (visibleTotal + impostorTotal) * CUBE_VERTICES / frames;
+            std::cout << "level of detail: " << impostorTotal / frames << " impostors, " << vertices << " vertices instead of "
+                      << meshOnly << " per frame (" << 100.0 * (meshOnly - vertices) / meshOnly << "% saved)" << std::endl;
+        }
+        if (shadingTimer.AverageMs() > 0.0)
+            std::cout << "forward:  shading " << shadingTimer.AverageMs() << " ms, overdraw " << shadingSamples.Average() / pixels
+                      << std::endl;
+        if (geometryTimer.AverageMs() > 0.0)
+            std::cout << "deferred: geometry " << geometryTimer.AverageMs() << " ms, lighting " << lightingTimer.AverageMs()
+                      << " ms, light volumes " << volumeTimer.AverageMs() << " ms, overdraw "
+                      << geometrySamples.Average() / pixels << ", light fragments/pixel " << volumeSamples.Average() / pixels
+                      << std::endl;
+    }
+    if (replaying)
+        replayStats.Print(cameraHash());
+    recorder.Close();
 
     // cleanup
     glDeleteVertexArrays(1, &cubeVAO);
+    glDeleteVertexArrays(1, &culledVAO);
+    glDeleteVertexArrays(1, &impostorVAO);
+    glDeleteVertexArrays(1, &farImpostorVAO);
     glDeleteVertexArrays(1, &lightCubeVAO);
     glDeleteBuffers(1, &cubeVBO);
     glDeleteBuffers(1, &instanceVBO);
@@ -296,13 +801,61 @@ int main()
 }
 
 // input & callbacks
-void processInput(GLFWwindow* window)
+// this frame's keys plus the mouse movement gathered since the last poll
+InputFrame pollInput(GLFWwindow* window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) glfwSetWindowShouldClose(window, true);
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) camera.ProcessKeyboard(FORWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) camera.ProcessKeyboard(BACKWARD, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) camera.ProcessKeyboard(LEFT, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) camera.ProcessKeyboard(RIGHT, deltaTime);
+    InputFrame input = pendingInput;
+    pendingInput = InputFrame();
+    input.time = (float)glfwGetTime();
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) input.keys |= INPUT_KEY_W;
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) input.keys |= INPUT_KEY_S;
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) input.keys |= INPUT_KEY_A;
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) input.keys |= INPUT_KEY_D;
+    if (glfwGetKey(window, GLFW_KEY_TAB) == GLFW_PRESS) input.keys |= INPUT_KEY_TAB;
+    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS) input.keys |= INPUT_KEY_C;
+    if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS) input.keys |= INPUT_KEY_L;
+    return input;
+}
+
+void processInput(const InputFrame& input)
+{
+    if (input.keys & INPUT_KEY_W) camera.ProcessKeyboard(FORWARD, deltaTime);
+    if (input.keys & INPUT_KEY_S) camera.ProcessKeyboard(BACKWARD, deltaTime);
+    if (input.keys & INPUT_KEY_A) camera.ProcessKeyboard(LEFT, deltaTime);
+    if (input.keys & INPUT_KEY_D) camera.ProcessKeyboard(RIGHT, deltaTime);
+    if (input.mouseX != 0.0f || input.mouseY != 0.0f) camera.ProcessMouseMovement(input.mouseX, -input.mouseY);
+    if (input.scroll != 0.0f) camera.ProcessMouseScroll(input.scroll);
+    if ((input.keys & INPUT_KEY_TAB) && !(previousKeys & INPUT_KEY_TAB)) deferredShading = !deferredShading;
+    if ((input.keys & INPUT_KEY_C) && !(previousKeys & INPUT_KEY_C)) cullMode = (CullMode)((cullMode + 1) % 3);
+    if ((input.keys & INPUT_KEY_L) && !(previousKeys & INPUT_KEY_L)) lodEnabled = !lodEnabled;
+    previousKeys = input.keys;
+}
+
+LightUniforms findLightUniforms(const ReflectedShader& shader, const std::string& name)
+{
+    LightUniforms light;
+    light.position = shader.Find<glm::vec3>(name + ".position");
+    light.direction = shader.Find<glm::vec3>(name + ".direction");
+    light.ambient = shader.Find<glm::vec3>(name + ".ambient");
+    light.diffuse = shader.Find<glm::vec3>(name + ".diffuse");
+    light.specular = shader.Find<glm::vec3>(name + ".specular");
+    light.constant = shader.Find<float>(name + ".constant");
+    light.linear = shader.Find<float>(name + ".linear");
+    light.quadratic = shader.Find<float>(name + ".quadratic");
+    light.cutOff = shader.Find<float>(name + ".cutOff");
+    light.outerCutOff = shader.Find<float>(name + ".outerCutOff");
+    return light;
+}
+
+uint64_t cameraHash()
+{
+    StateHash hash;
+    hash.Add(camera.Position);
+    hash.Add(camera.Yaw);
+    hash.Add(camera.Pitch);
+    hash.Add(camera.Zoom);
+    return hash.Value();
 }
 
 void framebuffer_size_callback(GLFWwindow* /*window*/, int width, int height)
@@ -317,12 +870,13 @@ void mouse_callback(GLFWwindow* /*window*/, double xposIn, double yposIn)
     float xoffset = xpos - lastX;
     float yoffset = lastY - ypos;
     lastX = xpos; lastY = ypos;
-    camera.ProcessMouseMovement(xoffset, yoffset);
+    pendingInput.mouseX += xoffset;
+    pendingInput.mouseY -= yoffset; // stored in screen direction, y down
 }
 
 void scroll_callback(GLFWwindow* /*window*/, double /*xoffset*/, double yoffset)
 {
-    camera.ProcessMouseScroll((float)yoffset);
+    pendingInput.scroll += (float)yoffset;
 }
 
 // trivial texture loader (not used in current shaders, but kept)
@@ -0,0 +1,174 @@
+// vertex_bench.h
+// --vertex-bench: GPU time of the cube field's vertex work at growing grid
+// sizes, per-vertex animation (6.multiple_lights.vs) against the per-instance
+// pass plus the slim cube shader (6.instance_update.vs + 6.cube_field.vs).
+// Both also run procedurally, with the inputs computed from the index instead
+// of read from the instance buffer. Draws run with the rasteriser off, so only
+// vertex processing is timed.
+// Runs in a hidden window after the shaders are loaded, since it needs GL.
+//
+//   --vertex-bench [options]
+//       --frames N       frames timed per grid size and path (default 200)
+//       --max-grid N     largest grid side (default 1000)
+//
+// Prints CSV: grid side, instances, what the instance buffer costs (size in
+// MB, CPU build and upload+finish in ms; procedural mode skips all three),
+// then milliseconds per frame for the per-vertex draw from the buffer and
+// procedural, the instance pass from the buffer and procedural, the slim
+// draw, the buffer pass plus slim draw, and the per-vertex time divided by that.
+
+#ifndef VERTEX_BENCH_H
+#define VERTEX_BENCH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+
+#include "instance_update.h"
+#include "../common/frame_constants.h"
+#include "../common/gpu_timer.h"
+#include "../common/job_system.h"
+#include "../common/shader_reflect.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// setCubeField(shader, uniforms) sends the demo's animation parameters.
+template <typename SetCubeField>
+int runVertexBench(int argc, char** argv, unsigned int cubeVBO, FrameConstantsBuffer& frameConstants,
+                   const glm::mat4& view, const glm::mat4& projection, const glm::vec3& eye, float spacing,
+                   JobSystem& jobs, const SetCubeField& setCubeField)
+{
+    unsigned int frames = 200;
+    unsigned int maxGrid = 1000;
+    for (int i = 2; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (hasValue && std::strcmp(argv[i], "--frames") == 0) frames = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else if (hasValue && std::strcmp(argv[i], "--max-grid") == 0) maxGrid = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            std::cout << "Unknown vertex-bench option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (frames == 0)
+        frames = 1;
+
+    // procedural variants are separate programs, so each keeps its own uniform cache
+    Shader perVertexShader("6.multiple_lights.vs", "6.gbuffer.fs");
+    Shader perVertexProceduralShader("6.multiple_lights.vs", "6.gbuffer.fs");
+    Shader slimShader("6.cube_field.vs", "6.gbuffer.fs");
+    InstanceAnimator animator, proceduralAnimator;
+    if (!animator.Load("6.instance_update.vs") || !proceduralAnimator.Load("6.instance_update.vs"))
+        return -1;
+    frameConstants.Attach(perVertexShader.ID);
+    frameConstants.Attach(perVertexProceduralShader.ID);
+    frameConstants.Attach(slimShader.ID);
+    frameConstants.Attach(animator.ID);
+    frameConstants.Attach(proceduralAnimator.ID);
+    ReflectedShader perVertex(perVertexShader.ID), perVertexProcedural(perVertexProceduralShader.ID), slim(slimShader.ID),
+        update(animator.ID), proceduralUpdate(proceduralAnimator.ID);
+    CubeFieldUniforms perVertexU, perVertexProceduralU, slimU, updateU, proceduralUpdateU;
+    perVertexU.Find(perVertex);
+    perVertexProceduralU.Find(perVertexProcedural);
+    slimU.Find(slim);
+    updateU.Find(update);
+    proceduralUpdateU.Find(proceduralUpdate);
+    InstanceSourceUniforms perVertexProceduralSourceU, proceduralUpdateSourceU;
+    perVertexProceduralSourceU.Find(perVertexProcedural);
+    proceduralUpdateSourceU.Find(proceduralUpdate);
+
+    unsigned int instanceVBO;
+    glGenBuffers(1, &instanceVBO);
+    unsigned int perVertexVAO = createCubeVAO(cubeVBO);
+    unsigned int proceduralVAO = createCubeVAO(cubeVBO); // no per-instance attribute at all
+    unsigned int slimVAO = createCubeVAO(cubeVBO);
+    glEnable(GL_RASTERIZER_DISCARD);
+
+    std::cout << "grid,instances,buffer_mb,build_ms,upload_ms,per_vertex_ms,per_vertex_procedural_ms,instance_pass_ms,"
+                 "procedural_pass_ms,slim_draw_ms,precomputed_ms,speedup\n";
+    const unsigned int grids[] = { 120, 250, 500, 750, 1000, 1500, 2000 };
+    for (unsigned int grid : grids)
+    {
+        if (grid > maxGrid)
+            break;
+        unsigned int count = grid * grid;
+        auto buildStart = std::chrono::steady_clock::now();
+        CubeFieldTiles tiles;
+        tiles.Build(grid);
+        std::vector<float> instanceData = buildCubeFieldInstances(tiles, spacing, jobs);
+        auto buildEnd = std::chrono::steady_clock::now();
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, instanceData.size() * sizeof(float), instanceData.data(), GL_STATIC_DRAW);
+        glFinish();
+        auto uploadEnd = std::chrono::steady_clock::now();
+        animator.SetSource(instanceVBO, count);
+        proceduralAnimator.SetSource(0, count);
+        bindCubeInstanceAttribute(perVertexVAO, instanceVBO, 4);
+        bindCubeInstanceAttribute(slimVAO, animator.Output(), 3);
+
+        GpuTimer perVertexTimer, perVertexProceduralTimer, updateTimer, proceduralUpdateTimer, slimTimer;
+        for (unsigned int f = 0; f < frames; ++f)
+        {
+            frameConstants.Update(view, projection, eye, f / 60.0f);
+
+            perVertexShader.use();
+            setCubeField(perVertex, perVertexU);
+            glBindVertexArray(perVertexVAO);
+            perVertexTimer.Begin();
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 36, count);
+            perVertexTimer.End();
+
+            perVertexProceduralShader.use();
+            setCubeField(perVertexProcedural, perVertexProceduralU);
+            perVertexProceduralSourceU.Set(perVertexProcedural, true, grid, spacing);
+            glBindVertexArray(proceduralVAO);
+            perVertexProceduralTimer.Begin();
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 36, count);
+            perVertexProceduralTimer.End();
+
+            glUseProgram(proceduralAnimator.ID);
+            setCubeField(proceduralUpdate, proceduralUpdateU);
+            proceduralUpdateSourceU.Set(proceduralUpdate, true, grid, spacing);
+            proceduralUpdateTimer.Begin();
+            proceduralAnimator.Update();
+            proceduralUpdateTimer.End();
+
+            glUseProgram(animator.ID);
+            setCubeField(update, updateU);
+            updateTimer.Begin();
+            animator.Update();
+            updateTimer.End();
+            glEnable(GL_RASTERIZER_DISCARD); // Update() switched it back off
+
+            slimShader.use();
+            setCubeField(slim, slimU);
+            glBindVertexArray(slimVAO);
+            slimTimer.Begin();
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 36, count);
+            slimTimer.End();
+        }
+        double precomputed = updateTimer.AverageMs() + slimTimer.AverageMs();
+        std::cout << grid << ',' << count << ',' << instanceData.size() * sizeof(float) / (1024.0 * 1024.0) << ','
+                  << std::chrono::duration<double, std::milli>(buildEnd - buildStart).count() << ','
+                  << std::chrono::duration<double, std::milli>(uploadEnd - buildEnd).count() << ','
+                  << perVertexTimer.AverageMs() << ',' << perVertexProceduralTimer.AverageMs() << ','
+                  << updateTimer.AverageMs() << ',' << proceduralUpdateTimer.AverageMs() << ','
+                  << slimTimer.AverageMs() << ',' << precomputed << ','
+                  << (precomputed > 0.0 ? perVertexTimer.AverageMs() / precomputed : 0.0) << '\n';
+    }
+
+    glDisable(GL_RASTERIZER_DISCARD);
+    glDeleteVertexArrays(1, &perVertexVAO);
+    glDeleteVertexArrays(1, &proceduralVAO);
+    glDeleteVertexArrays(1, &slimVAO);
+    glDeleteBuffers(1, &instanceVBO);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,282 @@
+// asset_loader.h
+// Loading job graph shared by the demos.
+//
+// Every asset is a job with up to two steps:
+//   decode  runs on a worker thread: file reads, image decoding, assimp
+//           imports, anything that does not touch GL
+//   upload  runs on the thread that called Run(), which owns the GL context:
+//           creating GL objects and uploading the decoded data
+// A job starts once the jobs it was added after have finished both steps.
+// Jobs without a decode step (e.g. learnopengl's Model, which talks to GL in
+// its constructor) run entirely on the context thread, while the workers keep
+// decoding everything else in parallel. Launch time is then close to the
+// slowest chain of dependent jobs instead of the sum of all of them.
+//
+// stb_image's flip flag is global: set it once before Run() and leave it
+// alone until Run() returns. Jobs that need the other orientation pass
+// flipRows to decodeImage.
+
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct DecodedImage
+{
+    unsigned char* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+};
+
+// Decode an image file; flipRows flips it vertically relative to what the
+// global stb flag produced. Safe to call from worker threads. A missing or
+// broken texture is not fatal: it is logged and image is left empty (no
+// pixels) for the upload to skip, so the job still succeeds.
+inline bool decodeImage(const std::string& path, DecodedImage& image, bool flipRows = false)
+{
+    image.pixels = stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0);
+    if (!image.pixels)
+    {
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+        image = DecodedImage();
+        return true;
+    }
+    if (flipRows)
+    {
+        const size_t rowBytes = (size_t)image.width * image.channels;
+        std::vector<unsigned char> row(rowBytes);
+        for (int y = 0; y < image.height / 2; ++y)
+        {
+            unsigned char* a = image.pixels + (size_t)y * rowBytes;
+            unsigned char* b = image.pixels + (size_t)(image.height - 1 - y) * rowBytes;
+            std::memcpy(row.data(), a, rowBytes);
+            std::memcpy(a, b, rowBytes);
+            std::memcpy(b, row.data(), rowBytes);
+        }
+    }
+    return true;
+}
+
+inline void freeImage(DecodedImage& image)
+{
+    stbi_image_free(image.pixels);
+    image.pixels = nullptr;
+}
+
+inline GLenum imageFormat(const DecodedImage& image)
+{
+    if (image.channels == 1) return GL_RED;
+    if (image.channels == 4) return GL_RGBA;
+    return GL_RGB;
+}
+
+class AssetLoader
+{
+public:
+    // done, total, name of the job that just finished
+    using ProgressFn = std::function<void(int, int, const std::string&)>;
+
+    // workerCount 0 picks one worker per hardware thread besides the caller's
+    explicit AssetLoader(unsigned int workerCount = 0)
+        : workerCount(workerCount) {}
+
+    // Add a job and return its id. decode and upload may each be empty and
+    // return false on failure; after lists ids of jobs that must be complete
+    // first (only earlier ids, so the graph can never have a cycle).
+    int Add(const std::string& name, std::function<bool()> decode, std::function<bool()> upload,
+            const std::vector<int>& after = {})
+    {
+        int id = (int)jobs.size();
+        jobs.emplace_back();
+        Job& job = jobs.back();
+        job.name = name;
+        job.decode = std::move(decode);
+        job.upload = std::move(upload);
+        for (int dep : after)
+        {
+            if (dep < 0 || dep >= id)
+            {
+                std::cout << "Asset job " << name << " depends on unknown job " << dep << std::endl;
+                continue;
+            }
+            jobs[dep].dependents.push_back(id);
+            ++job.waitingFor;
+        }
+        return id;
+    }
+
+    void OnProgress(ProgressFn fn) { progress = std::move(fn); }
+
+    // Run every job; blocks until all are done. The calling thread does the
+    // uploads, so it must own the GL context. Returns false if any job
+    // failed; jobs that depend on a failed job are skipped.
+    bool Run()
+    {
+        runStart = std::chrono::steady_clock::now();
+        unsigned int threads = workerCount;
+        if (threads == 0)
+        {
+            unsigned int hw = std::thread::hardware_concurrency();
+            threads = hw > 1 ? hw - 1 : 1;
+        }
+
+        stopping = false;
+        std::vector<std::thread> workers;
+        for (unsigned int i = 0; i < threads; ++i)
+            workers.emplace_back([this]() { workerLoop(); });
+
+        for (int id = 0; id < (int)jobs.size(); ++id)
+            if (jobs[id].waitingFor == 0)
+                schedule(id);
+
+        int finished = 0;
+        bool ok = true;
+        while (finished < (int)jobs.size())
+        {
+            int id;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                uploadReady.wait(lock, [this]() { return !uploadQueue.empty(); });
+                id = uploadQueue.front();
+                uploadQueue.pop_front();
+            }
+
+            Job& job = jobs[id];
+            if (!job.failed && job.upload)
+            {
+                auto t0 = std::chrono::steady_clock::now();
+                job.failed = !job.upload();
+                job.uploadMs = msSince(t0);
+            }
+            job.finishedAt = msSince(runStart);
+            ok = ok && !job.failed;
+            ++finished;
+            if (progress)
+                progress(finished, (int)jobs.size(), job.name);
+
+            for (int dependent : job.dependents)
+            {
+                jobs[dependent].failed = jobs[dependent].failed || job.failed;
+                if (--jobs[dependent].waitingFor == 0)
+                    schedule(dependent);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        decodeReady.notify_all();
+        for (std::thread& t : workers)
+            t.join();
+
+        totalMs = msSince(runStart);
+        return ok;
+    }
+
+    // Per-asset timings of the last Run(), plus the wall time against the
+    // time the same work would have taken back to back.
+    void PrintTimings() const
+    {
+        double serialMs = 0.0;
+        std::cout << "asset,decode_ms,upload_ms,finished_at_ms" << std::endl;
+        for (const Job& job : jobs)
+        {
+            serialMs += job.decodeMs + job.uploadMs;
+            std::cout << job.name << "," << job.decodeMs << "," << job.uploadMs << "," << job.finishedAt
+                      << (job.failed ? ",FAILED" : "") << std::endl;
+        }
+        std::cout << "Loaded " << jobs.size() << " assets in " << totalMs << " ms (" << serialMs
+                  << " ms of work)" << std::endl;
+    }
+
+private:
+    struct Job
+    {
+        std::string name;
+        std::function<bool()> decode;
+        std::function<bool()> upload;
+        std::vector<int> dependents;
+        int waitingFor = 0;
+        bool failed = false;
+        double decodeMs = 0.0;
+        double uploadMs = 0.0;
+        double finishedAt = 0.0;
+    };
+
+    std::vector<Job> jobs; // only grows before Run(), so references stay valid while it runs
+    unsigned int workerCount;
+    ProgressFn progress;
+    std::chrono::steady_clock::time_point runStart;
+    double totalMs = 0.0;
+
+    std::mutex mutex;
+    std::condition_variable decodeReady;
+    std::condition_variable uploadReady;
+    std::deque<int> decodeQueue;
+    std::deque<int> uploadQueue;
+    bool stopping = false;
+
+    static double msSince(std::chrono::steady_clock::time_point t)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t).count();
+    }
+
+    // jobs with nothing to decode (or already failed) go straight to the upload step
+    void schedule(int id)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (jobs[id].decode && !jobs[id].failed)
+        {
+            decodeQueue.push_back(id);
+            decodeReady.notify_one();
+        }
+        else
+        {
+            uploadQueue.push_back(id);
+            uploadReady.notify_one();
+        }
+    }
+
+    void workerLoop()
+    {
+        for (;;)
+        {
+            int id;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                decodeReady.wait(lock, [this]() { return stopping || !decodeQueue.empty(); });
+                if (decodeQueue.empty())
+                    return;
+                id = decodeQueue.front();
+                decodeQueue.pop_front();
+            }
+
+            Job& job = jobs[id];
+            auto t0 = std::chrono::steady_clock::now();
+            bool decoded = job.decode();
+            double ms = msSince(t0);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            job.decodeMs = ms;
+            job.failed = !decoded;
+            uploadQueue.push_back(id);
+            uploadReady.notify_one();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,140 @@
+// fixed_step.h
+// Fixed-timestep simulation on a dedicated thread, shared by the demos.
+//
+// FixedStepThread calls a step function at a fixed rate, independent of how
+// fast the render loop runs. After each step the simulation publishes a
+// snapshot through a SnapshotExchange; the render thread picks up the newest
+// one and interpolates between the previous and current state it contains
+// using InterpolationAlpha(). Rendering is therefore one step behind the
+// simulation, which is what keeps motion smooth at any display rate.
+
+#ifndef FIXED_STEP_H
+#define FIXED_STEP_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+inline double fixedStepNow()
+{
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Triple buffer: the writer always has a slot to fill, the reader always has a
+// stable slot to read, and the newest finished slot sits in between. Neither
+// side ever waits for the other beyond a pointer swap.
+template <typename T>
+class SnapshotExchange
+{
+public:
+    // Slot the simulation thread fills before calling Publish().
+    T& WriteSlot() { return slots[writeIndex]; }
+
+    void Publish()
+    {
+        stamps[writeIndex] = fixedStepNow();
+        std::lock_guard<std::mutex> lock(mutex);
+        std::swap(writeIndex, readyIndex);
+        fresh = true;
+    }
+
+    // Swap in the newest published snapshot if there is one. Returns false if
+    // nothing new arrived since the last call; ReadSlot() stays valid either way.
+    bool Acquire()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!fresh)
+            return false;
+        std::swap(readIndex, readyIndex);
+        fresh = false;
+        return true;
+    }
+
+    const T& ReadSlot() const { return slots[readIndex]; }
+
+    // Wall-clock time at which ReadSlot() was published.
+    double ReadStamp() const { return stamps[readIndex]; }
+
+    // Blend factor between the previous and current state in ReadSlot().
+    float InterpolationAlpha(double stepSeconds) const
+    {
+        double a = (fixedStepNow() - stamps[readIndex]) / stepSeconds;
+        return a < 0.0 ? 0.0f : (a > 1.0 ? 1.0f : (float)a);
+    }
+
+private:
+    T slots[3];
+    double stamps[3] = { 0.0, 0.0, 0.0 };
+    int writeIndex = 0;
+    int readyIndex = 1;
+    int readIndex = 2;
+    bool fresh = false;
+    std::mutex mutex;
+};
+
+class FixedStepThread
+{
+public:
+    // step is called with stepSeconds every tick from the simulation thread.
+    // maxCatchUpSteps bounds how many ticks are run back to back after a
+    // stall before the clock is reset instead (avoids a spiral of death).
+    FixedStepThread(double stepSeconds, std::function<void(float)> step, int maxCatchUpSteps = 5)
+        : stepSeconds(stepSeconds), step(std::move(step)), maxCatchUpSteps(maxCatchUpSteps) {}
+
+    ~FixedStepThread() { Stop(); }
+
+    FixedStepThread(const FixedStepThread&) = delete;
+    FixedStepThread& operator=(const FixedStepThread&) = delete;
+
+    double StepSeconds() const { return stepSeconds; }
+    unsigned long long Ticks() const { return ticks.load(std::memory_order_relaxed); }
+
+    void Start()
+    {
+        if (running.exchange(true))
+            return;
+        worker = std::thread([this]() { run(); });
+    }
+
+    void Stop()
+    {
+        if (!running.exchange(false))
+            return;
+        if (worker.joinable())
+            worker.join();
+    }
+
+private:
+    double stepSeconds;
+    std::function<void(float)> step;
+    int maxCatchUpSteps;
+    std::atomic<bool> running{ false };
+    std::atomic<unsigned long long> ticks{ 0 };
+    std::thread worker;
+
+    void run()
+    {
+        double next = fixedStepNow();
+        while (running.load())
+        {
+            int steps = 0;
+            while (fixedStepNow() >= next && steps < maxCatchUpSteps)
+            {
+                step((float)stepSeconds);
+                ticks.fetch_add(1, std::memory_order_relaxed);
+                next += stepSeconds;
+                ++steps;
+            }
+            if (steps == maxCatchUpSteps)
+                next = fixedStepNow(); // too far behind, drop the backlog
+
+            std::this_thread::sleep_until(std::chrono::steady_clock::time_point(
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(next))));
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,90 @@
+// frame_constants.h
+// Per-frame camera constants in one uniform buffer, shared by every program.
+//
+// View, projection, their product, the camera position and the time are
+// written once per frame into a std140 block bound at a fixed binding point.
+// Every shader declares the matching "FrameConstants" block, so switching
+// programs no longer means re-sending the same matrices to each of them.
+// GL 3.3 has no layout(binding = N) in GLSL, so each program is pointed at
+// the binding point once with Attach().
+//
+// GLSL side (keep in sync with FrameConstants below):
+//   layout (std140) uniform FrameConstants
+//   {
+//       mat4 view;
+//       mat4 projection;
+//       mat4 viewProjection;
+//       vec3 cameraPosition;
+//       float time;
+//   };
+//
+// std140 places the float right after the vec3, in the same 16 bytes, which
+// is what the C++ struct does too.
+
+#ifndef FRAME_CONSTANTS_H
+#define FRAME_CONSTANTS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <iostream>
+
+struct FrameConstants
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec3 cameraPosition;
+    float time;
+};
+
+static_assert(offsetof(FrameConstants, cameraPosition) == 192 && offsetof(FrameConstants, time) == 204
+              && sizeof(FrameConstants) == 208, "FrameConstants must match the std140 block");
+
+class FrameConstantsBuffer
+{
+public:
+    static const unsigned int BINDING = 1; // 0 is the bone palette
+
+    unsigned int ID = 0;
+
+    FrameConstantsBuffer()
+    {
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstants), NULL, GL_STREAM_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, ID);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    FrameConstantsBuffer(const FrameConstantsBuffer&) = delete;
+    FrameConstantsBuffer& operator=(const FrameConstantsBuffer&) = delete;
+
+    // Point the program's FrameConstants block at our binding point. A program
+    // whose shaders never read the block has none, which is not an error.
+    void Attach(unsigned int program) const
+    {
+        unsigned int index = glGetUniformBlockIndex(program, "FrameConstants");
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(program, index, BINDING);
+    }
+
+    // Write this frame's constants (orphaning last frame's storage). Call once
+    // per frame before the first draw; every attached program sees them.
+    void Update(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& cameraPosition, float time)
+    {
+        FrameConstants constants;
+        constants.view = view;
+        constants.projection = projection;
+        constants.viewProjection = projection * view;
+        constants.cameraPosition = cameraPosition;
+        constants.time = time;
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstants), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameConstants), &constants);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+};
+
+#endif
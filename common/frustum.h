@@ -0,0 +1,63 @@
+// frustum.h
+// View frustum planes pulled out of a projection * view matrix, for cheap
+// CPU visibility tests of bounding spheres and boxes.
+
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+enum FrustumTest
+{
+    FRUSTUM_OUTSIDE,
+    FRUSTUM_INTERSECTS,
+    FRUSTUM_INSIDE,
+};
+
+struct Frustum
+{
+    glm::vec4 planes[6]; // xyz = inward normal, w = distance; left, right, bottom, top, near, far
+
+    // Gribb/Hartmann: each plane is the fourth row of viewProjection plus or
+    // minus one of the other rows.
+    void Extract(const glm::mat4& viewProjection)
+    {
+        const glm::mat4& m = viewProjection;
+        for (int i = 0; i < 3; ++i)
+        {
+            planes[i * 2]     = glm::vec4(m[0][3] + m[0][i], m[1][3] + m[1][i], m[2][3] + m[2][i], m[3][3] + m[3][i]);
+            planes[i * 2 + 1] = glm::vec4(m[0][3] - m[0][i], m[1][3] - m[1][i], m[2][3] - m[2][i], m[3][3] - m[3][i]);
+        }
+        for (glm::vec4& p : planes)
+            p /= std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+    }
+
+    bool SphereVisible(const glm::vec3& center, float radius) const
+    {
+        for (const glm::vec4& p : planes)
+            if (p.x * center.x + p.y * center.y + p.z * center.z + p.w < -radius)
+                return false;
+        return true;
+    }
+
+    // Axis-aligned box given by its centre and half size. Inside means every
+    // corner is inside, which lets a hierarchy accept whole subtrees.
+    FrustumTest TestBox(const glm::vec3& center, const glm::vec3& extent) const
+    {
+        FrustumTest result = FRUSTUM_INSIDE;
+        for (const glm::vec4& p : planes)
+        {
+            float distance = p.x * center.x + p.y * center.y + p.z * center.z + p.w;
+            float reach = std::abs(p.x) * extent.x + std::abs(p.y) * extent.y + std::abs(p.z) * extent.z;
+            if (distance < -reach)
+                return FRUSTUM_OUTSIDE;
+            if (distance < reach)
+                result = FRUSTUM_INTERSECTS;
+        }
+        return result;
+    }
+};
+
+#endif
@@ -0,0 +1,75 @@
+// gpu_timer.h
+// GPU-side measurements of a stretch of GL commands: elapsed time
+// (GL_TIME_ELAPSED) and fragments that passed the depth test (GL_SAMPLES_PASSED).
+//
+// A query's result is only ready once the GPU has caught up, so each counter
+// keeps a small ring of queries and reads the one issued LATENCY frames ago;
+// reading this frame's result would stall the CPU until the GPU is idle.
+// Begin/End pairs of the same kind must not nest (GL allows one active query
+// per target), but a timer and a sample counter may overlap.
+
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+class GpuQueryRing
+{
+public:
+    static const int LATENCY = 3;
+
+    explicit GpuQueryRing(GLenum target) : target(target) { glGenQueries(LATENCY, queries); }
+
+    GpuQueryRing(const GpuQueryRing&) = delete;
+    GpuQueryRing& operator=(const GpuQueryRing&) = delete;
+
+    void Begin() { glBeginQuery(target, queries[frame % LATENCY]); }
+
+    // Ends this frame's query and collects the one from LATENCY frames ago.
+    void End()
+    {
+        glEndQuery(target);
+        ++frame;
+        if (frame < LATENCY)
+            return;
+        GLuint64 value = 0;
+        glGetQueryObjectui64v(queries[frame % LATENCY], GL_QUERY_RESULT, &value);
+        last = (double)value;
+        total += last;
+        ++samples;
+    }
+
+    void ResetAverage() { total = 0.0; samples = 0; }
+
+protected:
+    double last = 0.0;
+    double total = 0.0;
+    unsigned long long samples = 0;
+
+private:
+    GLenum target;
+    GLuint queries[LATENCY];
+    unsigned long long frame = 0;
+};
+
+class GpuTimer : public GpuQueryRing
+{
+public:
+    GpuTimer() : GpuQueryRing(GL_TIME_ELAPSED) {}
+
+    double LastMs() const { return last * 1e-6; }
+    double AverageMs() const { return samples ? total * 1e-6 / samples : 0.0; }
+};
+
+// Fragments that passed the depth test; divided by the pixel count this is
+// the overdraw of the measured draws.
+class GpuSampleCounter : public GpuQueryRing
+{
+public:
+    GpuSampleCounter() : GpuQueryRing(GL_SAMPLES_PASSED) {}
+
+    double Last() const { return last; }
+    double Average() const { return samples ? total / samples : 0.0; }
+};
+
+#endif
@@ -0,0 +1,344 @@
+// input_replay.h
+// Input recording and replay, shared by the demos, so two builds can be
+// profiled on exactly the same session.
+//
+// Each rendered frame the demo turns what GLFW reported into an InputFrame:
+// when it happened, which of the watched keys were down, and how far the
+// mouse and wheel moved since the last frame. With --record FILE those frames
+// go to a small binary log, after a header holding the RNG seed, the
+// simulation step and the demo's scenario flags. With --replay FILE the demo
+// reads its frames from the log instead of GLFW, seeds its generator from the
+// header, and advances its simulation by the log's fixed step according to
+// the recorded timestamps, so every replay of a log does the same work in the
+// same order. --headless
+// replays without opening a window. At the end the demo prints frame-time
+// statistics and a hash of its final state; equal hashes mean the two runs
+// simulated the same session.
+//
+// The scenario is a list of key=value words (see InputScenario). On replay the
+// demo compares it with its own flags: a different workload (crowd size,
+// level, grid, light count) is refused, since its timings and hash would mean
+// nothing; a different implementation choice (worker count, cull mode, LOD)
+// is only reported, as comparing those on one session is what replays are for.
+//
+// Log layout (little endian, as written by the machine that recorded it):
+//   InputLogHeader, then frameCount x InputFrame
+
+#ifndef INPUT_REPLAY_H
+#define INPUT_REPLAY_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// keys the demos watch, one bit each in InputFrame::keys
+enum InputKeyBit
+{
+    INPUT_KEY_W = 1 << 0,
+    INPUT_KEY_A = 1 << 1,
+    INPUT_KEY_S = 1 << 2,
+    INPUT_KEY_D = 1 << 3,
+    INPUT_KEY_J = 1 << 4,
+    INPUT_MOUSE_LEFT = 1 << 5,
+    INPUT_KEY_TAB = 1 << 6,
+    INPUT_KEY_C = 1 << 7,
+    INPUT_KEY_L = 1 << 8,
+};
+
+struct InputFrame
+{
+    float time = 0.0f;   // seconds since the window opened
+    uint32_t keys = 0;   // InputKeyBit flags held down this frame
+    float mouseX = 0.0f; // cursor movement since the previous frame, in pixels
+    float mouseY = 0.0f;
+    float scroll = 0.0f; // wheel movement since the previous frame
+};
+
+struct InputLogHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t seed;       // what the demo seeded its generator with
+    float step;          // fixed simulation step in seconds, 0 if the demo has none
+    uint32_t frameCount;
+    char scenario[256];  // InputScenario text, NUL padded
+};
+
+const char INPUT_LOG_MAGIC[4] = { 'I', 'N', 'P', 'T' };
+const uint32_t INPUT_LOG_VERSION = 2;
+
+// The flags a run was started with that change what it simulates or draws,
+// as "key=value" words in a fixed order. Values are the parsed settings, not
+// the raw arguments, so a default and its explicit spelling compare equal.
+class InputScenario
+{
+public:
+    template <typename T>
+    InputScenario& Add(const char* key, const T& value)
+    {
+        std::ostringstream word;
+        word << key << "=" << value;
+        if (!text.empty())
+            text += " ";
+        text += word.str();
+        return *this;
+    }
+
+    const std::string& Text() const { return text; }
+
+private:
+    std::string text;
+};
+
+// --record FILE, --replay FILE and --headless, shared by the demos.
+struct InputOptions
+{
+    std::string recordPath;
+    std::string replayPath;
+    bool headless = false;
+};
+
+inline InputOptions parseInputOptions(int argc, char** argv)
+{
+    InputOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--headless") == 0)
+            options.headless = true;
+        else if (i + 1 < argc && std::strcmp(argv[i], "--record") == 0)
+            options.recordPath = argv[++i];
+        else if (i + 1 < argc && std::strcmp(argv[i], "--replay") == 0)
+            options.replayPath = argv[++i];
+    }
+    return options;
+}
+
+class InputRecorder
+{
+public:
+    ~InputRecorder() { Close(); }
+
+    bool Open(const std::string& path, uint32_t seed, float step, const InputScenario& scenario = InputScenario())
+    {
+        if (scenario.Text().size() >= sizeof(header.scenario))
+        {
+            std::cout << "ERROR::INPUT_RECORD: scenario too long for the log header: " << scenario.Text() << std::endl;
+            return false;
+        }
+        file.open(path, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            std::cout << "ERROR::INPUT_RECORD: cannot write " << path << std::endl;
+            return false;
+        }
+        std::memcpy(header.magic, INPUT_LOG_MAGIC, 4);
+        header.version = INPUT_LOG_VERSION;
+        header.seed = seed;
+        header.step = step;
+        header.frameCount = 0;
+        std::memset(header.scenario, 0, sizeof(header.scenario));
+        std::memcpy(header.scenario, scenario.Text().data(), scenario.Text().size());
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        return true;
+    }
+
+    bool IsOpen() const { return file.is_open(); }
+
+    void Record(const InputFrame& frame)
+    {
+        if (!file.is_open())
+            return;
+        file.write(reinterpret_cast<const char*>(&frame), sizeof(frame));
+        ++header.frameCount;
+    }
+
+    // Patch the frame count into the header and close the log.
+    bool Close()
+    {
+        if (!file.is_open())
+            return true;
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        bool ok = (bool)file;
+        file.close();
+        if (ok)
+            std::cout << "Recorded " << header.frameCount << " frames of input" << std::endl;
+        return ok;
+    }
+
+private:
+    std::ofstream file;
+    InputLogHeader header = {};
+};
+
+class InputReplay
+{
+public:
+    bool Load(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header))
+            || std::memcmp(header.magic, INPUT_LOG_MAGIC, 4) != 0 || header.version != INPUT_LOG_VERSION)
+        {
+            std::cout << "ERROR::INPUT_REPLAY: " << path << " is not an input log" << std::endl;
+            return false;
+        }
+        frames.resize(header.frameCount);
+        if (!file.read(reinterpret_cast<char*>(frames.data()), (std::streamsize)(frames.size() * sizeof(InputFrame))))
+        {
+            std::cout << "ERROR::INPUT_REPLAY: " << path << " is truncated" << std::endl;
+            return false;
+        }
+        next = 0;
+        return true;
+    }
+
+    // The next recorded frame; false once the log is used up.
+    bool Next(InputFrame& frame)
+    {
+        if (next >= frames.size())
+            return false;
+        frame = frames[next++];
+        return true;
+    }
+
+    uint32_t Seed() const { return header.seed; }
+    float Step() const { return header.step; }
+    size_t FrameCount() const { return frames.size(); }
+    std::string Scenario() const
+    {
+        const char* end = std::find(header.scenario, header.scenario + sizeof(header.scenario), '\0');
+        return std::string(header.scenario, end);
+    }
+
+    // Compare the recorded scenario with this run's. Every difference is
+    // printed; false if any key outside reportOnly differs, and the replay
+    // should not run.
+    bool MatchesScenario(const InputScenario& current, std::initializer_list<const char*> reportOnly = {}) const
+    {
+        std::vector<std::pair<std::string, std::string>> recorded = scenarioWords(Scenario());
+        std::vector<std::pair<std::string, std::string>> running = scenarioWords(current.Text());
+        std::vector<std::string> keys;
+        for (const auto& word : recorded)
+            keys.push_back(word.first);
+        for (const auto& word : running)
+            if (std::find(keys.begin(), keys.end(), word.first) == keys.end())
+                keys.push_back(word.first);
+
+        bool ok = true;
+        for (const std::string& key : keys)
+        {
+            std::string was = scenarioValue(recorded, key), is = scenarioValue(running, key);
+            if (was == is)
+                continue;
+            bool report = std::find_if(reportOnly.begin(), reportOnly.end(),
+                                       [&](const char* k) { return key == k; }) != reportOnly.end();
+            std::cout << (report ? "Replay: " : "ERROR::INPUT_REPLAY: ") << "the log was recorded with " << key << "="
+                      << was << ", this run has " << key << "=" << is << std::endl;
+            ok = ok && report;
+        }
+        if (!ok)
+            std::cout << "ERROR::INPUT_REPLAY: the log's scenario is: " << Scenario() << std::endl;
+        return ok;
+    }
+
+private:
+    InputLogHeader header = {};
+    std::vector<InputFrame> frames;
+    size_t next = 0;
+
+    static std::vector<std::pair<std::string, std::string>> scenarioWords(const std::string& text)
+    {
+        std::vector<std::pair<std::string, std::string>> words;
+        std::istringstream in(text);
+        std::string word;
+        while (in >> word)
+        {
+            size_t eq = word.find('=');
+            if (eq != std::string::npos)
+                words.emplace_back(word.substr(0, eq), word.substr(eq + 1));
+        }
+        return words;
+    }
+
+    static std::string scenarioValue(const std::vector<std::pair<std::string, std::string>>& words, const std::string& key)
+    {
+        for (const auto& word : words)
+            if (word.first == key)
+                return word.second;
+        return "(unset)";
+    }
+};
+
+// Number of fixed steps a replay has to run so that stepsDone * step catches
+// up with the recorded time of the current frame.
+inline unsigned int replayStepsDue(float time, float step, unsigned long long stepsDone)
+{
+    if (step <= 0.0f)
+        return 0;
+    long long due = (long long)std::floor(time / step) - (long long)stepsDone;
+    return due > 0 ? (unsigned int)due : 0u;
+}
+
+// 64-bit FNV-1a over whatever state the demo feeds it.
+class StateHash
+{
+public:
+    void AddBytes(const void* data, size_t size)
+    {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            value ^= p[i];
+            value *= 1099511628211ull;
+        }
+    }
+
+    template <typename T>
+    void Add(const T& v) { AddBytes(&v, sizeof(T)); }
+
+    uint64_t Value() const { return value; }
+
+private:
+    uint64_t value = 14695981039346656037ull;
+};
+
+class FrameTimeStats
+{
+public:
+    void Add(double ms) { times.push_back(ms); }
+
+    // One CSV header line and one data line.
+    void Print(uint64_t stateHash)
+    {
+        std::vector<double> sorted = times;
+        std::sort(sorted.begin(), sorted.end());
+        double mean = 0.0;
+        for (double t : sorted)
+            mean += t;
+        size_t n = sorted.size();
+        if (n)
+            mean /= n;
+        auto pct = [&](double p) { return n ? sorted[(size_t)((n - 1) * p)] : 0.0; };
+
+        char hash[17];
+        std::snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)stateHash);
+        std::cout << "frames,mean_ms,p50_ms,p95_ms,p99_ms,max_ms,state_hash\n"
+                  << n << "," << mean << "," << pct(0.5) << "," << pct(0.95) << "," << pct(0.99) << ","
+                  << (n ? sorted.back() : 0.0) << "," << hash << std::endl;
+    }
+
+private:
+    std::vector<double> times;
+};
+
+#endif
@@ -0,0 +1,387 @@
+// job_system.h
+// Work-stealing scheduler for per-frame work, shared by the demos: parallel-for
+// over entity ranges, task graphs with dependencies, and one scratch arena per
+// worker.
+//
+// Every worker owns a deque of jobs. It pushes and pops at the back (newest
+// first, its data is still in cache) and, once its own deque is empty, steals
+// from the front of another worker's (oldest first, usually the largest piece
+// left). The thread that submits work counts as worker 0 and runs jobs itself
+// while it waits, so a JobSystem with one worker starts no threads and runs
+// everything inline. Only one outside thread may submit at a time; jobs
+// themselves may submit nested work.
+//
+// A job is a function pointer and a context pointer, and the deques are fixed
+// rings, so submitting and running work does not touch the heap.
+
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Linear allocator for plain data that only lives for one frame. Memory from
+// Alloc stays valid until Reset. Blocks are kept across resets, so once the
+// arena has seen its largest frame it stops allocating.
+class ScratchArena
+{
+public:
+    static const size_t BLOCK_SIZE = 256 * 1024;
+
+    template <typename T>
+    T* Alloc(size_t count)
+    {
+        size_t bytes = count * sizeof(T);
+        size_t start = (offset + alignof(T) - 1) / alignof(T) * alignof(T);
+        while (current < blocks.size() && start + bytes > blocks[current].size)
+        {
+            ++current; // the rest of this block stays unused until Reset
+            start = 0;
+        }
+        if (current == blocks.size())
+        {
+            size_t size = std::max(bytes, BLOCK_SIZE);
+            blocks.push_back(Block{ std::unique_ptr<char[]>(new char[size]), size });
+            start = 0;
+        }
+        offset = start + bytes;
+        return reinterpret_cast<T*>(blocks[current].data.get() + start);
+    }
+
+    void Reset()
+    {
+        current = 0;
+        offset = 0;
+    }
+
+private:
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t current = 0;
+    size_t offset = 0;
+};
+
+struct Job
+{
+    void (*run)(void* context, unsigned int begin, unsigned int end, unsigned int worker);
+    void* context;
+    unsigned int begin, end;
+    std::atomic<int>* pending; // decremented once the job has run
+};
+
+// One worker's deque: a fixed ring behind a mutex. The owner works at the
+// back, thieves take from the front.
+class JobQueue
+{
+public:
+    static const unsigned int CAPACITY = 1024; // power of two
+
+    bool Push(const Job& job)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tail - head == CAPACITY)
+            return false;
+        ring[tail++ & (CAPACITY - 1)] = job;
+        return true;
+    }
+
+    bool Pop(Job& job)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tail == head)
+            return false;
+        job = ring[--tail & (CAPACITY - 1)];
+        return true;
+    }
+
+    bool Steal(Job& job)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tail == head)
+            return false;
+        job = ring[head++ & (CAPACITY - 1)];
+        return true;
+    }
+
+private:
+    std::mutex mutex;
+    Job ring[CAPACITY];
+    unsigned int head = 0, tail = 0;
+};
+
+class JobSystem
+{
+public:
+    // workerCount includes the submitting thread; 0 means one per hardware thread.
+    explicit JobSystem(unsigned int workerCount = 0)
+    {
+        if (workerCount == 0)
+            workerCount = std::max(1u, std::thread::hardware_concurrency());
+        count = workerCount;
+        queues.reset(new JobQueue[count]);
+        scratch.resize(count);
+        for (unsigned int w = 1; w < count; ++w)
+            threads.emplace_back(&JobSystem::workerLoop, this, w);
+    }
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stop = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : threads)
+            t.join();
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned int WorkerCount() const { return count; }
+
+    // Index of the calling thread: 1..WorkerCount()-1 on the pool's threads,
+    // 0 on any other thread.
+    unsigned int CurrentWorker() const { return workerOwner() == this ? workerIndex() : 0; }
+
+    // Worker w's arena. Only worker w may allocate from it while jobs run.
+    ScratchArena& Scratch(unsigned int worker) { return scratch[worker]; }
+
+    // Empty every arena; call between frames, with no jobs in flight.
+    void ResetScratch()
+    {
+        for (ScratchArena& arena : scratch)
+            arena.Reset();
+    }
+
+    // Call fn(first, last, worker) over [begin, end) split into ranges of at
+    // least grain items, and return once all of them have run. Ranges are
+    // contiguous and disjoint, so fn may write to its own items without locks.
+    // Small ranges, and a single-worker system, run inline as one call.
+    template <typename Fn>
+    void ParallelFor(unsigned int begin, unsigned int end, unsigned int grain, const Fn& fn)
+    {
+        if (end <= begin)
+            return;
+        unsigned int items = end - begin;
+        grain = std::max(grain, 1u);
+        // a few ranges per worker, so stealing can even out uneven ranges
+        unsigned int ranges = std::min((items + grain - 1) / grain, count * 4);
+        if (ranges <= 1)
+        {
+            fn(begin, end, CurrentWorker());
+            return;
+        }
+
+        std::atomic<int> pending(0);
+        for (unsigned int r = 0; r < ranges; ++r)
+        {
+            unsigned int first = begin + (unsigned int)((uint64_t)items * r / ranges);
+            unsigned int last = begin + (unsigned int)((uint64_t)items * (r + 1) / ranges);
+            Submit(Job{ &runRange<Fn>, (void*)&fn, first, last, &pending });
+        }
+        WakeWorkers();
+        Wait(pending);
+    }
+
+    // Queue a job on the calling worker's deque. job.pending is incremented
+    // here; if the deque is full the job runs right away.
+    void Submit(const Job& job)
+    {
+        job.pending->fetch_add(1, std::memory_order_relaxed);
+        if (queues[CurrentWorker()].Push(job))
+            queued.fetch_add(1, std::memory_order_release);
+        else
+            execute(job, CurrentWorker());
+    }
+
+    // Let sleeping workers know there is work; call after a batch of Submit.
+    void WakeWorkers()
+    {
+        if (count > 1)
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            wake.notify_all();
+        }
+    }
+
+    // Run queued jobs on this thread until pending drops to zero.
+    void Wait(const std::atomic<int>& pending)
+    {
+        unsigned int self = CurrentWorker();
+        while (pending.load(std::memory_order_acquire) > 0)
+            if (!runOne(self))
+                std::this_thread::yield();
+    }
+
+private:
+    unsigned int count = 1;
+    std::unique_ptr<JobQueue[]> queues;
+    std::vector<ScratchArena> scratch;
+    std::vector<std::thread> threads;
+    std::atomic<int> queued{ 0 };
+
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool stop = false;
+
+    static const JobSystem*& workerOwner()
+    {
+        static thread_local const JobSystem* owner = nullptr;
+        return owner;
+    }
+
+    static unsigned int& workerIndex()
+    {
+        static thread_local unsigned int index = 0;
+        return index;
+    }
+
+    template <typename Fn>
+    static void runRange(void* context, unsigned int begin, unsigned int end, unsigned int worker)
+    {
+        (*static_cast<const Fn*>(context))(begin, end, worker);
+    }
+
+    static void execute(const Job& job, unsigned int worker)
+    {
+        job.run(job.context, job.begin, job.end, worker);
+        job.pending->fetch_sub(1, std::memory_order_release);
+    }
+
+    // Own deque first, then steal round the others.
+    bool runOne(unsigned int self)
+    {
+        Job job;
+        bool found = queues[self].Pop(job);
+        for (unsigned int k = 1; !found && k < count; ++k)
+            found = queues[(self + k) % count].Steal(job);
+        if (!found)
+            return false;
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        execute(job, self);
+        return true;
+    }
+
+    void workerLoop(unsigned int index)
+    {
+        workerOwner() = this;
+        workerIndex() = index;
+        for (;;)
+        {
+            // spin a little before sleeping: frames hand out work in quick bursts
+            bool ran = false;
+            for (int spin = 0; spin < 64 && !ran; ++spin)
+            {
+                ran = runOne(index);
+                if (!ran)
+                    std::this_thread::yield();
+            }
+            if (ran)
+                continue;
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this] { return stop || queued.load(std::memory_order_acquire) > 0; });
+            if (stop)
+                return;
+        }
+    }
+};
+
+// Tasks with dependencies, built once and run as often as needed. A task
+// starts as soon as every task it was added after has finished, on whichever
+// worker gets to it first.
+class TaskGraph
+{
+public:
+    // Add a task that runs after the listed tasks, which must have been added
+    // earlier (so the graph cannot have cycles). Returns the task's id.
+    unsigned int Add(std::function<void(unsigned int worker)> fn, std::initializer_list<unsigned int> after = {})
+    {
+        unsigned int id = (unsigned int)tasks.size();
+        tasks.push_back(Task{ std::move(fn), {}, 0 });
+        for (unsigned int dep : after)
+        {
+            if (dep >= id)
+            {
+                std::cout << "ERROR::TASK_GRAPH: task " << id << " cannot wait for task " << dep << std::endl;
+                continue;
+            }
+            tasks[dep].dependents.push_back(id);
+            ++tasks[id].dependencies;
+        }
+        return id;
+    }
+
+    bool Empty() const { return tasks.empty(); }
+
+    // Run every task once and return when all have finished.
+    void Run(JobSystem& jobs)
+    {
+        if (tasks.empty())
+            return;
+        if (!remaining || remainingSize != tasks.size())
+        {
+            remaining.reset(new std::atomic<int>[tasks.size()]);
+            remainingSize = tasks.size();
+        }
+        for (size_t i = 0; i < tasks.size(); ++i)
+            remaining[i].store(tasks[i].dependencies, std::memory_order_relaxed);
+
+        system = &jobs;
+        std::atomic<int> pending(0);
+        this->pending = &pending;
+        for (unsigned int i = 0; i < tasks.size(); ++i)
+            if (tasks[i].dependencies == 0)
+                jobs.Submit(Job{ &runTask, this, i, i + 1, &pending });
+        jobs.WakeWorkers();
+        jobs.Wait(pending); // released tasks are counted before their parent finishes
+        system = nullptr;
+    }
+
+private:
+    struct Task
+    {
+        std::function<void(unsigned int)> fn;
+        std::vector<unsigned int> dependents;
+        int dependencies;
+    };
+
+    std::vector<Task> tasks;
+    std::unique_ptr<std::atomic<int>[]> remaining;
+    size_t remainingSize = 0;
+    JobSystem* system = nullptr;
+    std::atomic<int>* pending = nullptr;
+
+    static void runTask(void* context, unsigned int id, unsigned int, unsigned int worker)
+    {
+        TaskGraph& graph = *static_cast<TaskGraph*>(context);
+        graph.tasks[id].fn(worker);
+        bool released = false;
+        for (unsigned int d : graph.tasks[id].dependents)
+            if (graph.remaining[d].fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                graph.system->Submit(Job{ &runTask, &graph, d, d + 1, graph.pending });
+                released = true;
+            }
+        if (released)
+            graph.system->WakeWorkers();
+    }
+};
+
+#endif
@@ -0,0 +1,325 @@
+// shader_reflect.h
+// Uniform reflection for a linked program, shared by the demos.
+//
+// learnopengl's Shader::setX(name, value) looks the location up by name on
+// every call, and the demos build many of those names per frame by string
+// concatenation. ReflectedShader instead lists the program's active uniforms
+// once, right after linking, and hands out typed handles (Uniform<T>) that are
+// resolved once at setup and then used every frame. Set() also remembers the
+// last value sent through each handle and skips the GL call when it has not
+// changed, so constants written every frame cost a memcmp instead of a call.
+//
+// The value cache assumes the program's uniforms only change through this
+// class. Code that writes them some other way (Shader::setX, a raw glUniform)
+// should not share those uniforms with it, or must call Invalidate()
+// afterwards. learnopengl's Model::Draw is such code: it looks up and sets a
+// sampler per texture of every mesh, every draw. drawModel() below draws the
+// same meshes with the same texture units but sets the samplers through
+// ModelSamplers handles instead.
+//
+// uniformStats() counts the GL calls made through every ReflectedShader; the
+// demos send their per-frame uniforms only that way, so the report covers all
+// of them (Shader::setX is left to one-off setup). Switching caching off makes
+// Set() behave like Shader::setX (a location lookup plus an upload per call),
+// so the same run can report the uniform traffic before and after.
+
+#ifndef SHADER_REFLECT_H
+#define SHADER_REFLECT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct UniformStats
+{
+    bool caching = true;              // false: look up and upload on every Set, as Shader::setX does
+    unsigned long long uploads = 0;   // glUniform* calls
+    unsigned long long lookups = 0;   // glGetUniformLocation calls after reflection
+    unsigned long long skipped = 0;   // Set calls that matched the cached value
+
+    void Reset() { uploads = lookups = skipped = 0; }
+
+    // Averages over frames, one line.
+    void Print(unsigned long long frames) const
+    {
+        double n = frames ? (double)frames : 1.0;
+        std::cout << "Uniforms per frame" << (caching ? "" : " (cache off)") << ": " << uploads / n << " uploads, "
+                  << lookups / n << " location lookups, " << skipped / n << " skipped as unchanged" << std::endl;
+    }
+};
+
+inline UniformStats& uniformStats()
+{
+    static UniformStats stats;
+    return stats;
+}
+
+// How each C++ type maps onto GLSL uniform types and glUniform calls.
+template <typename T> struct UniformTraits;
+
+template <> struct UniformTraits<float>
+{
+    static bool Accepts(GLenum type) { return type == GL_FLOAT; }
+    static void Upload(GLint location, const float& v) { glUniform1f(location, v); }
+};
+
+template <> struct UniformTraits<int>
+{
+    static bool Accepts(GLenum type)
+    {
+        return type == GL_INT || type == GL_BOOL || type == GL_SAMPLER_2D || type == GL_SAMPLER_3D
+            || type == GL_SAMPLER_CUBE || type == GL_SAMPLER_BUFFER || type == GL_SAMPLER_2D_SHADOW
+            || type == GL_INT_SAMPLER_BUFFER || type == GL_UNSIGNED_INT_SAMPLER_BUFFER;
+    }
+    static void Upload(GLint location, const int& v) { glUniform1i(location, v); }
+};
+
+template <> struct UniformTraits<bool>
+{
+    static bool Accepts(GLenum type) { return type == GL_BOOL || type == GL_INT; }
+    static void Upload(GLint location, const bool& v) { glUniform1i(location, (int)v); }
+};
+
+template <> struct UniformTraits<glm::vec2>
+{
+    static bool Accepts(GLenum type) { return type == GL_FLOAT_VEC2; }
+    static void Upload(GLint location, const glm::vec2& v) { glUniform2fv(location, 1, glm::value_ptr(v)); }
+};
+
+template <> struct UniformTraits<glm::vec3>
+{
+    static bool Accepts(GLenum type) { return type == GL_FLOAT_VEC3; }
+    static void Upload(GLint location, const glm::vec3& v) { glUniform3fv(location, 1, glm::value_ptr(v)); }
+};
+
+template <> struct UniformTraits<glm::vec4>
+{
+    static bool Accepts(GLenum type) { return type == GL_FLOAT_VEC4; }
+    static void Upload(GLint location, const glm::vec4& v) { glUniform4fv(location, 1, glm::value_ptr(v)); }
+};
+
+template <> struct UniformTraits<glm::ivec3>
+{
+    static bool Accepts(GLenum type) { return type == GL_INT_VEC3; }
+    static void Upload(GLint location, const glm::ivec3& v) { glUniform3iv(location, 1, glm::value_ptr(v)); }
+};
+
+template <> struct UniformTraits<glm::mat3>
+{
+    static bool Accepts(GLenum type) { return type == GL_FLOAT_MAT3; }
+    static void Upload(GLint location, const glm::mat3& v) { glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(v)); }
+};
+
+template <> struct UniformTraits<glm::mat4>
+{
+    static bool Accepts(GLenum type) { return type == GL_FLOAT_MAT4; }
+    static void Upload(GLint location, const glm::mat4& v) { glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(v)); }
+};
+
+// A resolved uniform of one program. Invalid (and ignored by Set) when the
+// name is not an active uniform, e.g. because the compiler removed it.
+template <typename T>
+struct Uniform
+{
+    int slot = -1;
+    bool IsValid() const { return slot >= 0; }
+};
+
+class ReflectedShader
+{
+public:
+    ReflectedShader() = default;
+    explicit ReflectedShader(unsigned int program) { Reflect(program); }
+
+    // List the active uniforms of a linked program. Array elements are
+    // registered one by one ("bones[3]"), and the bare array name refers to
+    // element 0, as with glGetUniformLocation.
+    void Reflect(unsigned int program)
+    {
+        ID = program;
+        slots.clear();
+        byName.clear();
+
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<char> buffer((size_t)maxLength + 1);
+        for (GLint i = 0; i < count; ++i)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(program, (GLuint)i, (GLsizei)buffer.size(), &length, &size, &type, buffer.data());
+            std::string name(buffer.data(), (size_t)length);
+            if (glGetUniformLocation(program, name.c_str()) < 0)
+                continue; // a member of a uniform block, set through its buffer instead
+
+            std::string base = name;
+            if (base.size() > 3 && base.compare(base.size() - 3, 3, "[0]") == 0)
+                base.resize(base.size() - 3);
+            if (size == 1 && base == name)
+            {
+                add(name, glGetUniformLocation(program, name.c_str()), type);
+                continue;
+            }
+            for (GLint e = 0; e < size; ++e)
+            {
+                std::string element = base + "[" + std::to_string(e) + "]";
+                GLint location = glGetUniformLocation(program, element.c_str());
+                if (location >= 0)
+                    add(element, location, type);
+            }
+            auto first = byName.find(base + "[0]");
+            if (first != byName.end())
+                byName[base] = first->second;
+        }
+    }
+
+    // Handle for name; reports a type that does not match the GLSL declaration.
+    template <typename T>
+    Uniform<T> Find(const std::string& name) const
+    {
+        Uniform<T> handle;
+        auto it = byName.find(name);
+        if (it == byName.end())
+            return handle;
+        if (!UniformTraits<T>::Accepts(slots[it->second].type))
+        {
+            std::cout << "ERROR::SHADER_REFLECT: uniform " << name << " has GL type 0x" << std::hex
+                      << slots[it->second].type << std::dec << ", which does not match the handle" << std::endl;
+            return handle;
+        }
+        handle.slot = it->second;
+        return handle;
+    }
+
+    // Send value unless it is what this handle sent last. The program must be in use.
+    template <typename T>
+    void Set(Uniform<T> handle, const T& value)
+    {
+        static_assert(sizeof(T) <= sizeof(Slot::value), "uniform value too large for the cache");
+        if (handle.slot < 0)
+            return;
+        Slot& slot = slots[handle.slot];
+        UniformStats& stats = uniformStats();
+        if (!stats.caching)
+        {
+            ++stats.lookups;
+            ++stats.uploads;
+            UniformTraits<T>::Upload(glGetUniformLocation(ID, slot.name.c_str()), value);
+            return;
+        }
+        if (slot.known && std::memcmp(slot.value, &value, sizeof(T)) == 0)
+        {
+            ++stats.skipped;
+            return;
+        }
+        std::memcpy(slot.value, &value, sizeof(T));
+        slot.known = true;
+        ++stats.uploads;
+        UniformTraits<T>::Upload(slot.location, value);
+    }
+
+    // Forget the cached values, e.g. after uniforms were written around this class.
+    void Invalidate()
+    {
+        for (Slot& slot : slots)
+            slot.known = false;
+    }
+
+    unsigned int Program() const { return ID; }
+    size_t UniformCount() const { return slots.size(); }
+
+private:
+    struct Slot
+    {
+        std::string name;
+        GLint location;
+        GLenum type;
+        bool known;
+        alignas(16) unsigned char value[sizeof(glm::mat4)];
+    };
+
+    unsigned int ID = 0;
+    std::vector<Slot> slots;
+    std::unordered_map<std::string, int> byName;
+
+    void add(const std::string& name, GLint location, GLenum type)
+    {
+        byName[name] = (int)slots.size();
+        slots.push_back(Slot{ name, location, type, false, {} });
+    }
+};
+
+// Sampler uniforms named the way learnopengl's Mesh::Draw names them
+// (texture_diffuse1, texture_specular2, ...), resolved once after linking.
+// Samplers the shader does not use stay invalid.
+const int MODEL_SAMPLERS_PER_TYPE = 4;
+
+struct ModelSamplers
+{
+    Uniform<int> diffuse[MODEL_SAMPLERS_PER_TYPE];
+    Uniform<int> specular[MODEL_SAMPLERS_PER_TYPE];
+    Uniform<int> normal[MODEL_SAMPLERS_PER_TYPE];
+    Uniform<int> height[MODEL_SAMPLERS_PER_TYPE];
+
+    void Find(const ReflectedShader& shader)
+    {
+        for (int n = 0; n < MODEL_SAMPLERS_PER_TYPE; ++n)
+        {
+            diffuse[n] = shader.Find<int>("texture_diffuse" + std::to_string(n + 1));
+            specular[n] = shader.Find<int>("texture_specular" + std::to_string(n + 1));
+            normal[n] = shader.Find<int>("texture_normal" + std::to_string(n + 1));
+            height[n] = shader.Find<int>("texture_height" + std::to_string(n + 1));
+        }
+    }
+
+    // Handle for the number-th (from 1) texture of a learnopengl texture type.
+    Uniform<int> For(const std::string& type, int number) const
+    {
+        if (number < 1 || number > MODEL_SAMPLERS_PER_TYPE)
+            return Uniform<int>();
+        if (type == "texture_diffuse") return diffuse[number - 1];
+        if (type == "texture_specular") return specular[number - 1];
+        if (type == "texture_normal") return normal[number - 1];
+        if (type == "texture_height") return height[number - 1];
+        return Uniform<int>();
+    }
+};
+
+// What Model::Draw does, with the sampler uniforms going through shader's
+// handles: texture i of a mesh on unit i, one glDrawElements per mesh. shader
+// must be in use. A template so this header does not depend on learnopengl's
+// model headers (model.h and model_animation.h both work).
+template <typename ModelT>
+void drawModel(const ModelT& model, ReflectedShader& shader, const ModelSamplers& samplers)
+{
+    for (const auto& mesh : model.meshes)
+    {
+        int diffuseNr = 1, specularNr = 1, normalNr = 1, heightNr = 1;
+        for (size_t i = 0; i < mesh.textures.size(); ++i)
+        {
+            const std::string& type = mesh.textures[i].type;
+            int number = 0;
+            if (type == "texture_diffuse") number = diffuseNr++;
+            else if (type == "texture_specular") number = specularNr++;
+            else if (type == "texture_normal") number = normalNr++;
+            else if (type == "texture_height") number = heightNr++;
+            glActiveTexture(GL_TEXTURE0 + (GLenum)i);
+            shader.Set(samplers.For(type, number), (int)i);
+            glBindTexture(GL_TEXTURE_2D, mesh.textures[i].id);
+        }
+        glBindVertexArray(mesh.VAO);
+        glDrawElements(GL_TRIANGLES, (GLsizei)mesh.indices.size(), GL_UNSIGNED_INT, 0);
+    }
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+#endif
@@ -0,0 +1,102 @@
+// alloc_counter.h
+// Counts global operator new calls so the shooter can check that its steady
+// state does not allocate. Counting replaces the global allocation functions,
+// so it is only compiled in when SHOOTER_COUNT_ALLOCATIONS is defined, for a
+// bench build of the one translation unit that includes this header; the
+// game itself keeps the standard allocator. Every replaceable form of new is
+// counted: plain, array, nothrow and (with C++17 aligned new) over-aligned.
+
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+inline std::atomic<unsigned long long>& allocationCount()
+{
+    static std::atomic<unsigned long long> count(0);
+    return count;
+}
+
+#ifdef SHOOTER_COUNT_ALLOCATIONS
+const bool ALLOCATIONS_COUNTED = true;
+
+inline void* countedAlloc(std::size_t size)
+{
+    allocationCount().fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new(std::size_t size)
+{
+    if (void* p = countedAlloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+#ifdef __cpp_aligned_new
+inline void* countedAlignedAlloc(std::size_t size, std::align_val_t alignment)
+{
+    allocationCount().fetch_add(1, std::memory_order_relaxed);
+    std::size_t align = (std::size_t)alignment < sizeof(void*) ? sizeof(void*) : (std::size_t)alignment;
+#ifdef _WIN32
+    return _aligned_malloc(size ? size : 1, align);
+#else
+    void* p = nullptr;
+    return posix_memalign(&p, align, size ? size : 1) == 0 ? p : nullptr;
+#endif
+}
+
+inline void alignedFree(void* p)
+{
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (void* p = countedAlignedAlloc(size, alignment))
+        return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return countedAlignedAlloc(size, alignment);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return countedAlignedAlloc(size, alignment);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept { alignedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { alignedFree(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { alignedFree(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { alignedFree(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { alignedFree(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { alignedFree(p); }
+#endif
+
+#else
+const bool ALLOCATIONS_COUNTED = false; // allocationCount() stays 0
+#endif
+
+#endif
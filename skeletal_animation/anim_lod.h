@@ -0,0 +1,250 @@
+// anim_lod.h
+// Level of detail for CPU-animated characters, on top of SkinnedAnimator.
+//
+// Three savings, combined per character every frame:
+//   rate     distant and off-screen characters are evaluated every 2nd, 4th
+//            or 8th frame (staggered by id so the work spreads evenly) and
+//            keep their last pose in between
+//   bones    at the far levels nodes that move almost no geometry (fingers,
+//            toes, head tip) stay in bind pose instead of being sampled
+//   sharing  time is quantised per level, and characters playing the same
+//            clip at the same quantised time and level share one palette
+//
+// Palettes live in a pose cache keyed by (quantised time, level, clip). A
+// character that skips a frame keeps pointing at its previous entry, so
+// per-character state is one key. Entries nobody used this frame are
+// recycled at the start of the next one.
+
+#ifndef ANIM_LOD_H
+#define ANIM_LOD_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/model_animation.h>
+
+#include "bone_palette.h"
+#include "skeleton.h"
+#include "skinned_animator.h"
+
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+const uint64_t ANIM_LOD_NO_KEY = ~0ull;
+
+enum AnimLodLevel { ANIM_LOD_NEAR, ANIM_LOD_MID, ANIM_LOD_FAR, ANIM_LOD_HIDDEN, ANIM_LOD_COUNT };
+
+struct AnimLodSettings
+{
+    float midDistance = 8.0f;  // beyond this, ANIM_LOD_MID
+    float farDistance = 20.0f; // beyond this, ANIM_LOD_FAR
+    int updateInterval[ANIM_LOD_COUNT] = { 1, 2, 4, 8 };                                  // frames between evaluations
+    float timeQuantum[ANIM_LOD_COUNT] = { 1.0f / 120.0f, 1.0f / 30.0f, 1.0f / 15.0f, 1.0f / 15.0f }; // seconds
+    bool reducedBones[ANIM_LOD_COUNT] = { false, false, true, true };
+};
+
+// What the caller knows about one character this frame.
+struct AnimLodCharacter
+{
+    uint32_t id;    // stable for the character's lifetime, < the system's capacity
+    int clip;       // index into the clips the system was built with
+    float time;     // seconds into the clip; wrapped here
+    float distance; // to the camera
+    bool visible;
+    uint32_t generation = 0; // changes when id is handed to a new character (a pool slot's generation)
+};
+
+struct AnimLodStats
+{
+    unsigned int evaluated = 0; // poses sampled this frame
+    unsigned int shared = 0;    // characters that reused a pose another one had already sampled
+    unsigned int skipped = 0;   // characters that kept their previous pose
+    unsigned int perLevel[ANIM_LOD_COUNT] = {};
+};
+
+// Nodes worth animating at the reduced-bone levels: those whose subtree moves
+// at least minShare of the model's total skin weight.
+inline std::vector<char> lodNodeMask(const Skeleton& skeleton, const Model& model, float minShare)
+{
+    std::vector<float> boneWeight(MAX_BONES, 0.0f);
+    float total = 0.0f;
+    for (const Mesh& mesh : model.meshes)
+        for (const Vertex& v : mesh.vertices)
+            for (int k = 0; k < MAX_BONE_INFLUENCE; ++k)
+                if (v.m_BoneIDs[k] >= 0 && v.m_BoneIDs[k] < MAX_BONES)
+                {
+                    boneWeight[v.m_BoneIDs[k]] += v.m_Weights[k];
+                    total += v.m_Weights[k];
+                }
+
+    // children come after their parents, so a backwards pass sums subtrees
+    std::vector<float> subtree(skeleton.NodeCount(), 0.0f);
+    for (unsigned int i = skeleton.NodeCount(); i-- > 0; )
+    {
+        if (skeleton.boneId[i] >= 0)
+            subtree[i] += boneWeight[skeleton.boneId[i]];
+        if (skeleton.parent[i] >= 0)
+            subtree[skeleton.parent[i]] += subtree[i];
+    }
+
+    std::vector<char> mask(skeleton.NodeCount());
+    for (unsigned int i = 0; i < skeleton.NodeCount(); ++i)
+        mask[i] = total <= 0.0f || subtree[i] >= minShare * total;
+    return mask;
+}
+
+class AnimLodSystem
+{
+public:
+    AnimLodSettings settings;
+
+    AnimLodSystem(const Skeleton* skeleton, const SkeletonClip* clips, int clipCount, uint32_t capacity)
+        : lastKey(capacity, ANIM_LOD_NO_KEY), lastGeneration(capacity, 0), reducedMask(skeleton->NodeCount(), 1)
+    {
+        for (int c = 0; c < clipCount; ++c)
+        {
+            evaluators.emplace_back(skeleton, &clips[c]);
+            const ClipTracks& tracks = clips[c].tracks;
+            clipSeconds.push_back(tracks.ticksPerSecond > 0.0f ? tracks.duration / tracks.ticksPerSecond : tracks.duration);
+            ticksPerSecond.push_back(tracks.ticksPerSecond > 0.0f ? tracks.ticksPerSecond : 1.0f);
+        }
+    }
+
+    // Nodes to animate at the reduced-bone levels (see lodNodeMask).
+    void SetReducedMask(const std::vector<char>& mask) { reducedMask = mask; }
+
+    // Bring every character's palette up to date. Palette(i) then refers to
+    // characters[i] until the next call.
+    void Update(const AnimLodCharacter* characters, unsigned int count)
+    {
+        ++frame;
+        stats = AnimLodStats();
+        recycle();
+        paletteOf.resize(count);
+
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            const AnimLodCharacter& ch = characters[i];
+            int level = levelFor(ch);
+            ++stats.perLevel[level];
+
+            // off its update frame: keep the previous pose if it still has one;
+            // a new character in a reused id has none
+            uint64_t previous = ANIM_LOD_NO_KEY;
+            if (ch.id < lastKey.size())
+            {
+                if (lastGeneration[ch.id] != ch.generation)
+                {
+                    lastGeneration[ch.id] = ch.generation;
+                    lastKey[ch.id] = ANIM_LOD_NO_KEY;
+                }
+                previous = lastKey[ch.id];
+            }
+            auto cached = previous != ANIM_LOD_NO_KEY ? cache.find(previous) : cache.end();
+            bool due = (frame + ch.id) % (uint32_t)settings.updateInterval[level] == 0;
+            if (!due && cached != cache.end())
+            {
+                use(i, cached->second);
+                ++stats.skipped;
+                continue;
+            }
+
+            float seconds = std::fmod(ch.time, clipSeconds[ch.clip]);
+            if (seconds < 0.0f)
+                seconds += clipSeconds[ch.clip];
+            uint64_t step = (uint64_t)(seconds / settings.timeQuantum[level]);
+            uint64_t key = (step * ANIM_LOD_COUNT + level) * 256 + (uint64_t)ch.clip;
+            if (ch.id < lastKey.size())
+                lastKey[ch.id] = key;
+
+            auto it = cache.find(key);
+            if (it != cache.end())
+            {
+                use(i, it->second);
+                if (key == previous) ++stats.skipped; // still inside the same quantum
+                else ++stats.shared;
+                continue;
+            }
+
+            unsigned int entry = allocate(key);
+            float ticks = step * settings.timeQuantum[level] * ticksPerSecond[ch.clip];
+            evaluators[ch.clip].EvaluateAt(ticks, &palettes[(size_t)entry * MAX_BONES],
+                                           settings.reducedBones[level] ? reducedMask.data() : nullptr);
+            use(i, entry);
+            ++stats.evaluated;
+        }
+    }
+
+    const glm::mat4* Palette(unsigned int i) const { return &palettes[(size_t)paletteOf[i] * MAX_BONES]; }
+    const AnimLodStats& Stats() const { return stats; }
+
+private:
+    struct Entry
+    {
+        uint64_t key;
+        uint32_t lastUsed;
+    };
+
+    std::vector<SkinnedAnimator> evaluators; // one per clip, shared by every character
+    std::vector<float> clipSeconds;
+    std::vector<float> ticksPerSecond;
+    std::vector<uint64_t> lastKey;        // per character id
+    std::vector<uint32_t> lastGeneration; // per character id, of the character lastKey belongs to
+    std::vector<char> reducedMask;
+
+    std::unordered_map<uint64_t, unsigned int> cache; // key -> entry
+    std::vector<Entry> entries;
+    std::vector<glm::mat4> palettes;                  // MAX_BONES per entry
+    std::vector<unsigned int> freeEntries;
+    std::vector<unsigned int> paletteOf;              // per character of the last Update
+    uint32_t frame = 0;
+    AnimLodStats stats;
+
+    int levelFor(const AnimLodCharacter& ch) const
+    {
+        if (!ch.visible) return ANIM_LOD_HIDDEN;
+        if (ch.distance > settings.farDistance) return ANIM_LOD_FAR;
+        if (ch.distance > settings.midDistance) return ANIM_LOD_MID;
+        return ANIM_LOD_NEAR;
+    }
+
+    void use(unsigned int character, unsigned int entry)
+    {
+        paletteOf[character] = entry;
+        entries[entry].lastUsed = frame;
+    }
+
+    unsigned int allocate(uint64_t key)
+    {
+        unsigned int entry;
+        if (!freeEntries.empty())
+        {
+            entry = freeEntries.back();
+            freeEntries.pop_back();
+        }
+        else
+        {
+            entry = (unsigned int)entries.size();
+            entries.push_back(Entry());
+            palettes.resize(palettes.size() + MAX_BONES);
+        }
+        entries[entry] = Entry{ key, frame };
+        cache[key] = entry;
+        return entry;
+    }
+
+    // entries no character pointed at last frame can never be reached again
+    void recycle()
+    {
+        for (unsigned int e = 0; e < entries.size(); ++e)
+            if (entries[e].key != ANIM_LOD_NO_KEY && entries[e].lastUsed + 1 < frame)
+            {
+                cache.erase(entries[e].key);
+                entries[e].key = ANIM_LOD_NO_KEY;
+                freeEntries.push_back(e);
+            }
+    }
+};
+
+#endif
@@ -8,18 +8,71 @@ layout(location = 4) in vec3 bitangent;
 layout(location = 5) in ivec4 boneIds; 
 layout(location = 6) in vec4 weights;
 
-uniform mat4 projection;
-uniform mat4 view;
+// crowd instances (divisor 1), only read when crowd is set
+layout(location = 7) in mat4 instanceModel;
+layout(location = 11) in vec2 instanceAnim; // clip index, time offset in seconds
+
 uniform mat4 model;
 
+// per-frame constants from common/frame_constants.h; this stage reads view, projection and time
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 cameraPosition;
+    float time;
+};
+
 const int MAX_BONES = 100;
 const int MAX_BONE_INFLUENCE = 4;
-uniform mat4 finalBonesMatrices[MAX_BONES];
+layout (std140) uniform BonePalette
+{
+    mat4 finalBonesMatrices[MAX_BONES];
+};
+
+// crowd mode: bone matrices come from the baked animation texture instead of
+// the palette block (see crowd_animation.h)
+const int MAX_CROWD_CLIPS = 16;
+uniform bool crowd;
+uniform sampler2D boneTexture;
+uniform vec3 crowdClips[MAX_CROWD_CLIPS]; // first frame, frame count, length in seconds
+
+int frame0;
+int frame1;
+float frameBlend;
 
 out vec2 TexCoords;
 
+mat4 bakedBone(int bone)
+{
+    int x = bone * 3;
+    vec4 r0 = mix(texelFetch(boneTexture, ivec2(x, frame0), 0), texelFetch(boneTexture, ivec2(x, frame1), 0), frameBlend);
+    vec4 r1 = mix(texelFetch(boneTexture, ivec2(x + 1, frame0), 0), texelFetch(boneTexture, ivec2(x + 1, frame1), 0), frameBlend);
+    vec4 r2 = mix(texelFetch(boneTexture, ivec2(x + 2, frame0), 0), texelFetch(boneTexture, ivec2(x + 2, frame1), 0), frameBlend);
+    return transpose(mat4(r0, r1, r2, vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+mat4 boneMatrix(int bone)
+{
+    return crowd ? bakedBone(bone) : finalBonesMatrices[bone];
+}
+
 void main()
 {
+    mat4 modelMatrix = model;
+    if (crowd)
+    {
+        modelMatrix = instanceModel;
+        vec3 clip = crowdClips[int(instanceAnim.x)];
+        int count = int(clip.y);
+        float f = fract((time + instanceAnim.y) / clip.z) * clip.y;
+        int k = min(int(f), count - 1);
+        frame0 = int(clip.x) + k;
+        frame1 = int(clip.x) + (k + 1) % count;
+        frameBlend = fract(f);
+    }
+
     vec4 totalPosition = vec4(0.0f);
     for(int i = 0 ; i < MAX_BONE_INFLUENCE ; i++)
     {
@@ -30,12 +83,12 @@ void main()
             totalPosition = vec4(pos,1.0f);
             break;
         }
-        vec4 localPosition = finalBonesMatrices[boneIds[i]] * vec4(pos,1.0f);
+        mat4 bone = boneMatrix(boneIds[i]);
+        vec4 localPosition = bone * vec4(pos,1.0f);
         totalPosition += localPosition * weights[i];
-        vec3 localNormal = mat3(finalBonesMatrices[boneIds[i]]) * norm;
    }
 	
-    mat4 viewModel = view * model;
+    mat4 viewModel = view * modelMatrix;
     gl_Position =  projection * viewModel * totalPosition;
 	TexCoords = tex;
 }
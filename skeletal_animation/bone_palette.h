@@ -0,0 +1,79 @@
+// bone_palette.h
+// Uniform buffer that holds the final bone matrices of one skinned character.
+//
+// The buffer is a std140 block of MAX_BONES mat4s bound at a fixed binding
+// point; anim_model.vs declares the matching "BonePalette" block. A std140
+// mat4 array has a 64 byte stride, the same layout as a packed glm::mat4
+// array, so the animator can write straight into the mapped range.
+//
+// 100 bones * 64 bytes = 6400 bytes, well inside the 16 KB uniform block size
+// every GL 3.3 implementation has to support, so no texture-buffer fallback is
+// needed for palettes of this size.
+
+#ifndef BONE_PALETTE_H
+#define BONE_PALETTE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+
+#include <iostream>
+
+const int MAX_BONES = 100; // keep in sync with anim_model.vs
+
+class BonePaletteBuffer
+{
+public:
+    static const unsigned int BINDING = 0;
+
+    unsigned int ID;
+
+    BonePaletteBuffer()
+    {
+        GLint maxBlockSize = 0;
+        glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &maxBlockSize);
+        if ((GLint)SIZE > maxBlockSize)
+            std::cout << "ERROR::BONE_PALETTE: " << SIZE << " bytes exceeds GL_MAX_UNIFORM_BLOCK_SIZE (" << maxBlockSize << ")" << std::endl;
+
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferData(GL_UNIFORM_BUFFER, SIZE, NULL, GL_STREAM_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, ID);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    BonePaletteBuffer(const BonePaletteBuffer&) = delete;
+    BonePaletteBuffer& operator=(const BonePaletteBuffer&) = delete;
+
+    // Point the shader's BonePalette block at our binding point.
+    void Attach(const Shader& shader) const
+    {
+        unsigned int index = glGetUniformBlockIndex(shader.ID, "BonePalette");
+        if (index == GL_INVALID_INDEX)
+        {
+            std::cout << "ERROR::BONE_PALETTE: shader has no BonePalette block" << std::endl;
+            return;
+        }
+        glUniformBlockBinding(shader.ID, index, BINDING);
+    }
+
+    // Orphan the previous contents and map the whole palette for writing.
+    // Returns nullptr if the driver refuses the mapping.
+    glm::mat4* Map()
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        return (glm::mat4*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, SIZE, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    }
+
+    void Unmap()
+    {
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+private:
+    static const GLsizeiptr SIZE = MAX_BONES * sizeof(glm::mat4);
+};
+
+#endif
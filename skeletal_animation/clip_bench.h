@@ -0,0 +1,185 @@
+// clip_bench.h
+// --anim-bench: headless comparison of learnopengl's Bone::Update sampler
+// against ClipTracks (keyframe cursors + batched blend) on the demo's clips.
+// No window or GL context is needed, only the .dae files.
+//
+//   --anim-bench [options]
+//       --frames N       frames of playback per clip (default 20000)
+//       --dt SECONDS     frame length (default 1/60)
+//
+// For every clip it prints the time per frame to sample all channels with
+// each sampler, the same with random (seeking) sample times, and the largest
+// difference between the two local transforms.
+//
+//   --bake-clips
+//       Rebuild the clip cache from the .dae files and report how long the
+//       assimp path and the mapped cache take to load, plus the key reduction.
+
+#ifndef CLIP_BENCH_H
+#define CLIP_BENCH_H
+
+#include <glm/glm.hpp>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include <learnopengl/filesystem.h>
+#include <learnopengl/bone.h>
+
+#include "clip_sampler.h"
+#include "clip_cache.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+inline int runClipSamplerBench(int argc, char** argv, const char* const* files, int fileCount)
+{
+    unsigned int frames = 20000;
+    float dt = 1.0f / 60.0f;
+    for (int i = 2; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (hasValue && std::strcmp(argv[i], "--frames") == 0) frames = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else if (hasValue && std::strcmp(argv[i], "--dt") == 0) dt = (float)std::atof(argv[++i]);
+        else
+        {
+            std::cout << "Unknown anim-bench option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (frames == 0)
+        frames = 1;
+
+    std::cout << "clip,channels,keys,frames,bone_update_us,sampler_us,speedup,bone_update_seek_us,sampler_seek_us,max_error\n";
+    for (int f = 0; f < fileCount; ++f)
+    {
+        std::string path = FileSystem::getPath(files[f]);
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate);
+        if (!scene || scene->mNumAnimations == 0)
+        {
+            std::cout << "Failed to load animation clip: " << path << std::endl;
+            return 1;
+        }
+        const aiAnimation* anim = scene->mAnimations[0];
+
+        std::vector<Bone> bones;
+        bones.reserve(anim->mNumChannels);
+        for (unsigned int c = 0; c < anim->mNumChannels; ++c)
+            bones.emplace_back(anim->mChannels[c]->mNodeName.C_Str(), (int)c, anim->mChannels[c]);
+
+        ClipTracks tracks;
+        tracks.Load(anim);
+        ClipPlayback playback;
+        playback.Reset(tracks);
+        const unsigned int channels = tracks.ChannelCount();
+
+        // the same time sequences for both samplers: normal playback and random seeks
+        std::vector<float> playTimes(frames), seekTimes(frames);
+        std::mt19937 rng(7u);
+        std::uniform_real_distribution<float> anywhere(0.0f, tracks.duration);
+        float t = 0.0f;
+        for (unsigned int i = 0; i < frames; ++i)
+        {
+            t = std::fmod(t + tracks.ticksPerSecond * dt, tracks.duration);
+            playTimes[i] = t;
+            seekTimes[i] = anywhere(rng);
+        }
+
+        float sink = 0.0f; // keeps the work from being optimised away
+        auto timeBones = [&](const std::vector<float>& times) {
+            auto t0 = std::chrono::steady_clock::now();
+            for (float time : times)
+                for (Bone& bone : bones)
+                {
+                    bone.Update(time);
+                    sink += bone.GetLocalTransform()[3][0];
+                }
+            return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / frames;
+        };
+        auto timeSampler = [&](const std::vector<float>& times) {
+            auto t0 = std::chrono::steady_clock::now();
+            for (float time : times)
+            {
+                tracks.Sample(time, playback);
+                for (unsigned int c = 0; c < channels; ++c)
+                    sink += composeTransform(playback.pose, c)[3][0];
+            }
+            return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / frames;
+        };
+
+        double boneUs = timeBones(playTimes);
+        double samplerUs = timeSampler(playTimes);
+        double boneSeekUs = timeBones(seekTimes);
+        double samplerSeekUs = timeSampler(seekTimes);
+
+        float maxError = 0.0f;
+        playback.Reset(tracks);
+        for (float time : playTimes)
+        {
+            tracks.Sample(time, playback);
+            for (unsigned int c = 0; c < channels; ++c)
+            {
+                bones[c].Update(time);
+                glm::mat4 expected = bones[c].GetLocalTransform();
+                glm::mat4 actual = composeTransform(playback.pose, c);
+                for (int col = 0; col < 4; ++col)
+                    for (int row = 0; row < 4; ++row)
+                        maxError = std::max(maxError, std::fabs(expected[col][row] - actual[col][row]));
+            }
+        }
+
+        std::cout << files[f] << "," << channels << "," << tracks.KeyCount() << "," << frames << ","
+                  << boneUs << "," << samplerUs << "," << (samplerUs > 0.0 ? boneUs / samplerUs : 0.0) << ","
+                  << boneSeekUs << "," << samplerSeekUs << "," << maxError << (sink == 12345.0f ? " " : "") << std::endl;
+    }
+    return 0;
+}
+
+inline int runClipBake(const char* cachePath, const char* const* files, int fileCount)
+{
+    std::vector<std::string> sources;
+    for (int i = 0; i < fileCount; ++i)
+        sources.push_back(FileSystem::getPath(files[i]));
+    auto ms = [](std::chrono::steady_clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+    auto t0 = std::chrono::steady_clock::now();
+    Skeleton skeleton;
+    std::vector<SkeletonClip> clips(fileCount);
+    if (!loadClipsWithAssimp(sources, skeleton, clips.data()))
+        return 1;
+    auto t1 = std::chrono::steady_clock::now();
+
+    unsigned int keysBefore = 0, keysAfter = 0;
+    for (const SkeletonClip& clip : clips)
+        keysBefore += clip.tracks.KeyCount();
+    reduceClipKeys(clips.data(), fileCount);
+    for (const SkeletonClip& clip : clips)
+        keysAfter += clip.tracks.KeyCount();
+    if (!bakeClipCache(cachePath, sources, skeleton, clips.data()))
+        return 1;
+    auto t2 = std::chrono::steady_clock::now();
+
+    ClipCache cache;
+    Skeleton mappedSkeleton;
+    std::vector<SkeletonClip> mappedClips(fileCount);
+    if (!cache.Open(cachePath, sources) || !cache.Load(mappedSkeleton, mappedClips.data()))
+    {
+        std::cout << "Clip cache did not load back: " << cachePath << std::endl;
+        return 1;
+    }
+    auto t3 = std::chrono::steady_clock::now();
+
+    std::cout << "clips,nodes,keys_authored,keys_baked,file_bytes,assimp_ms,bake_ms,mapped_load_ms\n";
+    std::cout << fileCount << "," << skeleton.NodeCount() << "," << keysBefore << "," << keysAfter << ","
+              << cache.FileSize() << "," << ms(t1 - t0) << "," << ms(t2 - t1) << "," << ms(t3 - t2) << std::endl;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,362 @@
+// clip_cache.h
+// Baked animation clips. Parsing the COLLADA clips through assimp is slow, so
+// the first run bakes the skeleton hierarchy and every clip's key-reduced
+// tracks into one binary file. Later runs memory-map that file and point the
+// clips' track arrays straight into the mapping: nothing is parsed or copied
+// except the small skeleton table.
+//
+// The file remembers the path, size and modification time of every source
+// clip; if any of them differ the cache is stale and is rebuilt from assimp.
+// Bone ids are not baked: the skeleton is bound to the model's bone map by
+// name after loading (Skeleton::BindBones), so the cache stays valid however
+// the model numbers its bones.
+//
+// Layout (native byte order, it is a local cache and not an exchange format):
+//
+//     ClipCacheHeader
+//     ClipCacheSource[sourceCount]
+//     ClipCacheNode[nodeCount]
+//     ClipCacheClip[clipCount]
+//     data blobs (uint32/float arrays, 4-byte aligned), strings
+
+#ifndef CLIP_CACHE_H
+#define CLIP_CACHE_H
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include "skeleton.h"
+#include "clip_sampler.h"
+#include "../common/mapped_file.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+const uint32_t CLIP_CACHE_VERSION = 1;
+const char CLIP_CACHE_MAGIC[8] = { 'L', 'O', 'G', 'L', 'C', 'L', 'I', 'P' };
+
+// key reduction tolerances, per component
+const float BAKE_POSITION_TOLERANCE = 1e-3f; // model units
+const float BAKE_ROTATION_TOLERANCE = 1e-4f; // quaternion components
+const float BAKE_SCALE_TOLERANCE = 1e-4f;
+
+struct ClipCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t sourceCount;
+    uint32_t nodeCount;
+    uint32_t clipCount;
+    uint32_t reserved[2];
+};
+
+struct ClipCacheSource
+{
+    uint64_t modified;
+    uint64_t size;
+    uint32_t pathOffset;
+    uint32_t pathLength;
+};
+
+struct ClipCacheNode
+{
+    int32_t parent;
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t reserved;
+    float bindLocal[16];
+};
+
+struct ClipCacheTrack
+{
+    uint32_t keyCount;
+    uint32_t firstOffset;    // uint32[channelCount]
+    uint32_t countOffset;    // uint32[channelCount]
+    uint32_t timeOffset;     // float[keyCount]
+    uint32_t valueOffset[4]; // float[keyCount] each
+};
+
+struct ClipCacheClip
+{
+    float duration;
+    float ticksPerSecond;
+    uint32_t channelCount;
+    uint32_t channelMapOffset; // int32[nodeCount], the node -> channel table
+    ClipCacheTrack tracks[3];  // position, rotation, scale
+};
+
+// Slow path: read one clip through assimp. The clip is bound to its own copy
+// of the hierarchy, so clips can be read in parallel; check the copies with
+// Skeleton::SameHierarchy before sharing one skeleton between them.
+inline bool loadClipWithAssimp(const std::string& path, Skeleton& hierarchy, SkeletonClip& clip)
+{
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate);
+    if (!scene || !scene->mRootNode || scene->mNumAnimations == 0)
+    {
+        std::cout << "Failed to load animation clip: " << path << std::endl;
+        return false;
+    }
+    hierarchy.Build(scene->mRootNode);
+    return clip.Build(hierarchy, scene);
+}
+
+// All sources one after the other; tracks are kept exactly as authored.
+inline bool loadClipsWithAssimp(const std::vector<std::string>& sources, Skeleton& skeleton, SkeletonClip* clips)
+{
+    for (unsigned int i = 0; i < sources.size(); ++i)
+    {
+        Skeleton hierarchy;
+        if (!loadClipWithAssimp(sources[i], hierarchy, clips[i]))
+            return false;
+        if (i == 0)
+            skeleton = hierarchy;
+        else if (!skeleton.SameHierarchy(hierarchy))
+        {
+            std::cout << "Animation hierarchy does not match the skeleton: " << sources[i] << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+inline void reduceClipKeys(SkeletonClip* clips, unsigned int clipCount)
+{
+    for (unsigned int i = 0; i < clipCount; ++i)
+        clips[i].tracks.Reduce(BAKE_POSITION_TOLERANCE, BAKE_ROTATION_TOLERANCE, BAKE_SCALE_TOLERANCE);
+}
+
+// Write the cache file. It is written next to path first and renamed into
+// place, so a crash never leaves a half-written cache behind.
+inline bool bakeClipCache(const std::string& path, const std::vector<std::string>& sources,
+                          const Skeleton& skeleton, const SkeletonClip* clips)
+{
+    const uint32_t clipCount = (uint32_t)sources.size();
+    const uint32_t nodeCount = skeleton.NodeCount();
+
+    std::vector<char> data; // everything after the tables
+    const uint32_t tableBytes = (uint32_t)(sizeof(ClipCacheHeader) + sources.size() * sizeof(ClipCacheSource)
+                                           + nodeCount * sizeof(ClipCacheNode) + clipCount * sizeof(ClipCacheClip));
+    auto append = [&](const void* bytes, size_t n) {
+        while (data.size() % 4 != 0)
+            data.push_back(0);
+        uint32_t offset = tableBytes + (uint32_t)data.size();
+        data.insert(data.end(), (const char*)bytes, (const char*)bytes + n);
+        return offset;
+    };
+
+    ClipCacheHeader header;
+    std::memcpy(header.magic, CLIP_CACHE_MAGIC, sizeof(header.magic));
+    header.version = CLIP_CACHE_VERSION;
+    header.sourceCount = clipCount;
+    header.nodeCount = nodeCount;
+    header.clipCount = clipCount;
+    header.reserved[0] = header.reserved[1] = 0;
+
+    std::vector<ClipCacheSource> sourceTable(clipCount);
+    for (uint32_t i = 0; i < clipCount; ++i)
+    {
+        ClipCacheSource& s = sourceTable[i];
+        if (!fileStamp(sources[i], s.modified, s.size))
+        {
+            std::cout << "Cannot stat animation clip: " << sources[i] << std::endl;
+            return false;
+        }
+        s.pathOffset = append(sources[i].data(), sources[i].size());
+        s.pathLength = (uint32_t)sources[i].size();
+    }
+
+    std::vector<ClipCacheNode> nodeTable(nodeCount);
+    for (uint32_t i = 0; i < nodeCount; ++i)
+    {
+        ClipCacheNode& n = nodeTable[i];
+        n.parent = skeleton.parent[i];
+        n.nameOffset = append(skeleton.name[i].data(), skeleton.name[i].size());
+        n.nameLength = (uint32_t)skeleton.name[i].size();
+        n.reserved = 0;
+        for (int c = 0; c < 4; ++c)
+            for (int r = 0; r < 4; ++r)
+                n.bindLocal[c * 4 + r] = skeleton.bindLocal[i][c][r];
+    }
+
+    std::vector<ClipCacheClip> clipTable(clipCount);
+    for (uint32_t i = 0; i < clipCount; ++i)
+    {
+        const ClipTracks& tracks = clips[i].tracks;
+        ClipCacheClip& c = clipTable[i];
+        c.duration = tracks.duration;
+        c.ticksPerSecond = tracks.ticksPerSecond;
+        c.channelCount = tracks.ChannelCount();
+        c.channelMapOffset = append(clips[i].channel.data(), nodeCount * sizeof(int32_t));
+
+        const ClipKeyTrack* source[3] = { &tracks.positions, &tracks.rotations, &tracks.scales };
+        for (int t = 0; t < 3; ++t)
+        {
+            ClipCacheTrack& out = c.tracks[t];
+            out.keyCount = source[t]->keyCount;
+            out.firstOffset = append(source[t]->first, c.channelCount * sizeof(uint32_t));
+            out.countOffset = append(source[t]->count, c.channelCount * sizeof(uint32_t));
+            out.timeOffset = append(source[t]->time, out.keyCount * sizeof(float));
+            for (int v = 0; v < 4; ++v)
+                out.valueOffset[v] = append(source[t]->value[v], out.keyCount * sizeof(float));
+        }
+    }
+
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            std::cout << "Cannot write clip cache: " << tempPath << std::endl;
+            return false;
+        }
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)sourceTable.data(), sourceTable.size() * sizeof(ClipCacheSource));
+        file.write((const char*)nodeTable.data(), nodeTable.size() * sizeof(ClipCacheNode));
+        file.write((const char*)clipTable.data(), clipTable.size() * sizeof(ClipCacheClip));
+        file.write(data.data(), data.size());
+        if (!file)
+        {
+            std::cout << "Cannot write clip cache: " << tempPath << std::endl;
+            return false;
+        }
+    }
+    std::remove(path.c_str());
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        std::cout << "Cannot write clip cache: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+class ClipCache
+{
+public:
+    // Map the cache and check it was baked from exactly these sources and
+    // that none of them changed since. Returns false if it is missing, stale
+    // or damaged; the caller then rebuilds it.
+    bool Open(const std::string& path, const std::vector<std::string>& sources)
+    {
+        if (!file.Open(path))
+            return false;
+
+        const ClipCacheHeader* header = at<ClipCacheHeader>(0, 1);
+        if (!header || std::memcmp(header->magic, CLIP_CACHE_MAGIC, sizeof(header->magic)) != 0
+            || header->version != CLIP_CACHE_VERSION || header->sourceCount != sources.size()
+            || header->clipCount != sources.size())
+            return fail();
+
+        sourceTable = at<ClipCacheSource>(sizeof(ClipCacheHeader), header->sourceCount);
+        nodeTable = at<ClipCacheNode>(sizeof(ClipCacheHeader) + header->sourceCount * sizeof(ClipCacheSource), header->nodeCount);
+        clipTable = at<ClipCacheClip>(sizeof(ClipCacheHeader) + header->sourceCount * sizeof(ClipCacheSource)
+                                      + header->nodeCount * sizeof(ClipCacheNode), header->clipCount);
+        if (!sourceTable || !nodeTable || !clipTable)
+            return fail();
+        nodeCount = header->nodeCount;
+        clipCount = header->clipCount;
+
+        for (uint32_t i = 0; i < clipCount; ++i)
+        {
+            const ClipCacheSource& s = sourceTable[i];
+            const char* bakedPath = at<char>(s.pathOffset, s.pathLength);
+            uint64_t modified, size;
+            if (!bakedPath || sources[i] != std::string(bakedPath, s.pathLength)
+                || !fileStamp(sources[i], modified, size) || modified != s.modified || size != s.size)
+                return fail();
+        }
+        return true;
+    }
+
+    // Fill skeleton and clips from the open cache. The skeleton table is
+    // copied; clip tracks point into the mapping, which must stay open for as
+    // long as the clips are used.
+    bool Load(Skeleton& skeleton, SkeletonClip* clips) const
+    {
+        skeleton.parent.resize(nodeCount);
+        skeleton.bindLocal.resize(nodeCount);
+        skeleton.name.resize(nodeCount);
+        for (uint32_t i = 0; i < nodeCount; ++i)
+        {
+            const ClipCacheNode& n = nodeTable[i];
+            const char* name = at<char>(n.nameOffset, n.nameLength);
+            if (!name || n.parent >= (int32_t)i)
+                return false;
+            skeleton.parent[i] = n.parent;
+            skeleton.name[i].assign(name, n.nameLength);
+            for (int c = 0; c < 4; ++c)
+                skeleton.bindLocal[i][c] = glm::vec4(n.bindLocal[c * 4], n.bindLocal[c * 4 + 1], n.bindLocal[c * 4 + 2], n.bindLocal[c * 4 + 3]);
+        }
+
+        for (uint32_t i = 0; i < clipCount; ++i)
+        {
+            const ClipCacheClip& c = clipTable[i];
+            ClipTracks& tracks = clips[i].tracks;
+            tracks.duration = c.duration;
+            tracks.ticksPerSecond = c.ticksPerSecond;
+            tracks.channelCount = c.channelCount;
+            tracks.channelName.clear();
+
+            const int32_t* channelMap = at<int32_t>(c.channelMapOffset, nodeCount);
+            if (!channelMap)
+                return false;
+            clips[i].channel.assign(channelMap, channelMap + nodeCount);
+            for (int channel : clips[i].channel)
+                if (channel >= (int)c.channelCount)
+                    return false;
+
+            ClipKeyTrack* target[3] = { &tracks.positions, &tracks.rotations, &tracks.scales };
+            for (int t = 0; t < 3; ++t)
+            {
+                const ClipCacheTrack& in = c.tracks[t];
+                ClipKeyTrack& out = *target[t];
+                out = ClipKeyTrack();
+                out.keyCount = in.keyCount;
+                out.first = at<uint32_t>(in.firstOffset, c.channelCount);
+                out.count = at<uint32_t>(in.countOffset, c.channelCount);
+                out.time = at<float>(in.timeOffset, in.keyCount);
+                for (int v = 0; v < 4; ++v)
+                    out.value[v] = at<float>(in.valueOffset[v], in.keyCount);
+                if (!out.first || !out.count || !out.time || !out.value[0] || !out.value[1] || !out.value[2] || !out.value[3])
+                    return false;
+                for (uint32_t ch = 0; ch < c.channelCount; ++ch)
+                    if (out.count[ch] == 0 || out.first[ch] + out.count[ch] > in.keyCount)
+                        return false;
+            }
+        }
+        return true;
+    }
+
+    size_t FileSize() const { return file.Size(); }
+
+private:
+    MappedFile file;
+    const ClipCacheSource* sourceTable = nullptr;
+    const ClipCacheNode* nodeTable = nullptr;
+    const ClipCacheClip* clipTable = nullptr;
+    uint32_t nodeCount = 0;
+    uint32_t clipCount = 0;
+
+    // count elements of T at offset, or nullptr if that runs past the end
+    template <typename T>
+    const T* at(uint64_t offset, uint64_t count) const
+    {
+        if (offset % alignof(T) != 0 || offset + count * sizeof(T) > file.Size())
+            return nullptr;
+        return (const T*)(file.Data() + offset);
+    }
+
+    bool fail()
+    {
+        file.Close();
+        return false;
+    }
+};
+
+#endif
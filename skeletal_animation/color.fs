@@ -0,0 +1,10 @@
+#version 330 core
+// Unlit colour from the vertex stage; shared by the level (vertex_color.vs)
+// and the instanced cubes (instanced_color.vs).
+out vec4 FragColor;
+
+in vec3 Color;
+
+void main() {
+    FragColor = vec4(Color, 1.0);
+}
@@ -0,0 +1,279 @@
+// crowd_animation.h
+// GPU skinning for crowds: clips baked into an animation texture, soldiers
+// drawn with one instanced call per mesh.
+//
+// At load time every clip is sampled at a fixed rate and its final bone
+// matrices are written into one RGBA32F texture. Each row holds one frame;
+// each bone takes three texels (the top three rows of its affine matrix):
+//
+//     texel (bone * 3 + r, frame) = row r of palette[bone] at that frame
+//
+// Frames of all clips are stacked, and crowdClips[] in anim_model.vs tells the
+// shader where each clip starts, how many frames it has and how long it runs.
+// A soldier is then just a transform, a clip index and a time offset; the
+// vertex shader finds its two nearest frames and blends them. No animator
+// update and no palette upload per character, so the CPU cost per soldier is
+// writing one CrowdInstance.
+
+#ifndef CROWD_ANIMATION_H
+#define CROWD_ANIMATION_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+#include <learnopengl/model_animation.h>
+
+#include "bone_palette.h"
+#include "skeleton.h"
+#include "skinned_animator.h"
+#include "../common/shader_reflect.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+const int MAX_CROWD_CLIPS = 16;      // keep in sync with anim_model.vs
+const float CROWD_BAKE_RATE = 30.0f; // baked frames per second of clip time
+
+// per-instance data of the crowd draw (locations 7-11 of anim_model.vs)
+struct CrowdInstance
+{
+    glm::mat4 model;
+    glm::vec2 anim; // clip index, time offset in seconds
+};
+
+// anim_model's plain uniforms, resolved once after linking
+struct SkinnedUniforms
+{
+    Uniform<glm::mat4> model;
+    Uniform<bool> crowd;
+    Uniform<int> boneTexture;
+    Uniform<glm::vec3> crowdClips[MAX_CROWD_CLIPS];
+
+    void Find(const ReflectedShader& shader)
+    {
+        model = shader.Find<glm::mat4>("model");
+        crowd = shader.Find<bool>("crowd");
+        boneTexture = shader.Find<int>("boneTexture");
+        for (int c = 0; c < MAX_CROWD_CLIPS; ++c)
+            crowdClips[c] = shader.Find<glm::vec3>("crowdClips[" + std::to_string(c) + "]");
+    }
+};
+
+class CrowdAnimationTexture
+{
+public:
+    static const unsigned int UNIT = 8; // clear of the model's material textures
+
+    unsigned int ID = 0;
+    int width = 0;
+    int height = 0;
+    std::vector<glm::vec3> clipInfo; // first frame, frame count, length in seconds
+
+    // Sample count clips of skeleton into the CPU copy of the texture. maxRows
+    // is GL_MAX_TEXTURE_SIZE; the bake rate is halved until every frame fits.
+    // Touches no GL, so it can run on a loader worker.
+    bool Bake(const Skeleton& skeleton, const SkeletonClip* clips, int count, int maxRows)
+    {
+        if (count <= 0 || count > MAX_CROWD_CLIPS)
+        {
+            std::cout << "ERROR::CROWD: cannot bake " << count << " clips (at most " << MAX_CROWD_CLIPS << ")" << std::endl;
+            return false;
+        }
+
+        float rate = CROWD_BAKE_RATE;
+        while (frameTotal(clips, count, rate) > maxRows && rate > 1.0f)
+            rate *= 0.5f;
+
+        width = MAX_BONES * 3;
+        height = frameTotal(clips, count, rate);
+        texels.assign((size_t)width * height, glm::vec4(0.0f));
+        std::vector<glm::mat4> palette(MAX_BONES);
+        clipInfo.clear();
+
+        int row = 0;
+        for (int c = 0; c < count; ++c)
+        {
+            const ClipTracks& tracks = clips[c].tracks;
+            int frames = clipFrames(clips[c], rate);
+            clipInfo.push_back(glm::vec3((float)row, (float)frames, clipSeconds(clips[c])));
+
+            // frames are spread over the whole clip so the last one blends back into the first
+            SkinnedAnimator animator(&skeleton, &clips[c]);
+            for (int f = 0; f < frames; ++f, ++row)
+            {
+                animator.EvaluateAt(tracks.duration * f / frames, palette.data());
+                glm::vec4* dst = &texels[(size_t)row * width];
+                for (int b = 0; b < MAX_BONES; ++b)
+                    for (int r = 0; r < 3; ++r)
+                        dst[b * 3 + r] = glm::vec4(palette[b][0][r], palette[b][1][r], palette[b][2][r], palette[b][3][r]);
+            }
+        }
+        return true;
+    }
+
+    // Create the texture from the last Bake and drop the CPU copy.
+    void Upload()
+    {
+        if (!ID)
+            glGenTextures(1, &ID);
+        glBindTexture(GL_TEXTURE_2D, ID);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, texels.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        std::vector<glm::vec4>().swap(texels);
+    }
+
+    float ClipSeconds(int clip) const { return clipInfo[clip].z; }
+    size_t Bytes() const { return (size_t)width * height * sizeof(glm::vec4); }
+
+    // Bind the texture and upload the clip table; shader must be in use.
+    void Bind(ReflectedShader& shader, const SkinnedUniforms& uniforms) const
+    {
+        glActiveTexture(GL_TEXTURE0 + UNIT);
+        glBindTexture(GL_TEXTURE_2D, ID);
+        glActiveTexture(GL_TEXTURE0);
+        shader.Set(uniforms.boneTexture, (int)UNIT);
+        for (size_t c = 0; c < clipInfo.size(); ++c)
+            shader.Set(uniforms.crowdClips[c], clipInfo[c]);
+    }
+
+private:
+    std::vector<glm::vec4> texels;
+
+    static float clipSeconds(const SkeletonClip& clip)
+    {
+        const ClipTracks& tracks = clip.tracks;
+        return tracks.ticksPerSecond > 0.0f ? tracks.duration / tracks.ticksPerSecond : tracks.duration;
+    }
+
+    static int clipFrames(const SkeletonClip& clip, float rate)
+    {
+        return std::max(1, (int)std::lround(clipSeconds(clip) * rate));
+    }
+
+    static int frameTotal(const SkeletonClip* clips, int count, float rate)
+    {
+        int total = 0;
+        for (int c = 0; c < count; ++c)
+            total += clipFrames(clips[c], rate);
+        return total;
+    }
+};
+
+// Draws any number of CrowdInstances of a skinned model. Each mesh gets a
+// VAO of its own for the crowd, with the instance attributes added. The
+// vertex layout is Vertex's, as the model loader sets it up (locations 0-6
+// of anim_model.vs); learnopengl keeps a mesh's GL buffers private, so the
+// crowd uploads its own copy of each mesh's vertices and indices rather than
+// reading the bindings back from the mesh's VAO. The player's draw through
+// the mesh VAOs is left untouched.
+class CrowdRenderer
+{
+public:
+    unsigned int instanceVBO = 0;
+    unsigned int capacity = 0;
+    std::vector<CrowdInstance> instances; // reserved to capacity, filled per frame
+
+    void Init(Model& model, unsigned int maxInstances)
+    {
+        capacity = maxInstances;
+        instances.reserve(capacity);
+        meshes = &model.meshes;
+
+        glGenBuffers(1, &instanceVBO); // sized by each frame's upload
+        for (Mesh& mesh : model.meshes)
+        {
+            vaos.push_back(createMeshVAO(mesh));
+            glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+            for (int col = 0; col < 4; ++col)
+            {
+                glEnableVertexAttribArray(7 + col);
+                glVertexAttribPointer(7 + col, 4, GL_FLOAT, GL_FALSE, sizeof(CrowdInstance),
+                                      (void*)(offsetof(CrowdInstance, model) + col * sizeof(glm::vec4)));
+                glVertexAttribDivisor(7 + col, 1);
+            }
+            glEnableVertexAttribArray(11);
+            glVertexAttribPointer(11, 2, GL_FLOAT, GL_FALSE, sizeof(CrowdInstance), (void*)offsetof(CrowdInstance, anim));
+            glVertexAttribDivisor(11, 1);
+        }
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // Upload this frame's instances (orphaning last frame's storage, only as
+    // much as is drawn) and draw them all, one glDrawElementsInstanced per
+    // mesh. shader must be in use with crowd mode on and the animation
+    // texture bound.
+    void Draw(ReflectedShader& shader, const ModelSamplers& samplers)
+    {
+        GLsizei count = (GLsizei)std::min<size_t>(instances.size(), capacity);
+        if (count == 0)
+            return;
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, count * sizeof(CrowdInstance), instances.data(), GL_STREAM_DRAW);
+
+        // anim_model.fs only samples texture_diffuse1
+        shader.Set(samplers.diffuse[0], 0);
+        for (size_t m = 0; m < meshes->size(); ++m)
+        {
+            const Mesh& mesh = (*meshes)[m];
+            for (const Texture& texture : mesh.textures)
+                if (texture.type == "texture_diffuse")
+                {
+                    glBindTexture(GL_TEXTURE_2D, texture.id);
+                    break;
+                }
+            glBindVertexArray(vaos[m]);
+            glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)mesh.indices.size(), GL_UNSIGNED_INT, 0, count);
+        }
+        glBindVertexArray(0);
+    }
+
+private:
+    std::vector<Mesh>* meshes = nullptr;
+    std::vector<unsigned int> vaos; // one per mesh, with the instance attributes
+
+    // New VAO over a copy of mesh's vertices and indices, laid out as the
+    // model loader lays out Vertex; left bound.
+    static unsigned int createMeshVAO(const Mesh& mesh)
+    {
+        unsigned int vao, vbo, ebo;
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glGenBuffers(1, &ebo);
+
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(Vertex), mesh.vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), mesh.indices.data(), GL_STATIC_DRAW);
+
+        const struct { GLuint location; GLint size; size_t offset; } floats[] = {
+            { 0, 3, offsetof(Vertex, Position) },
+            { 1, 3, offsetof(Vertex, Normal) },
+            { 2, 2, offsetof(Vertex, TexCoords) },
+            { 3, 3, offsetof(Vertex, Tangent) },
+            { 4, 3, offsetof(Vertex, Bitangent) },
+            { 6, MAX_BONE_INFLUENCE, offsetof(Vertex, m_Weights) },
+        };
+        for (const auto& a : floats)
+        {
+            glEnableVertexAttribArray(a.location);
+            glVertexAttribPointer(a.location, a.size, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)a.offset);
+        }
+        glEnableVertexAttribArray(5); // ivec4 boneIds
+        glVertexAttribIPointer(5, MAX_BONE_INFLUENCE, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
+        return vao;
+    }
+};
+
+#endif
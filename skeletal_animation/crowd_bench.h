@@ -0,0 +1,228 @@
+// crowd_bench.h
+// --crowd-bench: draw a grid of animated soldiers at increasing crowd sizes
+// three ways: the baked-texture instanced path, the old way (one animator
+// update, palette upload and model draw per soldier), and the old way with
+// poses coming from the animation LOD system. Runs in a hidden window after
+// the normal asset load, since every path needs GL.
+//
+//   --crowd-bench [options]
+//       --frames N                frames drawn per crowd size (default 200)
+//       --max N                   largest crowd (default 8192)
+//       --max-per-character N     largest crowd for the per-soldier path (default 1000)
+//
+// Prints CSV: per crowd size, the CPU time to build and submit a frame and
+// the full frame time (glFinish), in milliseconds, for each path, plus the
+// average poses the LOD system evaluated, shared and skipped per frame.
+
+#ifndef CROWD_BENCH_H
+#define CROWD_BENCH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/shader_m.h>
+#include <learnopengl/model_animation.h>
+
+#include "anim_lod.h"
+#include "bone_palette.h"
+#include "crowd_animation.h"
+#include "skeleton.h"
+#include "skinned_animator.h"
+#include "../common/frame_constants.h"
+#include "../common/frustum.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Soldiers on a square grid one unit apart, facing random directions.
+inline void crowdGrid(unsigned int count, std::vector<glm::mat4>& transforms, float& extent, std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+    unsigned int side = (unsigned int)std::ceil(std::sqrt((double)count));
+    extent = (float)side;
+    transforms.resize(count);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        glm::vec3 pos((float)(i % side) - 0.5f * side, 0.0f, (float)(i / side) - 0.5f * side);
+        glm::mat4 m = glm::translate(glm::mat4(1.0f), pos);
+        m = glm::rotate(m, angle(rng), glm::vec3(0.0f, 1.0f, 0.0f));
+        transforms[i] = glm::scale(m, glm::vec3(0.5f));
+    }
+}
+
+inline int runCrowdBench(int argc, char** argv, Model& model, Shader& shader, BonePaletteBuffer& bonePalette,
+                         const Skeleton& skeleton, const SkeletonClip* clips, int clipCount,
+                         const CrowdAnimationTexture& bakedClips, CrowdRenderer& crowd)
+{
+    unsigned int frames = 200, maxCrowd = 8192, maxPerCharacter = 1000;
+    for (int i = 2; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (hasValue && std::strcmp(argv[i], "--frames") == 0) frames = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else if (hasValue && std::strcmp(argv[i], "--max") == 0) maxCrowd = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else if (hasValue && std::strcmp(argv[i], "--max-per-character") == 0) maxPerCharacter = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            std::cout << "Unknown crowd-bench option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (frames == 0)
+        frames = 1;
+    if (maxCrowd > crowd.capacity)
+        maxCrowd = crowd.capacity;
+
+    const float dt = 1.0f / 60.0f;
+    auto ms = [](std::chrono::steady_clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    std::mt19937 rng(7u);
+    std::uniform_real_distribution<float> phase(0.0f, 1.0f);
+    std::vector<glm::mat4> transforms;
+
+    glEnable(GL_DEPTH_TEST);
+    shader.use();
+    ReflectedShader reflected(shader.ID);
+    FrameConstantsBuffer frameConstants; // the bench's own camera and clock
+    frameConstants.Attach(shader.ID);
+    SkinnedUniforms uniforms;
+    uniforms.Find(reflected);
+    ModelSamplers samplers;
+    samplers.Find(reflected);
+    bakedClips.Bind(reflected, uniforms);
+
+    AnimLodSystem animLod(&skeleton, clips, clipCount, maxCrowd);
+    animLod.SetReducedMask(lodNodeMask(skeleton, model, 0.01f));
+    std::vector<AnimLodCharacter> characters;
+
+    std::cout << "soldiers,instanced_cpu_ms,instanced_frame_ms,per_character_cpu_ms,per_character_frame_ms,"
+                 "lod_cpu_ms,lod_frame_ms,lod_evaluated,lod_shared,lod_skipped\n";
+    const unsigned int sizes[] = { 1, 10, 100, 250, 500, 1000, 2000, 4000, 8000, 16000, 32000, 64000 };
+    for (unsigned int count : sizes)
+    {
+        if (count > maxCrowd)
+            break;
+
+        float extent;
+        crowdGrid(count, transforms, extent, rng);
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 4.0f * extent + 10.0f);
+        glm::vec3 eye(0.0f, 0.8f * extent + 2.0f, 1.2f * extent + 2.0f);
+        glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        Frustum frustum;
+        frustum.Extract(projection * view);
+        frameConstants.Update(view, projection, eye, 0.0f);
+
+        std::vector<glm::vec2> anims(count);
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            int clip = (int)(i % clipCount);
+            anims[i] = glm::vec2((float)clip, phase(rng) * bakedClips.ClipSeconds(clip));
+        }
+
+        // instanced: rebuild the instance list every frame, as the game does
+        double instancedCpu = 0.0, instancedFrame = 0.0;
+        reflected.Set(uniforms.crowd, true);
+        for (unsigned int f = 0; f < frames; ++f)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            frameConstants.Update(view, projection, eye, f * dt);
+            crowd.instances.clear();
+            for (unsigned int i = 0; i < count; ++i)
+                crowd.instances.push_back({ transforms[i], anims[i] });
+            crowd.Draw(reflected, samplers);
+            auto t1 = std::chrono::steady_clock::now();
+            glFinish();
+            auto t2 = std::chrono::steady_clock::now();
+            instancedCpu += ms(t1 - t0);
+            instancedFrame += ms(t2 - t0);
+        }
+        std::cout << count << "," << instancedCpu / frames << "," << instancedFrame / frames << ",";
+
+        if (count > maxPerCharacter)
+        {
+            std::cout << ",,,,,," << std::endl;
+            continue;
+        }
+
+        // per soldier: its own animator, palette upload and draw
+        std::vector<SkinnedAnimator> animators;
+        animators.reserve(count);
+        std::vector<glm::mat4> scratch(MAX_BONES);
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            animators.emplace_back(&skeleton, &clips[(int)anims[i].x]);
+            animators.back().UpdateAnimation(anims[i].y, scratch.data());
+        }
+
+        double characterCpu = 0.0, characterFrame = 0.0;
+        reflected.Set(uniforms.crowd, false);
+        for (unsigned int f = 0; f < frames; ++f)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            for (unsigned int i = 0; i < count; ++i)
+            {
+                if (glm::mat4* palette = bonePalette.Map())
+                {
+                    animators[i].UpdateAnimation(dt, palette);
+                    bonePalette.Unmap();
+                }
+                reflected.Set(uniforms.model, transforms[i]);
+                drawModel(model, reflected, samplers);
+            }
+            auto t1 = std::chrono::steady_clock::now();
+            glFinish();
+            auto t2 = std::chrono::steady_clock::now();
+            characterCpu += ms(t1 - t0);
+            characterFrame += ms(t2 - t0);
+        }
+        std::cout << characterCpu / frames << "," << characterFrame / frames << ",";
+
+        // per soldier, with poses from the LOD system
+        double lodCpu = 0.0, lodFrame = 0.0;
+        double evaluated = 0.0, shared = 0.0, skipped = 0.0;
+        for (unsigned int f = 0; f < frames; ++f)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            characters.clear();
+            for (unsigned int i = 0; i < count; ++i)
+            {
+                glm::vec3 pos(transforms[i][3]);
+                characters.push_back({ i, (int)anims[i].x, anims[i].y + f * dt, glm::length(pos - eye),
+                                       frustum.SphereVisible(pos + glm::vec3(0.0f, 0.75f, 0.0f), 1.0f) });
+            }
+            animLod.Update(characters.data(), count);
+            for (unsigned int i = 0; i < count; ++i)
+            {
+                if (!characters[i].visible)
+                    continue;
+                if (glm::mat4* palette = bonePalette.Map())
+                {
+                    std::memcpy(palette, animLod.Palette(i), MAX_BONES * sizeof(glm::mat4));
+                    bonePalette.Unmap();
+                }
+                reflected.Set(uniforms.model, transforms[i]);
+                drawModel(model, reflected, samplers);
+            }
+            auto t1 = std::chrono::steady_clock::now();
+            glFinish();
+            auto t2 = std::chrono::steady_clock::now();
+            lodCpu += ms(t1 - t0);
+            lodFrame += ms(t2 - t0);
+            evaluated += animLod.Stats().evaluated;
+            shared += animLod.Stats().shared;
+            skipped += animLod.Stats().skipped;
+        }
+        std::cout << lodCpu / frames << "," << lodFrame / frames << "," << evaluated / frames << ","
+                  << shared / frames << "," << skipped / frames << std::endl;
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,220 @@
+// entity_pool.h
+// Fixed-capacity structure-of-arrays pools for the shooter's bullets and targets.
+//
+// Live entities are always packed into [0, Size()) so update, collision and draw
+// passes walk each field array linearly. Removal is swap-and-pop: the last live
+// entity moves into the hole, which is O(1) and never shifts the tail. Outside
+// code that needs to hold on to an entity keeps an EntityHandle; the generation
+// counter makes handles to killed (and possibly reused) slots fail IsAlive().
+//
+// All storage is sized once in the constructor, so spawning and killing never
+// touch the heap.
+
+#ifndef ENTITY_POOL_H
+#define ENTITY_POOL_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+
+struct EntityHandle
+{
+    uint32_t slot = ~0u;
+    uint32_t generation = 0;
+
+    bool IsValid() const { return slot != ~0u; }
+};
+
+// Bookkeeping shared by the pools: maps stable slots <-> packed (dense) indices.
+class HandleTable
+{
+public:
+    explicit HandleTable(uint32_t capacity)
+        : size(0), slotGeneration(capacity, 0), slotToDense(capacity, 0), denseToSlot(capacity, 0), freeSlots(capacity)
+    {
+        // hand out low slots first
+        for (uint32_t i = 0; i < capacity; ++i)
+            freeSlots[i] = capacity - 1 - i;
+    }
+
+    uint32_t Size() const { return size; }
+    uint32_t Capacity() const { return (uint32_t)slotToDense.size(); }
+    bool Full() const { return freeSlots.empty(); }
+
+    // Appends a new entity at dense index Size(). Returns an invalid handle when full.
+    EntityHandle Create()
+    {
+        if (freeSlots.empty())
+            return EntityHandle();
+        uint32_t slot = freeSlots.back();
+        freeSlots.pop_back();
+        slotToDense[slot] = size;
+        denseToSlot[size] = slot;
+        ++size;
+        return EntityHandle{ slot, slotGeneration[slot] };
+    }
+
+    bool IsAlive(EntityHandle h) const
+    {
+        return h.slot < Capacity() && slotGeneration[h.slot] == h.generation && slotToDense[h.slot] < size
+            && denseToSlot[slotToDense[h.slot]] == h.slot;
+    }
+
+    uint32_t DenseIndex(EntityHandle h) const { return slotToDense[h.slot]; }
+
+    EntityHandle HandleAt(uint32_t dense) const
+    {
+        uint32_t slot = denseToSlot[dense];
+        return EntityHandle{ slot, slotGeneration[slot] };
+    }
+
+    // Frees the entity at dense index i. The last entity is moved into i; the
+    // caller has to move its field data the same way (see SwapPop below).
+    // Returns the dense index that was moved from (== i when i was the last one).
+    uint32_t RemoveAt(uint32_t i)
+    {
+        uint32_t last = size - 1;
+        uint32_t slot = denseToSlot[i];
+        ++slotGeneration[slot]; // invalidate outstanding handles
+        freeSlots.push_back(slot);
+
+        if (i != last)
+        {
+            uint32_t movedSlot = denseToSlot[last];
+            denseToSlot[i] = movedSlot;
+            slotToDense[movedSlot] = i;
+        }
+        --size;
+        return last;
+    }
+
+    void Clear()
+    {
+        while (size > 0)
+            RemoveAt(size - 1);
+    }
+
+private:
+    uint32_t size;
+    std::vector<uint32_t> slotGeneration;
+    std::vector<uint32_t> slotToDense;
+    std::vector<uint32_t> denseToSlot;
+    std::vector<uint32_t> freeSlots; // reserved to capacity, so push_back never reallocates
+};
+
+template <typename T>
+inline void SwapPop(std::vector<T>& field, uint32_t i, uint32_t last)
+{
+    field[i] = field[last];
+}
+
+class BulletPool
+{
+public:
+    std::vector<glm::vec3> position;
+    std::vector<glm::vec3> prevPosition; // position before the last update, for render interpolation
+    std::vector<glm::vec3> direction;
+    std::vector<float> speed;
+    std::vector<float> life;
+
+    explicit BulletPool(uint32_t capacity)
+        : position(capacity), prevPosition(capacity), direction(capacity), speed(capacity), life(capacity), handles(capacity) {}
+
+    uint32_t Size() const { return handles.Size(); }
+    uint32_t Capacity() const { return handles.Capacity(); }
+    bool IsAlive(EntityHandle h) const { return handles.IsAlive(h); }
+
+    EntityHandle Spawn(const glm::vec3& pos, const glm::vec3& dir, float spd, float lifetime)
+    {
+        EntityHandle h = handles.Create();
+        if (!h.IsValid())
+            return h;
+        uint32_t i = handles.Size() - 1;
+        position[i] = pos;
+        prevPosition[i] = pos;
+        direction[i] = dir;
+        speed[i] = spd;
+        life[i] = lifetime;
+        return h;
+    }
+
+    void KillAt(uint32_t i)
+    {
+        uint32_t last = handles.RemoveAt(i);
+        if (i == last)
+            return;
+        SwapPop(position, i, last);
+        SwapPop(prevPosition, i, last);
+        SwapPop(direction, i, last);
+        SwapPop(speed, i, last);
+        SwapPop(life, i, last);
+    }
+
+    void Kill(EntityHandle h)
+    {
+        if (handles.IsAlive(h))
+            KillAt(handles.DenseIndex(h));
+    }
+
+    void Clear() { handles.Clear(); }
+
+private:
+    HandleTable handles;
+};
+
+class TargetPool
+{
+public:
+    std::vector<glm::vec3> position;
+    std::vector<glm::vec3> prevPosition; // position before the last update, for render interpolation
+    std::vector<float> speed;
+    std::vector<float> animPhase; // 0..1 offset into the walk cycle, so a crowd does not move in lockstep
+
+    explicit TargetPool(uint32_t capacity)
+        : position(capacity), prevPosition(capacity), speed(capacity), animPhase(capacity), handles(capacity) {}
+
+    uint32_t Size() const { return handles.Size(); }
+    uint32_t Capacity() const { return handles.Capacity(); }
+    bool IsAlive(EntityHandle h) const { return handles.IsAlive(h); }
+
+    EntityHandle Spawn(const glm::vec3& pos, float spd)
+    {
+        EntityHandle h = handles.Create();
+        if (!h.IsValid())
+            return h;
+        uint32_t i = handles.Size() - 1;
+        position[i] = pos;
+        prevPosition[i] = pos;
+        speed[i] = spd;
+        animPhase[i] = std::fmod(h.slot * 0.618034f, 1.0f); // golden ratio spreads consecutive slots evenly
+        return h;
+    }
+
+    void KillAt(uint32_t i)
+    {
+        uint32_t last = handles.RemoveAt(i);
+        if (i == last)
+            return;
+        SwapPop(position, i, last);
+        SwapPop(prevPosition, i, last);
+        SwapPop(speed, i, last);
+        SwapPop(animPhase, i, last);
+    }
+
+    void Kill(EntityHandle h)
+    {
+        if (handles.IsAlive(h))
+            KillAt(handles.DenseIndex(h));
+    }
+
+    EntityHandle HandleAt(uint32_t i) const { return handles.HandleAt(i); }
+
+    void Clear() { handles.Clear(); }
+
+private:
+    HandleTable handles;
+};
+
+#endif
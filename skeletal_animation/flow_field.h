@@ -0,0 +1,279 @@
+// flow_field.h
+// Grid flow field on the XZ plane: one path search from the goal that every
+// agent then follows by looking up the cell it stands in.
+//
+// Init marks the cells agents cannot stand in (level boxes tall enough to
+// block them, grown by the agent radius). Update runs Dijkstra outward from
+// the goal's cell over the free cells (8 neighbours, no corner cutting) and
+// turns the distances into a heading per cell, pointing at the neighbour
+// closest to the goal. Direction() is then one array read, so the cost per
+// agent does not depend on the level or on how many agents there are.
+//
+// The field only changes when the goal moves into another cell. The search
+// runs into a back buffer and can be spread over several Update calls with a
+// budget of cells per call; agents keep following the previous field until
+// the new one is complete. A rebuild in progress is always finished, even if
+// the goal moves on meanwhile (the next one picks up the new cell): starting
+// over on every move could keep a goal that keeps moving from ever getting a
+// field.
+
+#ifndef FLOW_FIELD_H
+#define FLOW_FIELD_H
+
+#include <glm/glm.hpp>
+
+#include "swept_collision.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+class FlowField
+{
+public:
+    // Cover [lo, hi] on x/z with square cells. A box blocks the cells whose
+    // centre lies within radius of it, unless it is no higher than stepHeight
+    // (agents walk over it) or starts above standing height.
+    void Init(const glm::vec3& lo, const glm::vec3& hi, float cell, const std::vector<Aabb>& obstacles,
+              float radius, float stepHeight, float standingHeight)
+    {
+        origin = glm::vec2(lo.x, lo.z);
+        cellSize = cell;
+        invCellSize = 1.0f / cell;
+        width = std::max(1, (int)std::ceil((hi.x - lo.x) * invCellSize));
+        height = std::max(1, (int)std::ceil((hi.z - lo.z) * invCellSize));
+
+        blocked.assign((size_t)width * height, 0);
+        for (const Aabb& box : obstacles)
+        {
+            if (box.max.y <= stepHeight || box.min.y >= standingHeight)
+                continue;
+            int x0 = std::max(0, (int)std::floor((box.min.x - radius - origin.x) * invCellSize));
+            int x1 = std::min(width - 1, (int)std::floor((box.max.x + radius - origin.x) * invCellSize));
+            int z0 = std::max(0, (int)std::floor((box.min.z - radius - origin.y) * invCellSize));
+            int z1 = std::min(height - 1, (int)std::floor((box.max.z + radius - origin.y) * invCellSize));
+            for (int z = z0; z <= z1; ++z)
+                for (int x = x0; x <= x1; ++x)
+                {
+                    glm::vec2 c = CellCenter(x, z);
+                    float dx = std::max(std::max(box.min.x - c.x, c.x - box.max.x), 0.0f);
+                    float dz = std::max(std::max(box.min.z - c.y, c.y - box.max.z), 0.0f);
+                    if (dx * dx + dz * dz <= radius * radius)
+                        blocked[(size_t)z * width + x] = 1;
+                }
+        }
+
+        distance.assign(blocked.size(), UNREACHED);
+        heading.assign(blocked.size(), glm::vec2(0.0f));
+        flow.assign(blocked.size(), glm::vec2(0.0f));
+        reached.assign(blocked.size(), 0);
+        reachable.assign(blocked.size(), 0);
+        heap.clear();
+        heap.reserve(blocked.size() * 4);
+        goalCell = pendingCell = -1;
+        ready = false;
+    }
+
+    // Aim the field at goal. Continues the rebuild in progress by at most
+    // budget cells, or starts one when goal is in another cell than the
+    // current field's. Returns true when a new field was completed by this call.
+    bool Update(const glm::vec3& goal, unsigned int budget = ~0u)
+    {
+        int cell = CellOf(goal);
+        if (pendingCell < 0 && cell >= 0 && cell != goalCell)
+            startRebuild(cell);
+        if (pendingCell < 0)
+            return false;
+
+        for (unsigned int n = 0; n < budget && !heap.empty(); ++n)
+            expand();
+        if (!heap.empty())
+            return false;
+
+        computeHeadings();
+        std::swap(flow, heading);
+        std::swap(reachable, reached);
+        goalCell = pendingCell;
+        pendingCell = -1;
+        ready = true;
+        ++rebuilds;
+        return true;
+    }
+
+    // Heading on the XZ plane for an agent at p: along the field where it has
+    // one, and straight at goal in the goal's own cell, outside the field or
+    // where the goal cannot be reached.
+    glm::vec3 Direction(const glm::vec3& p, const glm::vec3& goal) const
+    {
+        int cell = ready ? CellOf(p) : -1;
+        if (cell >= 0 && (flow[cell].x != 0.0f || flow[cell].y != 0.0f))
+            return glm::vec3(flow[cell].x, 0.0f, flow[cell].y);
+        glm::vec3 d(goal.x - p.x, 0.0f, goal.z - p.z);
+        float len = std::sqrt(d.x * d.x + d.z * d.z);
+        return len > 1e-6f ? d / len : glm::vec3(0.0f);
+    }
+
+    // Whether an agent may not stand at p; open ground outside the field never is.
+    bool Blocked(const glm::vec3& p) const
+    {
+        int cell = CellOf(p);
+        return cell >= 0 && blocked[cell];
+    }
+
+    // Whether the current field leads from p to its goal. Until the first
+    // field is complete, any spot that is not Blocked.
+    bool Reachable(const glm::vec3& p) const
+    {
+        if (!ready)
+            return !Blocked(p);
+        int cell = CellOf(p);
+        return cell >= 0 && reachable[cell];
+    }
+
+    // Centre of the reachable cell nearest to p, at p's height; false when the
+    // field is not ready or reaches nothing.
+    bool NearestReachable(const glm::vec3& p, glm::vec3& out) const
+    {
+        if (!ready)
+            return false;
+        float bestDist2 = 3.0e38f;
+        for (int z = 0; z < height; ++z)
+            for (int x = 0; x < width; ++x)
+            {
+                if (!reachable[(size_t)z * width + x])
+                    continue;
+                glm::vec2 c = CellCenter(x, z);
+                float d2 = (c.x - p.x) * (c.x - p.x) + (c.y - p.z) * (c.y - p.z);
+                if (d2 < bestDist2)
+                {
+                    bestDist2 = d2;
+                    out = glm::vec3(c.x, p.y, c.y);
+                }
+            }
+        return bestDist2 < 3.0e38f;
+    }
+
+    int CellOf(const glm::vec3& p) const
+    {
+        int x = (int)std::floor((p.x - origin.x) * invCellSize);
+        int z = (int)std::floor((p.z - origin.y) * invCellSize);
+        if (x < 0 || z < 0 || x >= width || z >= height)
+            return -1;
+        return z * width + x;
+    }
+
+    glm::vec2 CellCenter(int x, int z) const
+    {
+        return origin + glm::vec2((x + 0.5f) * cellSize, (z + 0.5f) * cellSize);
+    }
+
+    int Width() const { return width; }
+    int Height() const { return height; }
+    bool Ready() const { return ready; }
+    bool Rebuilding() const { return pendingCell >= 0; }
+    unsigned long long Rebuilds() const { return rebuilds; }
+
+private:
+    static constexpr float UNREACHED = 3.0e38f;
+
+    struct Open
+    {
+        float distance;
+        int cell;
+        bool operator<(const Open& o) const { return distance > o.distance; } // min-heap
+    };
+
+    glm::vec2 origin = glm::vec2(0.0f);
+    float cellSize = 1.0f, invCellSize = 1.0f;
+    int width = 0, height = 0;
+    std::vector<char> blocked;
+    std::vector<float> distance;   // of the rebuild in progress
+    std::vector<glm::vec2> heading; // back buffer, filled when a rebuild completes
+    std::vector<glm::vec2> flow;    // what Direction() reads
+    std::vector<char> reached;      // back buffer of open cells the rebuild reached
+    std::vector<char> reachable;    // what Reachable() reads
+    std::vector<Open> heap;
+    int goalCell = -1;    // cell the current field leads to
+    int pendingCell = -1; // cell of the rebuild in progress, -1 for none
+    bool ready = false;
+    unsigned long long rebuilds = 0;
+
+    void startRebuild(int cell)
+    {
+        std::fill(distance.begin(), distance.end(), UNREACHED);
+        heap.clear();
+        // the goal cell is seeded even if blocked, so a goal pressed against a wall still pulls
+        distance[cell] = 0.0f;
+        heap.push_back(Open{ 0.0f, cell });
+        pendingCell = cell;
+    }
+
+    void expand()
+    {
+        std::pop_heap(heap.begin(), heap.end());
+        Open top = heap.back();
+        heap.pop_back();
+        if (top.distance > distance[top.cell])
+            return; // stale entry
+
+        int x = top.cell % width, z = top.cell / width;
+        for (int dz = -1; dz <= 1; ++dz)
+            for (int dx = -1; dx <= 1; ++dx)
+            {
+                if ((dx == 0 && dz == 0) || !open(x + dx, z + dz))
+                    continue;
+                if (dx != 0 && dz != 0 && (!open(x + dx, z) || !open(x, z + dz)))
+                    continue; // no cutting past a blocked corner
+                int n = (z + dz) * width + x + dx;
+                float d = top.distance + (dx != 0 && dz != 0 ? 1.41421356f : 1.0f);
+                if (d < distance[n])
+                {
+                    distance[n] = d;
+                    heap.push_back(Open{ d, n });
+                    std::push_heap(heap.begin(), heap.end());
+                }
+            }
+    }
+
+    bool open(int x, int z) const
+    {
+        return x >= 0 && z >= 0 && x < width && z < height && !blocked[(size_t)z * width + x];
+    }
+
+    // Each reached cell heads for its neighbour closest to the goal; the goal
+    // cell and the cells next to it get none, agents there steer straight in.
+    void computeHeadings()
+    {
+        for (int z = 0; z < height; ++z)
+            for (int x = 0; x < width; ++x)
+            {
+                int cell = z * width + x;
+                heading[cell] = glm::vec2(0.0f);
+                reached[cell] = distance[cell] < UNREACHED && !blocked[cell];
+                if (distance[cell] >= UNREACHED || distance[cell] < 1.5f)
+                    continue;
+                float best = distance[cell];
+                int bx = 0, bz = 0;
+                for (int dz = -1; dz <= 1; ++dz)
+                    for (int dx = -1; dx <= 1; ++dx)
+                    {
+                        if ((dx == 0 && dz == 0) || !open(x + dx, z + dz))
+                            continue;
+                        if (dx != 0 && dz != 0 && (!open(x + dx, z) || !open(x, z + dz)))
+                            continue;
+                        float d = distance[(z + dz) * width + x + dx];
+                        if (d < best)
+                        {
+                            best = d;
+                            bx = dx;
+                            bz = dz;
+                        }
+                    }
+                if (bx != 0 || bz != 0)
+                    heading[cell] = glm::normalize(glm::vec2((float)bx, (float)bz));
+            }
+    }
+};
+
+#endif
@@ -0,0 +1,24 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+// per-instance attributes (divisor 1)
+layout (location = 1) in vec3 aOffset; // world position
+layout (location = 2) in vec3 aScale;  // per-axis scale
+layout (location = 3) in vec3 aColor;
+
+// per-frame constants from common/frame_constants.h; this stage reads viewProjection
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 cameraPosition;
+    float time;
+};
+
+out vec3 Color;
+
+void main() {
+    Color = aColor;
+    gl_Position = viewProjection * vec4(aPos * aScale + aOffset, 1.0);
+}
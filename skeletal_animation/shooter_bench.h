@@ -0,0 +1,523 @@
+// shooter_bench.h
+// Headless command-line modes for the shooter. None of these open a window or
+// create a GL context, so they run on GPU-less machines.
+//
+//   --collision-stress   brute-force vs grid hit pass, plus an allocation check
+//                        (counted in builds with -DSHOOTER_COUNT_ALLOCATIONS)
+//   --tick-rate-check    fire a fixed volley at several tick rates and check
+//                        that every rate scores the same hits
+//   --bench [options]    run the full simulation step and print CSV stats
+//       --ticks N        number of ticks (default 2000)
+//       --bullets N      bullet population kept alive (default 2000)
+//       --targets N      target population kept alive (default 20000)
+//       --seed N         RNG seed (default 1)
+//       --dt SECONDS     fixed tick length (default 1/60)
+//   --scaling-bench [options]  time the entity update and hit pass on the job
+//                    system at 1, 2, 4, 8 and 16 workers
+//       --ticks N        ticks per worker count (default 200)
+//       --bullets N      bullet population kept alive (default 8000)
+//       --targets N      target population kept alive (default 100000)
+//       --max-workers N  largest worker count (default: hardware threads)
+//   --flow-bench [options]  targets chasing a moving player through a walled
+//                    maze: flow field rebuild and steering pass timed apart
+//       --ticks N        ticks per crowd size (default 300)
+//       --max N          largest crowd (default 50000)
+//       --cell SIZE      flow field cell size (default 0.5)
+//       --budget N       flow field cells searched per tick (default
+//                        FLOW_FIELD_BUDGET, 0 for the whole search at once)
+//       --workers N      job system workers (default: hardware threads)
+
+#ifndef SHOOTER_BENCH_H
+#define SHOOTER_BENCH_H
+
+#include "shooter_sim.h"
+#include "alloc_counter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Fill the pools up to the requested population. Bullets start anywhere in the
+// field with a random flat heading so the hit pass sees a realistic spread.
+inline void topUpPopulation(ShooterSim& sim, unsigned int nBullets, unsigned int nTargets, float range)
+{
+    std::uniform_real_distribution<float> coord(-range, range);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+
+    while (sim.targets.Size() < nTargets && sim.targets.Size() < sim.targets.Capacity())
+        if (!spawnTarget(sim, range, 0.0f))
+            break;
+    while (sim.bullets.Size() < nBullets && sim.bullets.Size() < sim.bullets.Capacity())
+    {
+        float a = angle(sim.rng);
+        glm::vec3 pos(coord(sim.rng), 0.85f, coord(sim.rng));
+        sim.bullets.Spawn(pos, glm::vec3(std::sin(a), 0.0f, std::cos(a)), BULLET_SPEED, BULLET_LIFETIME);
+    }
+}
+
+// --collision-stress: time one hit pass of the brute-force scan against the
+// grid over growing populations, then run the full entity update under a
+// constant spawn/kill churn and count heap allocations once it has warmed up.
+inline int runCollisionStress()
+{
+    struct Config { unsigned int bullets; unsigned int targets; };
+    const Config configs[] = { {500, 5000}, {1000, 10000}, {2000, 20000}, {4000, 40000}, {8000, 80000} };
+
+    std::cout << "bullets,targets,brute_ms,grid_ms,speedup,hits\n";
+    for (const Config& c : configs)
+    {
+        // keep the density roughly constant so the curve shows scaling, not crowding
+        float range = 5.0f * std::sqrt(c.targets / 1000.0f);
+        std::mt19937 rng(1234u);
+        std::uniform_real_distribution<float> xz(-range, range);
+        std::uniform_real_distribution<float> y(0.2f, 1.4f);
+
+        BulletPool bulletsA(c.bullets), bulletsB(c.bullets);
+        TargetPool targetsA(c.targets), targetsB(c.targets);
+        for (unsigned int j = 0; j < c.targets; ++j)
+        {
+            glm::vec3 p(xz(rng), 0.1f, xz(rng));
+            targetsA.Spawn(p, TARGET_SPEED);
+            targetsB.Spawn(p, TARGET_SPEED);
+        }
+        for (unsigned int i = 0; i < c.bullets; ++i)
+        {
+            glm::vec3 p(xz(rng), y(rng), xz(rng));
+            bulletsA.Spawn(p, glm::vec3(0.0f, 0.0f, -1.0f), BULLET_SPEED, BULLET_LIFETIME);
+            bulletsB.Spawn(p, glm::vec3(0.0f, 0.0f, -1.0f), BULLET_SPEED, BULLET_LIFETIME);
+        }
+        // pillars around every 100th target, each with a bullet inside both the
+        // pillar and the target: wall and target contacts tie at t = 0
+        std::vector<Aabb> walls;
+        for (unsigned int j = 0; j < c.targets && j / 100 < c.bullets; j += 100)
+        {
+            glm::vec3 p = targetsA.position[j];
+            walls.push_back(Aabb{ p - glm::vec3(0.3f, 0.1f, 0.3f), p + glm::vec3(0.3f, 2.0f, 0.3f) });
+            bulletsA.position[j / 100] = bulletsA.prevPosition[j / 100] = p + glm::vec3(0.0f, 0.5f, 0.0f);
+            bulletsB.position[j / 100] = bulletsB.prevPosition[j / 100] = p + glm::vec3(0.0f, 0.5f, 0.0f);
+        }
+        HitResolver resolver;
+
+        auto t0 = std::chrono::steady_clock::now();
+        int bruteHits = resolver.ResolveBruteForce(bulletsA, targetsA, walls);
+        auto t1 = std::chrono::steady_clock::now();
+        int gridHits = resolver.Resolve(bulletsB, targetsB, walls);
+        auto t2 = std::chrono::steady_clock::now();
+
+        double bruteMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        double gridMs = std::chrono::duration<double, std::milli>(t2 - t1).count();
+        std::cout << c.bullets << "," << c.targets << "," << bruteMs << "," << gridMs << ","
+                  << (gridMs > 0.0 ? bruteMs / gridMs : 0.0) << "," << gridHits << "\n";
+
+        if (bruteHits != gridHits || targetsA.Size() != targetsB.Size())
+        {
+            std::cout << "MISMATCH: brute-force hits " << bruteHits << ", grid hits " << gridHits << std::endl;
+            return 1;
+        }
+    }
+
+    // steady state: refill to a fixed population every tick
+    if (!ALLOCATIONS_COUNTED)
+        std::cout << "steady_state allocations not counted; build with -DSHOOTER_COUNT_ALLOCATIONS" << std::endl;
+    else
+    {
+        const unsigned int nBullets = 4000, nTargets = 40000;
+        const float range = 5.0f * std::sqrt(nTargets / 1000.0f);
+        const float dt = 1.0f / 60.0f;
+
+        // through the job system, as in the game, so its queues and arenas are checked too
+        JobSystem jobs;
+        ShooterSim sim(nBullets, nTargets, 99u);
+        sim.jobs = &jobs;
+        SimInput idle;
+
+        unsigned long long allocsAfterWarmup = 0;
+        const int warmupTicks = 30, ticks = 300;
+        for (int tick = 0; tick < warmupTicks + ticks; ++tick)
+        {
+            if (tick == warmupTicks)
+                allocsAfterWarmup = allocationCount().load();
+
+            topUpPopulation(sim, nBullets, nTargets, range);
+            stepSimulation(sim, idle, dt);
+        }
+        unsigned long long steadyAllocs = allocationCount().load() - allocsAfterWarmup;
+        std::cout << "steady_state_ticks," << ticks << ",hits," << sim.totalHits << ",allocations," << steadyAllocs << std::endl;
+        if (steadyAllocs != 0)
+            return 1;
+    }
+    return 0;
+}
+
+// --tick-rate-check: a ring of targets around the player and one bullet fired
+// every few degrees, inside the default arena walls. Bullets and targets move
+// in straight lines, so with swept hits the outcome must not depend on the
+// tick rate, even at rates where a bullet moves several target widths per
+// tick. Returns 1 if any rate disagrees with the first one.
+inline int runTickRateCheck()
+{
+    const float rates[] = { 240.0f, 120.0f, 60.0f, 30.0f, 20.0f, 10.0f };
+    const float duration = 2.0f; // seconds; shorter than SPAWN_INTERVAL so nothing respawns
+    const int volley = 30;       // one bullet every 12 degrees, so some targets are missed
+    const int ringTargets = 24;  // one target every 15 degrees
+    const float ringRadius = 4.0f;
+
+    std::cout << "tick_hz,bullet_step,target_hits,wall_hits,targets_left,bullets_left\n";
+    long long firstHits = -1, firstWallHits = -1;
+    bool consistent = true;
+    for (float hz : rates)
+    {
+        ShooterSim sim(volley, ringTargets, 1u);
+        sim.steering.separation = false; // keep targets on straight lines
+        // the arena walls of defaultArena(): +-5 on x/z, 0.2 thick, 2 high
+        sim.walls = {
+            { glm::vec3(-5.0f, 0.0f, -5.1f), glm::vec3(5.0f, 2.0f, -4.9f) },
+            { glm::vec3(-5.0f, 0.0f, 4.9f),  glm::vec3(5.0f, 2.0f, 5.1f) },
+            { glm::vec3(-5.1f, 0.0f, -5.0f), glm::vec3(-4.9f, 2.0f, 5.0f) },
+            { glm::vec3(4.9f, 0.0f, -5.0f),  glm::vec3(5.1f, 2.0f, 5.0f) },
+        };
+        for (int j = 0; j < ringTargets; ++j)
+        {
+            float a = glm::radians(15.0f * j + 2.0f);
+            sim.targets.Spawn(glm::vec3(ringRadius * std::sin(a), 0.1f, ringRadius * std::cos(a)), TARGET_SPEED);
+        }
+        for (int i = 0; i < volley; ++i)
+        {
+            float a = glm::radians(12.0f * i);
+            sim.bullets.Spawn(sim.characterPosition + MUZZLE_OFFSET, glm::vec3(std::sin(a), 0.0f, std::cos(a)),
+                              BULLET_SPEED, BULLET_LIFETIME);
+        }
+
+        SimInput idle;
+        const float dt = 1.0f / hz;
+        for (int t = 0; t < (int)std::lround(duration * hz); ++t)
+            stepSimulation(sim, idle, dt);
+
+        std::cout << hz << "," << BULLET_SPEED * dt << "," << sim.totalHits << "," << sim.totalWallHits << ","
+                  << sim.targets.Size() << "," << sim.bullets.Size() << "\n";
+        if (firstHits < 0)
+        {
+            firstHits = (long long)sim.totalHits;
+            firstWallHits = (long long)sim.totalWallHits;
+        }
+        else if ((long long)sim.totalHits != firstHits || (long long)sim.totalWallHits != firstWallHits)
+            consistent = false;
+    }
+
+    if (!consistent)
+    {
+        std::cout << "MISMATCH: hit counts depend on the tick rate" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// --bench: run the simulation step at a fixed population and report throughput
+// as one CSV header line plus one data line.
+inline int runSimulationBench(int argc, char** argv)
+{
+    unsigned int ticks = 2000;
+    unsigned int nBullets = 2000;
+    unsigned int nTargets = 20000;
+    uint32_t seed = 1;
+    float dt = 1.0f / 60.0f;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (hasValue && std::strcmp(argv[i], "--ticks") == 0) ticks = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else if (hasValue && std::strcmp(argv[i], "--bullets") == 0) nBullets = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else if (hasValue && std::strcmp(argv[i], "--targets") == 0) nTargets = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else if (hasValue && std::strcmp(argv[i], "--seed") == 0) seed = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        else if (hasValue && std::strcmp(argv[i], "--dt") == 0) dt = (float)std::atof(argv[++i]);
+        else
+        {
+            std::cout << "Unknown bench option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (ticks == 0)
+        ticks = 1;
+
+    // density comparable to the default arena, grown with the population
+    const float range = std::max(4.0f, 5.0f * std::sqrt(nTargets / 1000.0f));
+
+    ShooterSim sim(std::max(nBullets, 1u), std::max(nTargets, 1u), seed);
+    SimInput idle;
+    std::vector<double> tickUs(ticks);
+    unsigned int peakBullets = 0, peakTargets = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int t = 0; t < ticks; ++t)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        topUpPopulation(sim, nBullets, nTargets, range);
+        peakBullets = std::max(peakBullets, sim.bullets.Size());
+        peakTargets = std::max(peakTargets, sim.targets.Size());
+        stepSimulation(sim, idle, dt);
+        auto t1 = std::chrono::steady_clock::now();
+        tickUs[t] = std::chrono::duration<double, std::micro>(t1 - t0).count();
+    }
+    double totalS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::sort(tickUs.begin(), tickUs.end());
+    double p50 = tickUs[(ticks - 1) / 2];
+    double p99 = tickUs[(size_t)((ticks - 1) * 0.99)];
+
+    std::cout << "ticks,bullets,targets,seed,total_s,ticks_per_sec,p50_us,p99_us,peak_bullets,peak_targets,hits\n";
+    std::cout << ticks << "," << nBullets << "," << nTargets << "," << seed << "," << totalS << ","
+              << (totalS > 0.0 ? ticks / totalS : 0.0) << "," << p50 << "," << p99 << ","
+              << peakBullets << "," << peakTargets << "," << sim.totalHits << std::endl;
+    return 0;
+}
+
+// --scaling-bench: the same seeded run at each worker count, timing the two
+// phases the job system splits up. The hit totals must match across counts,
+// since the parallel passes are written to give the serial result.
+inline int runScalingBench(int argc, char** argv)
+{
+    unsigned int ticks = 200;
+    unsigned int nBullets = 8000;
+    unsigned int nTargets = 100000;
+    unsigned int maxWorkers = std::max(1u, std::thread::hardware_concurrency());
+    const float dt = 1.0f / 60.0f;
+
+    for (int i = 2; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (hasValue && std::strcmp(argv[i], "--ticks") == 0) ticks = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else if (hasValue && std::strcmp(argv[i], "--bullets") == 0) nBullets = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else if (hasValue && std::strcmp(argv[i], "--targets") == 0) nTargets = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else if (hasValue && std::strcmp(argv[i], "--max-workers") == 0) maxWorkers = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            std::cout << "Unknown scaling-bench option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (ticks == 0)
+        ticks = 1;
+    nBullets = std::max(nBullets, 1u);
+    nTargets = std::max(nTargets, 1u);
+
+    const float range = std::max(4.0f, 5.0f * std::sqrt(nTargets / 1000.0f));
+    auto ms = [](std::chrono::steady_clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+    std::cout << "workers,update_ms,hit_ms,update_speedup,hit_speedup,hits\n";
+    double baseUpdate = 0.0, baseHit = 0.0;
+    long long baseHits = -1;
+    const unsigned int counts[] = { 1, 2, 4, 8, 16 };
+    for (unsigned int workers : counts)
+    {
+        if (workers > maxWorkers)
+            break;
+
+        JobSystem jobs(workers);
+        ShooterSim sim(nBullets, nTargets, 1u);
+        sim.jobs = &jobs;
+
+        // the entity half of stepSimulation, with each phase timed on its own
+        double updateMs = 0.0, hitMs = 0.0;
+        for (unsigned int t = 0; t < ticks; ++t)
+        {
+            topUpPopulation(sim, nBullets, nTargets, range);
+            jobs.ResetScratch();
+            auto t0 = std::chrono::steady_clock::now();
+            updateEntities(sim.bullets, sim.targets, sim.characterPosition, dt, &jobs, &sim.steering);
+            auto t1 = std::chrono::steady_clock::now();
+            sim.totalHits += sim.hitResolver.Resolve(sim.bullets, sim.targets, sim.walls, &jobs);
+            auto t2 = std::chrono::steady_clock::now();
+            updateMs += ms(t1 - t0);
+            hitMs += ms(t2 - t1);
+        }
+        updateMs /= ticks;
+        hitMs /= ticks;
+        if (baseHits < 0)
+        {
+            baseUpdate = updateMs;
+            baseHit = hitMs;
+            baseHits = (long long)sim.totalHits;
+        }
+        std::cout << workers << "," << updateMs << "," << hitMs << "," << baseUpdate / updateMs << ","
+                  << baseHit / hitMs << "," << sim.totalHits << std::endl;
+
+        if ((long long)sim.totalHits != baseHits)
+        {
+            std::cout << "MISMATCH: " << workers << " workers scored " << sim.totalHits << " hits, 1 worker "
+                      << baseHits << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Square arena of +-half with walls across it every 10 units, each leaving a
+// 4 unit gap at alternating ends, so the way to the player winds back and forth.
+inline std::vector<Aabb> mazeWalls(float half)
+{
+    std::vector<Aabb> walls = {
+        { glm::vec3(-half, 0.0f, -half - 0.2f), glm::vec3(half, 2.0f, -half) },
+        { glm::vec3(-half, 0.0f, half),         glm::vec3(half, 2.0f, half + 0.2f) },
+        { glm::vec3(-half - 0.2f, 0.0f, -half), glm::vec3(-half, 2.0f, half) },
+        { glm::vec3(half, 0.0f, -half),         glm::vec3(half + 0.2f, 2.0f, half) },
+    };
+    int row = 0;
+    for (float z = -half + 10.0f; z < half - 5.0f; z += 10.0f, ++row)
+    {
+        if (row % 2 == 0) walls.push_back({ glm::vec3(-half, 0.0f, z - 0.1f), glm::vec3(half - 4.0f, 2.0f, z + 0.1f) });
+        else              walls.push_back({ glm::vec3(-half + 4.0f, 0.0f, z - 0.1f), glm::vec3(half, 2.0f, z + 0.1f) });
+    }
+    return walls;
+}
+
+// --flow-bench: per crowd size, how long the flow field takes to rebuild when
+// the player crosses into a new cell, how many ticks the per-tick budget
+// spreads a rebuild over, the worst tick of it, and how long the steering
+// pass (flow lookup, separation grid, sliding along walls) takes per tick,
+// next to the old straight-line chase. Checks that no target ended up inside
+// a wall, and that the headings targets read do not change while a rebuild
+// is in progress: they follow the previous field (or, before the first one
+// is ready, head straight for the player) until the new one is complete.
+inline bool fieldHoldsDuringRebuild(const FlowField& field, const std::vector<glm::vec3>& probes,
+                                    const std::vector<glm::vec3>& expected, const glm::vec3& goal)
+{
+    for (size_t p = 0; p < probes.size(); ++p)
+        if (field.Direction(probes[p], goal) != expected[p])
+            return false;
+    return true;
+}
+
+inline int runFlowBench(int argc, char** argv)
+{
+    unsigned int ticks = 300, maxCrowd = 50000, workers = 0, budget = FLOW_FIELD_BUDGET;
+    float cell = 0.5f;
+    const float dt = 1.0f / 60.0f;
+    for (int i = 2; i < argc; ++i)
+    {
+        bool hasValue = i + 1 < argc;
+        if (hasValue && std::strcmp(argv[i], "--ticks") == 0) ticks = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else if (hasValue && std::strcmp(argv[i], "--max") == 0) maxCrowd = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else if (hasValue && std::strcmp(argv[i], "--cell") == 0) cell = (float)std::atof(argv[++i]);
+        else if (hasValue && std::strcmp(argv[i], "--workers") == 0) workers = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else if (hasValue && std::strcmp(argv[i], "--budget") == 0) budget = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            std::cout << "Unknown flow-bench option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (ticks == 0)
+        ticks = 1;
+    if (cell <= 0.0f)
+        cell = 0.5f;
+    if (budget == 0)
+        budget = ~0u;
+
+    JobSystem jobs(workers);
+    auto ms = [](std::chrono::steady_clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+
+    std::cout << "targets,field_cells,budget,rebuilds,rebuild_ms,rebuild_tick_max_ms,ticks_per_rebuild,max_ticks_per_rebuild,"
+                 "steer_ms,direct_ms,steer_ns_per_target,in_walls\n";
+    const unsigned int sizes[] = { 1000, 5000, 20000, 50000, 100000 };
+    for (unsigned int count : sizes)
+    {
+        if (count > maxCrowd)
+            break;
+
+        // about one target per square unit
+        const float half = std::max(20.0f, 0.5f * std::sqrt((float)count));
+        ShooterSim sim(1, count, 5u);
+        sim.jobs = &jobs;
+        sim.steering.fieldBudget = budget;
+        sim.walls = mazeWalls(half);
+        sim.steering.field.Init(glm::vec3(-half - 1.0f), glm::vec3(half + 1.0f), cell, sim.walls,
+                                HIT_DISTANCE, 0.5f, TARGET_HEIGHT);
+
+        std::uniform_real_distribution<float> coord(-half, half);
+        while (sim.targets.Size() < count)
+        {
+            glm::vec3 p(coord(sim.rng), 0.1f, coord(sim.rng));
+            if (!sim.steering.field.Blocked(p))
+                sim.targets.Spawn(p, TARGET_SPEED);
+        }
+        TargetPool direct = sim.targets;
+
+        // headings at a sample of the starting spots, as of the last completed field
+        std::vector<glm::vec3> probes, expected;
+        for (unsigned int j = 0; j < count; j += std::max(1u, count / 64))
+            probes.push_back(sim.targets.position[j]);
+        glm::vec3 probeGoal = sim.characterPosition;
+        auto snapshot = [&]() {
+            probeGoal = sim.characterPosition;
+            expected.clear();
+            for (const glm::vec3& p : probes)
+                expected.push_back(sim.steering.field.Direction(p, probeGoal));
+        };
+        snapshot();
+
+        double rebuildMs = 0.0, rebuildTickMax = 0.0, steerMs = 0.0, directMs = 0.0;
+        unsigned long long rebuildsBefore = sim.steering.field.Rebuilds();
+        unsigned int rebuildTicks = 0, rebuildTicksTotal = 0, rebuildTicksMax = 0;
+        for (unsigned int t = 0; t < ticks; ++t)
+        {
+            // the player paces along the first corridor, changing cell every few ticks
+            float phase = std::fmod(t * dt * CHARACTER_SPEED, 2.0f * half);
+            sim.characterPosition = glm::vec3(std::fabs(phase - half) - 0.5f * half, 0.09f, -half + 5.0f);
+
+            jobs.ResetScratch();
+            auto t0 = std::chrono::steady_clock::now();
+            bool rebuilt = sim.steering.field.Update(sim.characterPosition, sim.steering.fieldBudget);
+            auto t1 = std::chrono::steady_clock::now();
+            updateEntities(sim.bullets, sim.targets, sim.characterPosition, dt, &jobs, &sim.steering);
+            auto t2 = std::chrono::steady_clock::now();
+            updateEntities(sim.bullets, direct, sim.characterPosition, dt, &jobs);
+            auto t3 = std::chrono::steady_clock::now();
+
+            if (rebuilt || sim.steering.field.Rebuilding())
+            {
+                rebuildMs += ms(t1 - t0);
+                rebuildTickMax = std::max(rebuildTickMax, ms(t1 - t0));
+                ++rebuildTicks;
+            }
+            if (rebuilt)
+            {
+                rebuildTicksTotal += rebuildTicks;
+                rebuildTicksMax = std::max(rebuildTicksMax, rebuildTicks);
+                rebuildTicks = 0;
+                snapshot();
+            }
+            else if (sim.steering.field.Rebuilding() && !fieldHoldsDuringRebuild(sim.steering.field, probes, expected, probeGoal))
+            {
+                std::cout << "FAIL: headings changed before the rebuild was complete" << std::endl;
+                return 1;
+            }
+            steerMs += ms(t2 - t1);
+            directMs += ms(t3 - t2);
+        }
+
+        unsigned long long rebuilds = sim.steering.field.Rebuilds() - rebuildsBefore;
+        unsigned int inWalls = 0;
+        for (unsigned int j = 0; j < sim.targets.Size(); ++j)
+            inWalls += sim.steering.field.Blocked(sim.targets.position[j]) ? 1 : 0;
+
+        std::cout << count << "," << sim.steering.field.Width() * sim.steering.field.Height() << ","
+                  << (budget == ~0u ? 0u : budget) << "," << rebuilds << "," << (rebuilds ? rebuildMs / rebuilds : 0.0) << ","
+                  << rebuildTickMax << "," << (rebuilds ? (double)rebuildTicksTotal / rebuilds : 0.0) << ","
+                  << rebuildTicksMax << "," << steerMs / ticks << "," << directMs / ticks << ","
+                  << steerMs / ticks * 1.0e6 / count << "," << inWalls << std::endl;
+        if (inWalls != 0)
+        {
+            std::cout << "FAIL: targets walked into walls" << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,533 @@
+// shooter_sim.h
+// Game logic of the shooter demo: player movement, target spawning, bullet
+// integration, target chase and bullet/target hits.
+//
+// Nothing in here touches GLFW or GL, so the same step function drives the
+// windowed game and the headless benchmarks. All randomness comes from the
+// simulation's own seeded generator, so a given seed and input sequence always
+// produces the same run.
+
+#ifndef SHOOTER_SIM_H
+#define SHOOTER_SIM_H
+
+#include <glm/glm.hpp>
+
+#include "spatial_grid.h"
+#include "entity_pool.h"
+#include "swept_collision.h"
+#include "flow_field.h"
+#include "../common/job_system.h"
+
+#include <algorithm>
+#include <vector>
+#include <random>
+#include <cstdint>
+
+const unsigned int MAX_BULLETS = 8192;
+const unsigned int MAX_TARGETS = 65536;
+const unsigned int ENTITY_GRAIN = 1024; // smallest range of entities worth handing to a worker
+const unsigned int FLOW_FIELD_BUDGET = 1024; // flow field cells searched per tick; the arena's field takes a few ticks
+
+const float BULLET_SPEED = 15.0f;
+const float BULLET_LIFETIME = 3.0f;
+const float TARGET_SPEED = 1.2f;
+const float SPAWN_INTERVAL = 3.0f;
+const float CHARACTER_SPEED = 2.5f; // units/sec
+const float ARENA_LIMIT = 4.5f;     // player is kept inside +-ARENA_LIMIT on x/z
+const float HIT_DISTANCE = 0.3f;  // target capsule radius, adjust for bullet + target size
+const float TARGET_HEIGHT = 1.5f; // target capsule runs from its feet to this height
+const glm::vec3 TARGET_CENTER_OFFSET = glm::vec3(0.0f, 0.75f, 0.0f); // half of TARGET_HEIGHT
+const glm::vec3 MUZZLE_OFFSET = glm::vec3(-0.1f, 0.8f, 0.0f);
+const float SEPARATION_RADIUS = 2.0f * HIT_DISTANCE; // targets closer than this push each other apart
+const float SEPARATION_WEIGHT = 1.5f;
+const int SEPARATION_MAX_NEIGHBOURS = 8;             // pushes summed per target, bounds the cost in a crush
+
+// What the player asked for during one step.
+struct SimInput
+{
+    glm::vec3 moveDir = glm::vec3(0.0f); // unit length or zero, on the XZ plane
+    bool fire = false;                   // fire one bullet this step
+    glm::vec3 aimDir = glm::vec3(0.0f, 0.0f, -1.0f);
+};
+
+// Where and when during a tick a bullet stopped.
+struct BulletHit
+{
+    glm::vec3 position;
+    float time;  // fraction of the tick, 0..1
+    bool wall;   // hit level geometry rather than a target
+};
+
+// Resolves bullet hits with swept tests: each bullet's path over the tick
+// (prevPosition -> position) against every target's capsule and the level's
+// boxes, so fast bullets cannot pass through a target between two ticks.
+// Targets are tested in their own frame, so their motion during the tick is
+// accounted for too. Owns its scratch arrays so repeated calls do not allocate.
+class HitResolver
+{
+public:
+    // one cell spans the capsule diameter; swept queries cover as many cells as the path needs
+    HitResolver() : grid(2.0f * HIT_DISTANCE) {}
+
+    // Kill every bullet that hits a target or a wall this tick, together with
+    // the target it hit. A bullet stops at its earliest contact (lowest index
+    // on a tie); a target already taken by an earlier bullet is ignored. Kills
+    // are deferred until the pass is done so indices stay stable while the
+    // grid is queried. Returns the number of targets hit; Events() lists
+    // every hit, walls included.
+    //
+    // With a job system the search runs in parallel, each bullet finding its
+    // earliest contact as if no target had been taken yet. A serial pass then
+    // accepts the hits in bullet order and only searches again for the rare
+    // bullet whose target an earlier bullet already took, so the outcome is
+    // the same for any number of workers.
+    int Resolve(BulletPool& bullets, TargetPool& targets, const std::vector<Aabb>& walls, JobSystem* jobs = nullptr)
+    {
+        const glm::vec3* targetPos = targets.position.data();
+        const glm::vec3* targetPrev = targets.prevPosition.data();
+        grid.Build(targets.Size(), [&](unsigned int j) { return targetPos[j] + TARGET_CENTER_OFFSET; });
+        float maxTargetStep = 0.0f;
+        for (unsigned int j = 0; j < targets.Size(); ++j)
+            maxTargetStep = std::max(maxTargetStep, glm::length(targetPos[j] - targetPrev[j]));
+        const glm::vec3 pad(HIT_DISTANCE + maxTargetStep);
+
+        bulletDead.assign(bullets.Size(), 0);
+        targetDead.assign(targets.Size(), 0);
+        if (events.capacity() < bullets.Capacity())
+            events.reserve(bullets.Capacity());
+        events.clear();
+
+        // parallel search first, into per-tick scratch from the calling worker's arena
+        float* candidateT = nullptr;
+        unsigned int* candidate = nullptr;
+        if (jobs)
+        {
+            ScratchArena& arena = jobs->Scratch(jobs->CurrentWorker());
+            candidateT = arena.Alloc<float>(bullets.Size());
+            candidate = arena.Alloc<unsigned int>(bullets.Size());
+            jobs->ParallelFor(0, bullets.Size(), ENTITY_GRAIN / 4, [&](unsigned int first, unsigned int last, unsigned int) {
+                for (unsigned int i = first; i < last; ++i)
+                    candidateT[i] = firstHit(bullets, targets, walls, pad, i, candidate[i]);
+            });
+        }
+
+        int hits = 0;
+        for (unsigned int i = 0; i < bullets.Size(); ++i)
+        {
+            unsigned int best;
+            float bestT;
+            if (candidate && (candidate[i] == ~0u || !targetDead[candidate[i]]))
+            {
+                best = candidate[i];
+                bestT = candidateT[i];
+            }
+            else
+                bestT = firstHit(bullets, targets, walls, pad, i, best);
+            hits += accept(bullets, i, bestT, best);
+        }
+
+        // kill back to front: swap-and-pop only ever pulls in entries that were
+        // already visited, so every flag still refers to the right entity
+        if (!events.empty())
+        {
+            for (unsigned int i = bullets.Size(); i-- > 0; )
+                if (bulletDead[i]) bullets.KillAt(i);
+            for (unsigned int j = targets.Size(); j-- > 0; )
+                if (targetDead[j]) targets.KillAt(j);
+        }
+        return hits;
+    }
+
+    // Brute-force O(bullets x targets) reference with the same hit rule (a
+    // target beats a wall it ties with, the lower index wins between targets),
+    // kept for the stress comparison. Only targets are killed.
+    int ResolveBruteForce(const BulletPool& bullets, TargetPool& targets, const std::vector<Aabb>& walls)
+    {
+        targetDead.assign(targets.Size(), 0);
+
+        int hits = 0;
+        for (unsigned int i = 0; i < bullets.Size(); ++i)
+        {
+            const glm::vec3 p0 = bullets.prevPosition[i];
+            const glm::vec3 p1 = bullets.position[i];
+            float bestT = firstWallHit(p0, p1, walls);
+            unsigned int best = ~0u;
+            for (unsigned int j = 0; j < targets.Size(); ++j)
+            {
+                float t;
+                if (!targetDead[j] && sweptHit(p0, p1, targets.prevPosition[j], targets.position[j], t)
+                    && (t < bestT || (t == bestT && j < best)))
+                {
+                    bestT = t;
+                    best = j;
+                }
+            }
+            if (best != ~0u)
+            {
+                targetDead[best] = 1;
+                ++hits;
+            }
+        }
+        for (unsigned int j = targets.Size(); j-- > 0; )
+            if (targetDead[j]) targets.KillAt(j);
+        return hits;
+    }
+
+    const std::vector<BulletHit>& Events() const { return events; }
+
+private:
+    SpatialGrid grid;
+    std::vector<char> bulletDead;
+    std::vector<char> targetDead;
+    std::vector<BulletHit> events;
+
+    // earliest contact of bullet i this tick, skipping targets already taken:
+    // returns its t (2 for none) and sets best to the target, ~0u for a wall or none
+    float firstHit(const BulletPool& bullets, const TargetPool& targets, const std::vector<Aabb>& walls,
+                   const glm::vec3& pad, unsigned int i, unsigned int& best) const
+    {
+        const glm::vec3 p0 = bullets.prevPosition[i];
+        const glm::vec3 p1 = bullets.position[i];
+        const glm::vec3* targetPos = targets.position.data();
+        const glm::vec3* targetPrev = targets.prevPosition.data();
+        float bestT = firstWallHit(p0, p1, walls);
+        best = ~0u;
+        grid.QueryBox(glm::min(p0, p1) - pad, glm::max(p0, p1) + pad, [&](unsigned int j) {
+            float t;
+            if (!targetDead[j] && sweptHit(p0, p1, targetPrev[j], targetPos[j], t)
+                && (t < bestT || (t == bestT && j < best)))
+            {
+                bestT = t;
+                best = j;
+            }
+        });
+        return bestT;
+    }
+
+    // record the outcome of bullet i; returns 1 if it took a target
+    int accept(const BulletPool& bullets, unsigned int i, float bestT, unsigned int best)
+    {
+        if (bestT > 1.0f)
+            return 0;
+        const glm::vec3 p0 = bullets.prevPosition[i];
+        const glm::vec3 p1 = bullets.position[i];
+        bulletDead[i] = 1;
+        events.push_back(BulletHit{ p0 + (p1 - p0) * bestT, bestT, best == ~0u });
+        if (best == ~0u)
+            return 0;
+        targetDead[best] = 1;
+        return 1;
+    }
+
+    // bullet path against the target's capsule, in the target's frame
+    static bool sweptHit(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& targetFrom,
+                         const glm::vec3& targetTo, float& t)
+    {
+        return segmentCapsuleY(p0 - targetFrom, p1 - targetTo, glm::vec3(0.0f),
+                               HIT_DISTANCE, TARGET_HEIGHT - HIT_DISTANCE, HIT_DISTANCE, t);
+    }
+
+    // earliest wall contact along p0 -> p1, or 2 for none
+    static float firstWallHit(const glm::vec3& p0, const glm::vec3& p1, const std::vector<Aabb>& walls)
+    {
+        float best = 2.0f, t;
+        for (const Aabb& wall : walls)
+            if (segmentAabb(p0, p1, wall, t) && t < best)
+                best = t;
+        return best;
+    }
+};
+
+// How targets pick their heading: the flow field toward the player, plus a
+// push away from neighbours closer than SEPARATION_RADIUS, found through a
+// grid of last tick's positions. Until the field is initialised targets head
+// straight for the player.
+struct TargetSteering
+{
+    FlowField field;
+    SpatialGrid neighbours = SpatialGrid(SEPARATION_RADIUS);
+    bool separation = true;
+    unsigned int fieldBudget = FLOW_FIELD_BUDGET; // cells searched per tick while the field is rebuilt
+};
+
+// Heading of target j: flow plus separation, no longer than one.
+inline glm::vec3 steerTarget(const TargetSteering& steering, const glm::vec3* positions, unsigned int j,
+                             const glm::vec3& chasePosition)
+{
+    const glm::vec3 p = positions[j];
+    glm::vec3 dir = steering.field.Direction(p, chasePosition);
+    if (!steering.separation)
+        return dir;
+
+    glm::vec3 push(0.0f);
+    int pushes = 0;
+    steering.neighbours.Query(p, [&](unsigned int k) {
+        if (k == j || pushes >= SEPARATION_MAX_NEIGHBOURS)
+            return;
+        float dx = p.x - positions[k].x, dz = p.z - positions[k].z;
+        float d2 = dx * dx + dz * dz;
+        if (d2 >= SEPARATION_RADIUS * SEPARATION_RADIUS)
+            return;
+        float d = std::sqrt(d2);
+        float strength = 1.0f - d / SEPARATION_RADIUS;
+        if (d < 1e-4f)
+        {
+            // stacked exactly: split them by index
+            float a = (float)(j * 2654435761u % 6283u) * 0.001f;
+            dx = std::cos(a);
+            dz = std::sin(a);
+            d = 1.0f;
+        }
+        push += glm::vec3(dx / d, 0.0f, dz / d) * strength;
+        ++pushes;
+    });
+    dir += push * SEPARATION_WEIGHT;
+    float len = glm::length(dir);
+    return len > 1.0f ? dir / len : dir;
+}
+
+// fn(first, last, worker) over [0, count): parallel-for with a job system, one call without
+template <typename Fn>
+inline void forEntityRange(JobSystem* jobs, unsigned int count, const Fn& fn)
+{
+    if (jobs)
+        jobs->ParallelFor(0, count, ENTITY_GRAIN, fn);
+    else
+        fn(0, count, 0);
+}
+
+// Advance bullets by dt; expired bullets are swap-and-popped. The move is a
+// parallel-for with a job system; the removal stays a serial pass in index
+// order, so the pool ends up in the same order either way.
+inline void updateBullets(BulletPool& bullets, float dt, JobSystem* jobs = nullptr)
+{
+    forEntityRange(jobs, bullets.Size(), [&](unsigned int first, unsigned int last, unsigned int) {
+        std::copy(bullets.position.begin() + first, bullets.position.begin() + last, bullets.prevPosition.begin() + first);
+        for (unsigned int i = first; i < last; ++i)
+        {
+            bullets.position[i] += bullets.direction[i] * bullets.speed[i] * dt;
+            bullets.life[i] -= dt;
+        }
+    });
+
+    for (unsigned int i = 0; i < bullets.Size(); )
+    {
+        if (bullets.life[i] <= 0.0f)
+            bullets.KillAt(i); // the last bullet moved into i, look at i again
+        else
+            ++i;
+    }
+}
+
+// Advance targets by dt: along steering when given, and otherwise straight
+// for chasePosition. Parallel-for over the pool with a job system.
+inline void updateTargets(TargetPool& targets, const glm::vec3& chasePosition, float dt,
+                          JobSystem* jobs = nullptr, TargetSteering* steering = nullptr)
+{
+    if (steering)
+    {
+        // every target reads its neighbours' previous positions, so those are
+        // all copied and binned before anyone moves
+        forEntityRange(jobs, targets.Size(), [&](unsigned int first, unsigned int last, unsigned int) {
+            std::copy(targets.position.begin() + first, targets.position.begin() + last, targets.prevPosition.begin() + first);
+        });
+        const glm::vec3* prev = targets.prevPosition.data();
+        if (steering->separation)
+            steering->neighbours.Build(targets.Size(), [&](unsigned int j) { return prev[j]; });
+        // walked in grid order, so neighbouring targets query the same buckets
+        forEntityRange(jobs, targets.Size(), [&](unsigned int first, unsigned int last, unsigned int) {
+            for (unsigned int e = first; e < last; ++e)
+            {
+                unsigned int j = steering->separation ? steering->neighbours.ItemAt(e) : e;
+                glm::vec3 step = steerTarget(*steering, prev, j, chasePosition) * targets.speed[j] * dt;
+                glm::vec3 p = prev[j] + step;
+                // blocked: slide along whichever axis is still free
+                if (steering->field.Blocked(p))
+                {
+                    if (!steering->field.Blocked(prev[j] + glm::vec3(step.x, 0.0f, 0.0f)))
+                        p = prev[j] + glm::vec3(step.x, 0.0f, 0.0f);
+                    else if (!steering->field.Blocked(prev[j] + glm::vec3(0.0f, 0.0f, step.z)))
+                        p = prev[j] + glm::vec3(0.0f, 0.0f, step.z);
+                    else
+                        p = prev[j];
+                }
+                targets.position[j] = p;
+            }
+        });
+    }
+    else
+    {
+        forEntityRange(jobs, targets.Size(), [&](unsigned int first, unsigned int last, unsigned int) {
+            std::copy(targets.position.begin() + first, targets.position.begin() + last, targets.prevPosition.begin() + first);
+            for (unsigned int j = first; j < last; ++j)
+            {
+                glm::vec3 dir = glm::normalize(chasePosition - targets.position[j]);
+                targets.position[j] += dir * targets.speed[j] * dt;
+            }
+        });
+    }
+}
+
+// Advance bullets and targets by dt, one after the other.
+inline void updateEntities(BulletPool& bullets, TargetPool& targets, const glm::vec3& chasePosition, float dt,
+                           JobSystem* jobs = nullptr, TargetSteering* steering = nullptr)
+{
+    updateBullets(bullets, dt, jobs);
+    updateTargets(targets, chasePosition, dt, jobs, steering);
+}
+
+struct ShooterSim
+{
+    BulletPool bullets;
+    TargetPool targets;
+    HitResolver hitResolver;
+    std::mt19937 rng;
+    std::vector<Aabb> walls; // level geometry bullets stop at
+    JobSystem* jobs = nullptr; // spreads entity updates and hit search over workers; null runs serially
+    TargetSteering steering;   // flow field and separation; the field is set up by whoever owns the level
+
+    glm::vec3 characterPosition = glm::vec3(0.0f, 0.09f, 0.0f);
+    glm::vec3 prevCharacterPosition = glm::vec3(0.0f, 0.09f, 0.0f);
+    float timeSinceLastSpawn = 0.0f;
+    unsigned long long tick = 0;
+    unsigned long long totalHits = 0;
+    unsigned long long totalWallHits = 0;
+
+    ShooterSim(uint32_t maxBullets, uint32_t maxTargets, uint32_t seed)
+        : bullets(maxBullets), targets(maxTargets), rng(seed) {}
+
+    // The entity phases of one tick as a task graph (with a job system): the
+    // flow field and then the targets run alongside the bullets, and the hit
+    // pass waits for both. Built on first use; each task is itself a
+    // parallel-for. The sim must not move once it has run a tick.
+    TaskGraph tickGraph;
+    float tickDt = 0.0f; // dt of the tick the graph is running
+    int tickHits = 0;    // the graph's hit pass result
+};
+
+// Spawn one target at a random spot within +-range on x/z, at least minDistance
+// away from the player and somewhere the flow field can lead it to the player.
+// After SPAWN_ATTEMPTS misses the reachable cell nearest the last try is used;
+// returns false, spawning nothing, if that is too close or there is none.
+inline bool spawnTarget(ShooterSim& sim, float range, float minDistance = 2.5f)
+{
+    const int SPAWN_ATTEMPTS = 64;
+    std::uniform_real_distribution<float> coord(-range, range);
+    const FlowField& field = sim.steering.field;
+    glm::vec3 pos;
+    for (int attempt = 0; ; ++attempt)
+    {
+        pos = glm::vec3(coord(sim.rng), 0.1f, coord(sim.rng));
+        bool tooClose = glm::length(pos - sim.characterPosition) < minDistance;
+        if (!tooClose && field.Reachable(pos))
+            break;
+        if (attempt + 1 == SPAWN_ATTEMPTS)
+        {
+            if (!field.NearestReachable(pos, pos) || glm::length(pos - sim.characterPosition) < minDistance)
+                return false;
+            break;
+        }
+    }
+
+    return sim.targets.Spawn(pos, TARGET_SPEED).IsValid();
+}
+
+// One simulation tick of dt seconds.
+inline void stepSimulation(ShooterSim& sim, const SimInput& input, float dt)
+{
+    sim.prevCharacterPosition = sim.characterPosition;
+
+    // player movement, kept within area
+    sim.characterPosition += input.moveDir * CHARACTER_SPEED * dt;
+    sim.characterPosition.x = glm::clamp(sim.characterPosition.x, -ARENA_LIMIT, ARENA_LIMIT);
+    sim.characterPosition.z = glm::clamp(sim.characterPosition.z, -ARENA_LIMIT, ARENA_LIMIT);
+
+    if (input.fire)
+        sim.bullets.Spawn(sim.characterPosition + MUZZLE_OFFSET, input.aimDir, BULLET_SPEED, BULLET_LIFETIME);
+
+    // spawn target far from player
+    sim.timeSinceLastSpawn += dt;
+    if (sim.timeSinceLastSpawn >= SPAWN_INTERVAL)
+    {
+        sim.timeSinceLastSpawn = 0.0f;
+        spawnTarget(sim, 4.0f); // outer spawn range
+    }
+
+    int hits;
+    if (sim.jobs)
+    {
+        if (sim.tickGraph.Empty())
+        {
+            ShooterSim* s = &sim;
+            unsigned int field = s->tickGraph.Add([s](unsigned int) {
+                s->steering.field.Update(s->characterPosition, s->steering.fieldBudget);
+            });
+            unsigned int targets = s->tickGraph.Add([s](unsigned int) {
+                updateTargets(s->targets, s->characterPosition, s->tickDt, s->jobs, &s->steering);
+            }, { field });
+            unsigned int bullets = s->tickGraph.Add([s](unsigned int) { updateBullets(s->bullets, s->tickDt, s->jobs); });
+            s->tickGraph.Add([s](unsigned int) {
+                s->tickHits = s->hitResolver.Resolve(s->bullets, s->targets, s->walls, s->jobs);
+            }, { targets, bullets });
+        }
+        sim.jobs->ResetScratch();
+        sim.tickDt = dt;
+        sim.tickGraph.Run(*sim.jobs);
+        hits = sim.tickHits;
+    }
+    else
+    {
+        sim.steering.field.Update(sim.characterPosition, sim.steering.fieldBudget);
+        updateEntities(sim.bullets, sim.targets, sim.characterPosition, dt, nullptr, &sim.steering);
+        hits = sim.hitResolver.Resolve(sim.bullets, sim.targets, sim.walls);
+    }
+    sim.totalHits += hits;
+    sim.totalWallHits += sim.hitResolver.Events().size() - hits;
+    ++sim.tick;
+}
+
+// What the renderer needs from one tick: every position before and after the
+// tick, so it can draw anywhere in between. Arrays are sized to the pool
+// capacity on first use and reused after that.
+struct ShooterSnapshot
+{
+    glm::vec3 prevCharacterPosition = glm::vec3(0.0f, 0.09f, 0.0f);
+    glm::vec3 characterPosition = glm::vec3(0.0f, 0.09f, 0.0f);
+    unsigned int bulletCount = 0;
+    unsigned int targetCount = 0;
+    std::vector<glm::vec3> bulletPrev, bulletCurr;
+    std::vector<glm::vec3> targetPrev, targetCurr;
+    std::vector<float> targetPhase;
+    std::vector<EntityHandle> targetHandle; // slot and generation, for per-target render state
+};
+
+inline void captureSnapshot(const ShooterSim& sim, ShooterSnapshot& snap)
+{
+    snap.prevCharacterPosition = sim.prevCharacterPosition;
+    snap.characterPosition = sim.characterPosition;
+
+    snap.bulletCount = sim.bullets.Size();
+    if (snap.bulletCurr.size() < sim.bullets.Capacity())
+    {
+        snap.bulletPrev.resize(sim.bullets.Capacity());
+        snap.bulletCurr.resize(sim.bullets.Capacity());
+    }
+    std::copy(sim.bullets.prevPosition.begin(), sim.bullets.prevPosition.begin() + snap.bulletCount, snap.bulletPrev.begin());
+    std::copy(sim.bullets.position.begin(), sim.bullets.position.begin() + snap.bulletCount, snap.bulletCurr.begin());
+
+    snap.targetCount = sim.targets.Size();
+    if (snap.targetCurr.size() < sim.targets.Capacity())
+    {
+        snap.targetPrev.resize(sim.targets.Capacity());
+        snap.targetCurr.resize(sim.targets.Capacity());
+        snap.targetPhase.resize(sim.targets.Capacity());
+        snap.targetHandle.resize(sim.targets.Capacity());
+    }
+    std::copy(sim.targets.prevPosition.begin(), sim.targets.prevPosition.begin() + snap.targetCount, snap.targetPrev.begin());
+    std::copy(sim.targets.position.begin(), sim.targets.position.begin() + snap.targetCount, snap.targetCurr.begin());
+    std::copy(sim.targets.animPhase.begin(), sim.targets.animPhase.begin() + snap.targetCount, snap.targetPhase.begin());
+    for (unsigned int j = 0; j < snap.targetCount; ++j)
+        snap.targetHandle[j] = sim.targets.HandleAt(j);
+}
+
+#endif
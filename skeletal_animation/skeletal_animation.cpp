@@ -12,37 +12,56 @@
 #include <learnopengl/filesystem.h>
 #include <learnopengl/shader_m.h>
 #include <learnopengl/camera.h>
-#include <learnopengl/animator.h>
 #include <learnopengl/model_animation.h>
 
-#include <iostream>
-
-struct Bullet {
-    glm::vec3 position;
-    glm::vec3 direction;
-    float speed;
-    float life;
-};
-
-std::vector<Bullet> bullets;
-const float BULLET_SPEED = 15.0f;
-const float BULLET_LIFETIME = 3.0f;
+#include "shooter_sim.h"
+#include "shooter_bench.h"
+#include "clip_bench.h"
+#include "bone_palette.h"
+#include "skeleton.h"
+#include "skinned_animator.h"
+#include "clip_cache.h"
+#include "crowd_animation.h"
+#include "crowd_bench.h"
+#include "anim_lod.h"
+#include "static_batch.h"
+#include "../common/fixed_step.h"
+#include "../common/asset_loader.h"
+#include "../common/frame_constants.h"
+#include "../common/frustum.h"
+#include "../common/input_replay.h"
 
-struct Target {
-    glm::vec3 position;
-    float speed;
-};
-
-std::vector<Target> targets;
-const float TARGET_SPEED = 1.2f;
-const float SPAWN_INTERVAL = 3.0f;
-float timeSinceLastSpawn = 0.0f;
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// game state (bullets, targets, player position); seeded with --seed. Once the
+// simulation thread is running only that thread touches it; the render thread
+// draws from the published snapshots instead.
+ShooterSim sim(MAX_BULLETS, MAX_TARGETS, 1u);
+uint32_t simSeed = 1u; // --seed, or the seed a replayed log was recorded with
+float simRate = 30.0f; // ticks per second, --sim-hz; hits are swept, so a low rate loses none
+unsigned int simWorkers = 0; // job system workers for the simulation, --workers; 0 = one per hardware thread
+
+// input handed from the render thread to the simulation thread
+std::mutex simInputMutex;
+SimInput simInput;    // guarded by simInputMutex
+int pendingShots = 0; // guarded by simInputMutex
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
-void processInput(GLFWwindow* window);
-void updateCamera();
+InputFrame pollInput(GLFWwindow* window);
+void processInput(const InputFrame& input);
+void updateCamera(const glm::vec3& focus);
+uint64_t simHash();
 
 // settings
 const unsigned int SCR_WIDTH = 800;
@@ -53,38 +72,60 @@ Camera camera(glm::vec3(0.0f, 1.2f, 4.0f));
 float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
 bool firstMouse = true;
+InputFrame pendingInput; // mouse and wheel movement gathered by the callbacks until the next poll
 
 // timing
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
 // player (character)
-glm::vec3 characterPosition = glm::vec3(0.0f, 0.09f, 0.0f);
 float characterYaw = 0.0f; // rotation of the player model
 float cameraYaw = 0.0f;    // horizontal orbit angle around the player
 float cameraPitch = 0.0f;
 glm::vec3 characterScale = glm::vec3(0.5f);
-const float CHARACTER_SPEED = 2.5f; // units/sec
 const float MOUSE_SENSITIVITY = 0.1f;
 const float CAMERA_DISTANCE = 3.0f; // distance behind character
 const float CAMERA_HEIGHT = 1.5f;   // height above character
-const float HIT_DISTANCE = 0.3f; // adjust for bullet + target size
-
-// animation state
-Animation* idleAnimPtr = nullptr;
-Animation* runForwardPtr = nullptr;
-Animation* runBackPtr = nullptr;
-Animation* runLeftPtr = nullptr;
-Animation* runRightPtr = nullptr;
-Animation* runForwardLeftPtr = nullptr;
-Animation* runForwardRightPtr = nullptr;
-Animation* runBackLeftPtr = nullptr;
-Animation* runBackRightPtr = nullptr;
-Animation* currentAnimPtr = nullptr;
-Animator* animatorPtr = nullptr;
+
+// locomotion clips, all sharing the rifle model's skeleton
+enum { CLIP_IDLE, CLIP_FORWARD, CLIP_BACK, CLIP_LEFT, CLIP_RIGHT,
+       CLIP_FORWARD_LEFT, CLIP_FORWARD_RIGHT, CLIP_BACK_LEFT, CLIP_BACK_RIGHT, CLIP_COUNT };
+const char* const CLIP_FILES[CLIP_COUNT] = {
+    "resources/objects/gun/rifle_idle.dae",
+    "resources/objects/gun/run_forward.dae",
+    "resources/objects/gun/run_back.dae",
+    "resources/objects/gun/run_left.dae",
+    "resources/objects/gun/run_right.dae",
+    "resources/objects/gun/run_forward_left.dae",
+    "resources/objects/gun/run_forward_right.dae",
+    "resources/objects/gun/run_back_left.dae",
+    "resources/objects/gun/run_back_right.dae",
+};
+
+// baked skeleton + clips, rebuilt from CLIP_FILES when stale or with --rebake-clips
+const char* const CLIP_CACHE_FILE = "locomotion.clips";
+bool rebakeClips = false;
+
+// animation state: every clip is bound to the one shared skeleton
+const SkeletonClip* idleAnimPtr = nullptr;
+const SkeletonClip* runForwardPtr = nullptr;
+const SkeletonClip* runBackPtr = nullptr;
+const SkeletonClip* runLeftPtr = nullptr;
+const SkeletonClip* runRightPtr = nullptr;
+const SkeletonClip* runForwardLeftPtr = nullptr;
+const SkeletonClip* runForwardRightPtr = nullptr;
+const SkeletonClip* runBackLeftPtr = nullptr;
+const SkeletonClip* runBackRightPtr = nullptr;
+const SkeletonClip* currentAnimPtr = nullptr;
+SkinnedAnimator* animatorPtr = nullptr;
 
 unsigned int cubeVAO = 0, cubeVBO = 0;
 
+// static level geometry (floor, walls, props), loaded from --level or arena.level
+std::string levelPath = "arena.level";
+std::vector<StaticBox> levelBoxes;
+StaticBatch levelBatch;
+
 float cubeVertices[] = {
     // A simple 1x1x1 cube (36 vertices)
     -0.5f,-0.5f,-0.5f,  0.5f,-0.5f,-0.5f,  0.5f, 0.5f,-0.5f,
@@ -101,6 +142,52 @@ float cubeVertices[] = {
      0.5f, 0.5f, 0.5f, -0.5f, 0.5f, 0.5f, -0.5f, 0.5f,-0.5f
 };
 
+// per-instance data for the instanced cube draws (see instanced_color.vs)
+struct CubeInstance
+{
+    glm::vec3 position;
+    glm::vec3 scale;
+    glm::vec3 color;
+};
+
+// one instanced draw of the unit cube: its own VAO sharing cubeVBO, plus a
+// streaming instance buffer sized for the largest population it will hold
+struct CubeInstanceBatch
+{
+    unsigned int VAO = 0;
+    unsigned int instanceVBO = 0;
+    unsigned int capacity = 0;
+    std::vector<CubeInstance> instances; // reserved to capacity, filled per frame
+};
+
+CubeInstanceBatch bulletBatch;
+
+const glm::vec3 BULLET_SCALE = glm::vec3(0.06f);            // small bullet
+const glm::vec3 BULLET_COLOR = glm::vec3(1.0f, 0.8f, 0.2f);  // yellowish
+
+// enemies are rifle soldiers drawn from the baked clips (see crowd_animation.h)
+CrowdAnimationTexture crowdClips;
+CrowdRenderer crowdRenderer;
+unsigned int crowdSize = 0;            // extra enemies spawned at startup, --crowd
+const float CROWD_SPAWN_RANGE = 20.0f; // they spawn within +-range on x/z
+const float FLOW_CELL_SIZE = 0.5f;     // flow field resolution for target navigation
+const float FLOW_STEP_HEIGHT = 0.5f;   // level boxes no taller than this (crates) do not block targets
+
+// --cpu-crowd: skin enemies on the CPU, one palette upload and draw each,
+// through the animation LOD system (see anim_lod.h) instead of the baked texture
+bool cpuCrowd = false;
+const float LOD_BONE_MIN_SHARE = 0.01f; // far LODs skip nodes moving less than 1% of the skin
+const float ENEMY_RADIUS = 1.0f;        // bounding sphere around TARGET_CENTER_OFFSET, for culling
+
+// enemy placement: at p, facing the player
+glm::mat4 enemyTransform(const glm::vec3& p, const glm::vec3& focus, const glm::vec3& scale)
+{
+    glm::vec3 toPlayer = focus - p;
+    glm::mat4 m = glm::translate(glm::mat4(1.0f), p);
+    m = glm::rotate(m, std::atan2(toPlayer.x, toPlayer.z), glm::vec3(0, 1, 0));
+    return glm::scale(m, scale);
+}
+
 void initCube() {
     glGenVertexArrays(1, &cubeVAO);
     glGenBuffers(1, &cubeVBO);
@@ -114,8 +201,163 @@ void initCube() {
     glBindVertexArray(0);
 }
 
-int main()
+// needs initCube() first
+void initCubeInstanceBatch(CubeInstanceBatch& batch, unsigned int capacity)
 {
+    batch.capacity = capacity;
+    batch.instances.reserve(capacity);
+
+    glGenVertexArrays(1, &batch.VAO);
+    glGenBuffers(1, &batch.instanceVBO);
+
+    glBindVertexArray(batch.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, batch.instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(CubeInstance), NULL, GL_STREAM_DRAW);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(CubeInstance), (void*)offsetof(CubeInstance, position));
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(CubeInstance), (void*)offsetof(CubeInstance, scale));
+    glVertexAttribDivisor(2, 1);
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(CubeInstance), (void*)offsetof(CubeInstance, color));
+    glVertexAttribDivisor(3, 1);
+    glBindVertexArray(0);
+}
+
+// upload batch.instances (orphaning last frame's storage) and draw them all in one call
+void drawCubeInstanceBatch(CubeInstanceBatch& batch)
+{
+    GLsizei count = (GLsizei)batch.instances.size();
+    if (count == 0)
+        return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, batch.instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, batch.capacity * sizeof(CubeInstance), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(CubeInstance), batch.instances.data());
+
+    glBindVertexArray(batch.VAO);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 36, count);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && std::strcmp(argv[1], "--collision-stress") == 0)
+        return runCollisionStress();
+    if (argc > 1 && std::strcmp(argv[1], "--tick-rate-check") == 0)
+        return runTickRateCheck();
+    if (argc > 1 && std::strcmp(argv[1], "--bench") == 0)
+        return runSimulationBench(argc, argv);
+    if (argc > 1 && std::strcmp(argv[1], "--scaling-bench") == 0)
+        return runScalingBench(argc, argv);
+    if (argc > 1 && std::strcmp(argv[1], "--flow-bench") == 0)
+        return runFlowBench(argc, argv);
+    if (argc > 1 && std::strcmp(argv[1], "--anim-bench") == 0)
+        return runClipSamplerBench(argc, argv, CLIP_FILES, CLIP_COUNT);
+    if (argc > 1 && std::strcmp(argv[1], "--bake-clips") == 0)
+        return runClipBake(CLIP_CACHE_FILE, CLIP_FILES, CLIP_COUNT);
+    const bool crowdBench = argc > 1 && std::strcmp(argv[1], "--crowd-bench") == 0;
+    const auto startupBegin = std::chrono::steady_clock::now();
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--rebake-clips") == 0)
+            rebakeClips = true;
+        else if (std::strcmp(argv[i], "--cpu-crowd") == 0)
+            cpuCrowd = true;
+        else if (std::strcmp(argv[i], "--no-uniform-cache") == 0)
+            uniformStats().caching = false; // look up and send every uniform every call, for comparison
+    }
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--seed") == 0)
+            simSeed = (uint32_t)std::strtoul(argv[i + 1], nullptr, 10);
+        else if (std::strcmp(argv[i], "--sim-hz") == 0 && std::atof(argv[i + 1]) > 0.0)
+            simRate = (float)std::atof(argv[i + 1]);
+        else if (std::strcmp(argv[i], "--level") == 0)
+            levelPath = argv[i + 1];
+        else if (std::strcmp(argv[i], "--crowd") == 0)
+            crowdSize = (unsigned int)std::strtoul(argv[i + 1], nullptr, 10);
+        else if (std::strcmp(argv[i], "--workers") == 0)
+            simWorkers = (unsigned int)std::strtoul(argv[i + 1], nullptr, 10);
+    }
+
+    // --record FILE / --replay FILE [--headless]: see input_replay.h. A replay
+    // takes the seed and tick rate from the log and runs the simulation ticks
+    // on the render thread, on the recorded timeline. It refuses a different
+    // crowd or level and reports a different worker count or crowd path.
+    const InputOptions inputOptions = parseInputOptions(argc, argv);
+    InputReplay replay;
+    InputRecorder recorder;
+    InputScenario scenario;
+    scenario.Add("crowd", crowdSize).Add("level", levelPath).Add("workers", simWorkers).Add("cpu-crowd", cpuCrowd ? 1 : 0);
+    const bool replaying = !inputOptions.replayPath.empty();
+    if (replaying)
+    {
+        if (!replay.Load(inputOptions.replayPath) || !replay.MatchesScenario(scenario, { "workers", "cpu-crowd" }))
+            return -1;
+        simSeed = replay.Seed();
+        if (replay.Step() > 0.0f)
+            simRate = 1.0f / replay.Step();
+    }
+    if (!inputOptions.recordPath.empty() && !recorder.Open(inputOptions.recordPath, simSeed, 1.0f / simRate, scenario))
+        return -1;
+    sim.rng.seed(simSeed);
+    const float simStep = 1.0f / simRate;
+    unsigned long long replayTicks = 0;
+
+    if (!loadLevel(levelPath, levelBoxes))
+    {
+        std::cout << "Using the built-in arena" << std::endl;
+        levelBoxes = defaultArena();
+    }
+    // bullets stop at the level geometry
+    for (const StaticBox& box : levelBoxes)
+        sim.walls.push_back({ box.center - 0.5f * box.size, box.center + 0.5f * box.size });
+    // targets find their way around them on a flow field spanning the level and the crowd spawn area
+    glm::vec3 fieldLo(-CROWD_SPAWN_RANGE - 1.0f), fieldHi(CROWD_SPAWN_RANGE + 1.0f);
+    for (const Aabb& wall : sim.walls)
+    {
+        fieldLo = glm::min(fieldLo, wall.min);
+        fieldHi = glm::max(fieldHi, wall.max);
+    }
+    sim.steering.field.Init(fieldLo, fieldHi, FLOW_CELL_SIZE, sim.walls, HIT_DISTANCE, FLOW_STEP_HEIGHT, TARGET_HEIGHT);
+    // the first field is built in full, so the starting crowd only spawns where it can reach the player
+    sim.steering.field.Update(sim.characterPosition);
+
+    // without a window: the simulation and the camera it aims with, no animation or drawing
+    if (replaying && inputOptions.headless)
+    {
+        for (unsigned int i = 0; i < crowdSize && sim.targets.Size() < sim.targets.Capacity(); ++i)
+            spawnTarget(sim, CROWD_SPAWN_RANGE);
+        JobSystem jobs(simWorkers);
+        sim.jobs = &jobs;
+
+        FrameTimeStats stats;
+        InputFrame input;
+        while (replay.Next(input))
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            processInput(input);
+            for (unsigned int n = replayStepsDue(input.time, simStep, replayTicks); n > 0; --n, ++replayTicks)
+            {
+                SimInput tickInput = simInput;
+                tickInput.fire = pendingShots > 0;
+                if (pendingShots > 0)
+                    --pendingShots;
+                stepSimulation(sim, tickInput, simStep);
+            }
+            const float alpha = glm::clamp((input.time - replayTicks * simStep) / simStep, 0.0f, 1.0f);
+            updateCamera(glm::mix(sim.prevCharacterPosition, sim.characterPosition, alpha));
+            stats.Add(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+        }
+        stats.Print(simHash());
+        return 0;
+    }
+
     // glfw init + callbacks
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -124,6 +366,8 @@ int main()
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
+    if (crowdBench)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Third-Person Character Control", NULL, NULL);
     if (!window) { std::cout << "Failed to create window\n"; glfwTerminate(); return -1; }
@@ -139,224 +383,306 @@ int main()
 
     // shaders
     Shader skinnedShader("anim_model.vs", "anim_model.fs");
-    Shader platformShader("single_color.vs", "single_color.fs");
-
-    // load model + animations
-    Model ourModel(FileSystem::getPath("resources/objects/gun/rifle.dae"));
-    Animation idleAnim(FileSystem::getPath("resources/objects/gun/rifle_idle.dae"), &ourModel);
-    Animation runForwardAnim(FileSystem::getPath("resources/objects/gun/run_forward.dae"), &ourModel);
-    Animation runBackAnim(FileSystem::getPath("resources/objects/gun/run_back.dae"), &ourModel);
-    Animation runLeftAnim(FileSystem::getPath("resources/objects/gun/run_left.dae"), &ourModel);
-    Animation runRightAnim(FileSystem::getPath("resources/objects/gun/run_right.dae"), &ourModel);
-    Animation runForwardLeftAnim(FileSystem::getPath("resources/objects/gun/run_forward_left.dae"), &ourModel);
-    Animation runForwardRightAnim(FileSystem::getPath("resources/objects/gun/run_forward_right.dae"), &ourModel);
-    Animation runBackLeftAnim(FileSystem::getPath("resources/objects/gun/run_back_left.dae"), &ourModel);
-    Animation runBackRightAnim(FileSystem::getPath("resources/objects/gun/run_back_right.dae"), &ourModel);
-
-    idleAnimPtr = &idleAnim;
-    runForwardPtr = &runForwardAnim;
-    runBackPtr = &runBackAnim;
-    runLeftPtr = &runLeftAnim;
-    runRightPtr = &runRightAnim;
-    runForwardLeftPtr = &runForwardLeftAnim;
-    runForwardRightPtr = &runForwardRightAnim;
-    runBackLeftPtr = &runBackLeftAnim;
-    runBackRightPtr = &runBackRightAnim;
-
-    Animator animator(&idleAnim);
+    Shader levelShader("vertex_color.vs", "color.fs");
+    Shader instancedShader("instanced_color.vs", "color.fs");
+    // per-draw uniforms go through reflected handles instead of name lookups
+    ReflectedShader skinned(skinnedShader.ID);
+    SkinnedUniforms skinnedU;
+    skinnedU.Find(skinned);
+    ModelSamplers skinnedSamplers;
+    skinnedSamplers.Find(skinned);
+
+    // camera matrices and time, written once per frame for all three programs
+    FrameConstantsBuffer frameConstants;
+    frameConstants.Attach(skinnedShader.ID);
+    frameConstants.Attach(levelShader.ID);
+    frameConstants.Attach(instancedShader.ID);
+
+    // bone palette uniform buffer, filled by the animator every frame
+    BonePaletteBuffer bonePalette;
+    bonePalette.Attach(skinnedShader);
+
+    // load model + animations as a job graph: clip files are read on worker
+    // threads while the model (whose constructor needs GL) loads on this one
+    auto loadBegin = std::chrono::steady_clock::now();
+    std::vector<std::string> clipSources;
+    for (int i = 0; i < CLIP_COUNT; ++i)
+        clipSources.push_back(FileSystem::getPath(CLIP_FILES[i]));
+
+    std::unique_ptr<Model> ourModel;
+    ClipCache clipCache; // owns the mapping the clips read from; must outlive them
+    Skeleton skeleton;
+    SkeletonClip clips[CLIP_COUNT];
+    Skeleton clipHierarchies[CLIP_COUNT];
+
+    AssetLoader loader;
+    loader.OnProgress([&](int done, int total, const std::string& name) {
+        std::string title = "Loading " + std::to_string(done) + "/" + std::to_string(total) + ": " + name;
+        glfwSetWindowTitle(window, title.c_str());
+    });
+    int modelJob = loader.Add("rifle.dae", nullptr, [&]() {
+        ourModel.reset(new Model(FileSystem::getPath("resources/objects/gun/rifle.dae")));
+        return true;
+    });
+
+    // clips come from the baked cache when it is up to date, otherwise from
+    // assimp (one job per file), and the cache is rebuilt for next time
+    int clipsJob;
+    bool clipsFromCache = !rebakeClips && clipCache.Open(CLIP_CACHE_FILE, clipSources);
+    if (clipsFromCache)
+        clipsJob = loader.Add(CLIP_CACHE_FILE, [&]() { return clipCache.Load(skeleton, clips); }, nullptr);
+    else
+    {
+        std::vector<int> clipJobs;
+        for (int i = 0; i < CLIP_COUNT; ++i)
+            clipJobs.push_back(loader.Add(CLIP_FILES[i], [&, i]() {
+                if (!loadClipWithAssimp(clipSources[i], clipHierarchies[i], clips[i]))
+                    return false;
+                reduceClipKeys(&clips[i], 1);
+                return true;
+            }, nullptr));
+        clipsJob = loader.Add(std::string("bake ") + CLIP_CACHE_FILE, [&]() {
+            for (int i = 1; i < CLIP_COUNT; ++i)
+                if (!clipHierarchies[0].SameHierarchy(clipHierarchies[i]))
+                {
+                    std::cout << "Animation hierarchy does not match the skeleton: " << clipSources[i] << std::endl;
+                    return false;
+                }
+            skeleton = clipHierarchies[0];
+            bakeClipCache(CLIP_CACHE_FILE, clipSources, skeleton, clips);
+            return true;
+        }, nullptr, clipJobs);
+    }
+    int bindJob = loader.Add("bind skeleton", nullptr, [&]() {
+        skeleton.BindBones(ourModel->GetBoneInfoMap());
+        return true;
+    }, { modelJob, clipsJob });
+    GLint maxTextureSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    loader.Add("crowd animation texture",
+        [&]() { return crowdClips.Bake(skeleton, clips, CLIP_COUNT, maxTextureSize); },
+        [&]() { crowdClips.Upload(); return true; }, { bindJob });
+
+    if (!loader.Run())
+        return -1;
+    loader.PrintTimings();
+    glfwSetWindowTitle(window, "Third-Person Character Control");
+    auto assetsLoaded = std::chrono::steady_clock::now();
+
+    idleAnimPtr = &clips[CLIP_IDLE];
+    runForwardPtr = &clips[CLIP_FORWARD];
+    runBackPtr = &clips[CLIP_BACK];
+    runLeftPtr = &clips[CLIP_LEFT];
+    runRightPtr = &clips[CLIP_RIGHT];
+    runForwardLeftPtr = &clips[CLIP_FORWARD_LEFT];
+    runForwardRightPtr = &clips[CLIP_FORWARD_RIGHT];
+    runBackLeftPtr = &clips[CLIP_BACK_LEFT];
+    runBackRightPtr = &clips[CLIP_BACK_RIGHT];
+
+    SkinnedAnimator animator(&skeleton, idleAnimPtr);
     animatorPtr = &animator;
     animator.PlayAnimation(idleAnimPtr);
     currentAnimPtr = idleAnimPtr;
 
     initCube();
+    levelBatch.Build(levelBoxes);
+    initCubeInstanceBatch(bulletBatch, MAX_BULLETS);
+    crowdRenderer.Init(*ourModel, MAX_TARGETS);
+
+    if (crowdBench)
+    {
+        int result = runCrowdBench(argc, argv, *ourModel, skinnedShader, bonePalette, skeleton, clips, CLIP_COUNT,
+                                   crowdClips, crowdRenderer);
+        glfwTerminate();
+        return result;
+    }
+    for (unsigned int i = 0; i < crowdSize && sim.targets.Size() < sim.targets.Capacity(); ++i)
+        spawnTarget(sim, CROWD_SPAWN_RANGE);
+
+    AnimLodSystem animLod(&skeleton, clips, CLIP_COUNT, MAX_TARGETS);
+    animLod.SetReducedMask(lodNodeMask(skeleton, *ourModel, LOD_BONE_MIN_SHARE));
+    std::vector<AnimLodCharacter> lodCharacters;
+    float lastStatsTitle = 0.0f;
+
+    // --- Game logic: spawning, bullets, target chase, hits ---
+    // runs at a fixed rate on its own thread and publishes a snapshot per tick;
+    // the entity passes inside a tick are spread over the job system
+    JobSystem simJobs(simWorkers);
+    sim.jobs = &simJobs;
+    SnapshotExchange<ShooterSnapshot> snapshots;
+    captureSnapshot(sim, snapshots.WriteSlot());
+    snapshots.Publish();
+    snapshots.Acquire();
+
+    auto tick = [&](float dt) {
+        SimInput input;
+        {
+            std::lock_guard<std::mutex> lock(simInputMutex);
+            input = simInput;
+            input.fire = pendingShots > 0;
+            if (pendingShots > 0)
+                --pendingShots;
+        }
+        stepSimulation(sim, input, dt);
+        captureSnapshot(sim, snapshots.WriteSlot());
+        snapshots.Publish();
+    };
+    FixedStepThread simThread(1.0 / simRate, tick);
+    if (!replaying)
+        simThread.Start();
+
+    auto ms = [](std::chrono::steady_clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    std::cout << "Startup: assets " << ms(assetsLoaded - loadBegin) << " ms (clips from "
+              << (clipsFromCache ? "mapped cache" : "assimp, cache rebuilt") << "), total "
+              << ms(std::chrono::steady_clock::now() - startupBegin) << " ms" << std::endl;
 
     // render loop
+    FrameTimeStats replayStats;
+    unsigned long long frames = 0;
+    uniformStats().Reset();
+    auto frameStart = std::chrono::steady_clock::now();
     while (!glfwWindowShouldClose(window))
     {
-        float currentFrame = glfwGetTime();
+        InputFrame input;
+        if (!replaying)
+            input = pollInput(window);
+        else if (!replay.Next(input))
+            break;
+        recorder.Record(input);
+
+        float currentFrame = input.time;
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
-        processInput(window);
-        updateCamera();
-        animator.UpdateAnimation(deltaTime);
-
-        // --- Target spawn logic ---
-        timeSinceLastSpawn += deltaTime;
-        if (timeSinceLastSpawn >= SPAWN_INTERVAL)
-        {
-            timeSinceLastSpawn = 0.0f;
-
-            // spawn target far from player
-            float range = 4.0f; // outer spawn range
-            glm::vec3 pos;
-            do {
-                pos = glm::vec3(
-                    (rand() % 100 / 100.0f - 0.5f) * 2.0f * range,
-                    0.1f,
-                    (rand() % 100 / 100.0f - 0.5f) * 2.0f * range
-                );
-            } while (glm::length(pos - characterPosition) < 2.5f); // not too close
-
-            Target t;
-            t.position = pos;
-            t.speed = TARGET_SPEED;
-            targets.push_back(t);
-        }
-
-        // Update bullets
-        for (int i = 0; i < bullets.size(); )
-        {
-            bullets[i].position += bullets[i].direction * bullets[i].speed * deltaTime;
-            bullets[i].life -= deltaTime;
-
-            if (bullets[i].life <= 0.0f)
-                bullets.erase(bullets.begin() + i);
-            else
-                ++i;
-        }
-
-        // --- Update targets (move toward player) ---
-        for (auto& t : targets)
-        {
-            glm::vec3 dir = glm::normalize(characterPosition - t.position);
-            t.position += dir * t.speed * deltaTime;
-        }
-
-        // --- Bullet-target collision detection ---
-        for (int i = 0; i < bullets.size(); )
+        processInput(input);
+        if (replaying)
+            for (unsigned int n = replayStepsDue(input.time, simStep, replayTicks); n > 0; --n, ++replayTicks)
+                tick(simStep);
+
+        // draw between the last two simulation ticks
+        snapshots.Acquire();
+        const ShooterSnapshot& snap = snapshots.ReadSlot();
+        const float alpha = replaying
+            ? glm::clamp((input.time - replayTicks * simStep) / simStep, 0.0f, 1.0f)
+            : snapshots.InterpolationAlpha(simThread.StepSeconds());
+        const glm::vec3 characterPosition = glm::mix(snap.prevCharacterPosition, snap.characterPosition, alpha);
+
+        updateCamera(characterPosition);
+        if (glm::mat4* palette = bonePalette.Map())
         {
-            bool bulletRemoved = false;
-
-            for (int j = 0; j < targets.size(); )
-            {
-                glm::vec3 targetCenter = targets[j].position + glm::vec3(0.0f, 0.75f, 0.0f); // half of Y-scale
-                float dist = glm::length(bullets[i].position - targetCenter);
-
-                if (dist < HIT_DISTANCE)
-                {
-                    bullets.erase(bullets.begin() + i);
-                    targets.erase(targets.begin() + j);
-                    bulletRemoved = true;
-                    break;
-                }
-                else
-                {
-                    ++j;
-                }
-            }
-
-            if (!bulletRemoved)
-                ++i;
+            animator.UpdateAnimation(deltaTime, palette);
+            bonePalette.Unmap();
         }
 
-
         // render
         glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
         glm::mat4 view = camera.GetViewMatrix();
+        frameConstants.Update(view, projection, camera.Position, currentFrame);
 
         skinnedShader.use();
-        skinnedShader.setMat4("projection", projection);
-        skinnedShader.setMat4("view", view);
-
-        auto transforms = animator.GetFinalBoneMatrices();
-        for (int i = 0; i < (int)transforms.size(); ++i)
-            skinnedShader.setMat4("finalBonesMatrices[" + std::to_string(i) + "]", transforms[i]);
 
         // model transform
         glm::mat4 model = glm::mat4(1.0f);
         model = glm::translate(model, characterPosition);
         model = glm::rotate(model, glm::radians(characterYaw + 180.0f), glm::vec3(0, 1, 0));
         model = glm::scale(model, characterScale);
-        skinnedShader.setMat4("model", model);
-
-        ourModel.Draw(skinnedShader);
-
-        platformShader.use();
-        platformShader.setMat4("projection", projection);
-        platformShader.setMat4("view", view);
-
-        // platform
-        platformShader.setVec3("color", glm::vec3(0.4f, 0.4f, 0.4f));
-        glm::mat4 m = glm::mat4(1.0f);
-        m = glm::scale(m, glm::vec3(10.0f, 0.2f, 10.0f));
-        platformShader.setMat4("model", m);
-        glBindVertexArray(cubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-        // walls
-        platformShader.setVec3("color", glm::vec3(0.2f, 0.2f, 0.2f));
-
-        // back wall
-        m = glm::mat4(1.0f);
-        m = glm::translate(m, glm::vec3(0.0f, 1.0f, -5.0f));
-        m = glm::scale(m, glm::vec3(10.0f, 2.0f, 0.2f));
-        platformShader.setMat4("model", m);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-        // front
-        m = glm::mat4(1.0f);
-        m = glm::translate(m, glm::vec3(0.0f, 1.0f, 5.0f));
-        m = glm::scale(m, glm::vec3(10.0f, 2.0f, 0.2f));
-        platformShader.setMat4("model", m);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-        // left
-        m = glm::mat4(1.0f);
-        m = glm::translate(m, glm::vec3(-5.0f, 1.0f, 0.0f));
-        m = glm::scale(m, glm::vec3(0.2f, 2.0f, 10.0f));
-        platformShader.setMat4("model", m);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-        // right
-        m = glm::mat4(1.0f);
-        m = glm::translate(m, glm::vec3(5.0f, 1.0f, 0.0f));
-        m = glm::scale(m, glm::vec3(0.2f, 2.0f, 10.0f));
-        platformShader.setMat4("model", m);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-        platformShader.use();
-        platformShader.setMat4("projection", projection);
-        platformShader.setMat4("view", view);
-        platformShader.setVec3("color", glm::vec3(1.0f, 0.8f, 0.2f)); // yellowish
-
-        for (auto& bullet : bullets)
+        skinned.Set(skinnedU.model, model);
+        skinned.Set(skinnedU.crowd, false);
+
+        drawModel(*ourModel, skinned, skinnedSamplers);
+
+        // --- Draw enemies ---
+        // they run at the player, each at its own point of the cycle
+        const float runSeconds = crowdClips.ClipSeconds(CLIP_FORWARD);
+        if (cpuCrowd)
         {
-            glm::mat4 m = glm::mat4(1.0f);
-            m = glm::translate(m, bullet.position);
-            m = glm::scale(m, glm::vec3(0.06f)); // small bullet
-            platformShader.setMat4("model", m);
-            glBindVertexArray(cubeVAO);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-        }
+            // CPU skinning, thinned out by distance and visibility
+            Frustum frustum;
+            frustum.Extract(projection * view);
+            lodCharacters.clear();
+            for (unsigned int j = 0; j < snap.targetCount; ++j)
+            {
+                glm::vec3 p = glm::mix(snap.targetPrev[j], snap.targetCurr[j], alpha);
+                lodCharacters.push_back({ snap.targetHandle[j].slot, CLIP_FORWARD, currentFrame + snap.targetPhase[j] * runSeconds,
+                                          glm::length(p - camera.Position), frustum.SphereVisible(p + TARGET_CENTER_OFFSET, ENEMY_RADIUS),
+                                          snap.targetHandle[j].generation });
+            }
+            animLod.Update(lodCharacters.data(), (unsigned int)lodCharacters.size());
 
-        // --- Draw targets ---
-        platformShader.use();
-        platformShader.setVec3("color", glm::vec3(0.9f, 0.1f, 0.1f)); // red enemies
+            for (unsigned int j = 0; j < snap.targetCount; ++j)
+            {
+                if (!lodCharacters[j].visible)
+                    continue;
+                if (glm::mat4* palette = bonePalette.Map())
+                {
+                    std::memcpy(palette, animLod.Palette(j), MAX_BONES * sizeof(glm::mat4));
+                    bonePalette.Unmap();
+                }
+                glm::vec3 p = glm::mix(snap.targetPrev[j], snap.targetCurr[j], alpha);
+                skinned.Set(skinnedU.model, enemyTransform(p, characterPosition, characterScale));
+                drawModel(*ourModel, skinned, skinnedSamplers);
+            }
 
-        for (auto& t : targets)
+            if (currentFrame - lastStatsTitle > 0.5f)
+            {
+                const AnimLodStats& st = animLod.Stats();
+                std::string title = "Third-Person Character Control | poses: " + std::to_string(st.evaluated) + " evaluated, "
+                    + std::to_string(st.shared) + " shared, " + std::to_string(st.skipped) + " skipped";
+                glfwSetWindowTitle(window, title.c_str());
+                lastStatsTitle = currentFrame;
+            }
+        }
+        else
         {
-            glm::mat4 m = glm::mat4(1.0f);
-            m = glm::translate(m, t.position);
-            m = glm::scale(m, glm::vec3(0.3f, 1.5f, 0.3f)); // target size
-            platformShader.setMat4("model", m);
-            glBindVertexArray(cubeVAO);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+            // every soldier in one instanced call per mesh
+            crowdRenderer.instances.clear();
+            for (unsigned int j = 0; j < snap.targetCount; ++j)
+            {
+                glm::vec3 p = glm::mix(snap.targetPrev[j], snap.targetCurr[j], alpha);
+                crowdRenderer.instances.push_back({ enemyTransform(p, characterPosition, characterScale),
+                                                    glm::vec2((float)CLIP_FORWARD, snap.targetPhase[j] * runSeconds) });
+            }
+            skinned.Set(skinnedU.crowd, true);
+            crowdClips.Bind(skinned, skinnedU);
+            crowdRenderer.Draw(skinned, skinnedSamplers);
         }
 
+        // static level: one draw for the floor, walls and every prop
+        levelShader.use();
+        levelBatch.Draw();
+
+        // --- Draw bullets: one instanced call ---
+        bulletBatch.instances.clear();
+        for (unsigned int i = 0; i < snap.bulletCount; ++i)
+            bulletBatch.instances.push_back({ glm::mix(snap.bulletPrev[i], snap.bulletCurr[i], alpha), BULLET_SCALE, BULLET_COLOR });
+
+        instancedShader.use();
+        drawCubeInstanceBatch(bulletBatch);
+
         glfwSwapBuffers(window);
         glfwPollEvents();
+
+        auto frameEnd = std::chrono::steady_clock::now();
+        if (replaying)
+            replayStats.Add(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+        frameStart = frameEnd;
+        ++frames;
     }
 
+    simThread.Stop();
+    uniformStats().Print(frames);
+    if (replaying)
+        replayStats.Print(simHash());
+    recorder.Close();
     glfwTerminate();
     return 0;
 }
 
 // Update camera position to follow character
-void updateCamera()
+void updateCamera(const glm::vec3& focus)
 {
     characterYaw = cameraYaw;
 
@@ -370,10 +696,10 @@ void updateCamera()
     offset.y = CAMERA_HEIGHT + CAMERA_DISTANCE * sin(pitchRad);
     offset.z = CAMERA_DISTANCE * cos(yawRad) * cos(pitchRad);
 
-    camera.Position = characterPosition + offset;
+    camera.Position = focus + offset;
 
     // Make camera look at character (slightly above center)
-    glm::vec3 lookAtPoint = characterPosition + glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 lookAtPoint = focus + glm::vec3(0.0f, 1.0f, 0.0f);
     glm::vec3 direction = glm::normalize(lookAtPoint - camera.Position);
 
     // Update camera's front vector
@@ -382,41 +708,66 @@ void updateCamera()
     camera.Up = glm::normalize(glm::cross(camera.Right, camera.Front));
 }
 
-void processInput(GLFWwindow* window)
+// this frame's keys plus the mouse movement gathered since the last poll
+InputFrame pollInput(GLFWwindow* window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
+    InputFrame input = pendingInput;
+    pendingInput = InputFrame();
+    input.time = (float)glfwGetTime();
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) input.keys |= INPUT_KEY_W;
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) input.keys |= INPUT_KEY_S;
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) input.keys |= INPUT_KEY_A;
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) input.keys |= INPUT_KEY_D;
+    if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS) input.keys |= INPUT_KEY_J;
+    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) input.keys |= INPUT_MOUSE_LEFT;
+    return input;
+}
+
+void processInput(const InputFrame& input)
+{
+    // Rotate camera (not character)
+    float xoffset = input.mouseX * MOUSE_SENSITIVITY;
+    float yoffset = input.mouseY * MOUSE_SENSITIVITY;
+    characterYaw -= xoffset;
+    cameraYaw -= xoffset;
+    cameraPitch += yoffset;
+
+    if (cameraPitch > 45.0f)
+        cameraPitch = 45.0f;
+    if (cameraPitch < -45.0f)
+        cameraPitch = -45.0f;
+
+    if (input.scroll != 0.0f)
+        camera.ProcessMouseScroll(input.scroll);
+
     float yawRad = glm::radians(cameraYaw);
     glm::vec3 camForward = glm::normalize(glm::vec3(-sin(yawRad), 0.0f, -cos(yawRad)));
     glm::vec3 camRight = glm::normalize(glm::vec3(cos(yawRad), 0.0f, -sin(yawRad)));
 
     glm::vec3 moveDir(0.0f);
 
-    bool w = glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS;
-    bool s = glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS;
-    bool a = glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS;
-    bool d = glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS;
+    bool w = (input.keys & INPUT_KEY_W) != 0;
+    bool s = (input.keys & INPUT_KEY_S) != 0;
+    bool a = (input.keys & INPUT_KEY_A) != 0;
+    bool d = (input.keys & INPUT_KEY_D) != 0;
 
     if (w) moveDir += camForward;
     if (s) moveDir -= camForward;
     if (a) moveDir -= camRight;
     if (d) moveDir += camRight;
 
+    // movement itself happens in stepSimulation, which also keeps the player within the area
     bool moving = glm::length(moveDir) > 0.01f;
-    if (moving)
     {
-        moveDir = glm::normalize(moveDir);
-        characterPosition += moveDir * CHARACTER_SPEED * deltaTime;
+        std::lock_guard<std::mutex> lock(simInputMutex);
+        simInput.moveDir = moving ? glm::normalize(moveDir) : glm::vec3(0.0f);
     }
 
-    // Keep within area
-    float limit = 4.5f;
-    characterPosition.x = glm::clamp(characterPosition.x, -limit, limit);
-    characterPosition.z = glm::clamp(characterPosition.z, -limit, limit);
-
     // Pick the right animation
-    Animation* newAnim = idleAnimPtr;
+    const SkeletonClip* newAnim = idleAnimPtr;
     if (moving)
     {
         if (w && a && !s && !d)
@@ -439,8 +790,8 @@ void processInput(GLFWwindow* window)
             newAnim = runForwardPtr; // fallback
     }
 
-    // Switch animation only if changed
-    if (newAnim != currentAnimPtr)
+    // Switch animation only if changed (there is no animator in a headless replay)
+    if (newAnim != currentAnimPtr && animatorPtr)
     {
         currentAnimPtr = newAnim;
         animatorPtr->PlayAnimation(newAnim);
@@ -448,27 +799,40 @@ void processInput(GLFWwindow* window)
 
     // Shooting (press J or Left Mouse)
     static bool shootPressedLastFrame = false;
-    bool jPressed = glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS;
-    bool mousePressed = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
-    bool shootPressed = jPressed || mousePressed;
+    bool shootPressed = (input.keys & (INPUT_KEY_J | INPUT_MOUSE_LEFT)) != 0;
 
     if (shootPressed && !shootPressedLastFrame)
     {
         // Aim where the camera looks
         glm::vec3 forward = glm::normalize(glm::vec3(camera.Front.x, camera.Front.y, camera.Front.z));
 
-        Bullet bullet;
-        bullet.position = characterPosition + glm::vec3(-0.1f, 0.8f, 0.0f);
-        bullet.direction = forward;
-        bullet.speed = BULLET_SPEED;
-        bullet.life = BULLET_LIFETIME;
-        bullets.push_back(bullet);
+        std::lock_guard<std::mutex> lock(simInputMutex);
+        simInput.aimDir = forward;
+        ++pendingShots;
     }
 
     shootPressedLastFrame = shootPressed;
 
 }
 
+// simulation state plus the camera that aims the shots
+uint64_t simHash()
+{
+    StateHash hash;
+    hash.Add(sim.tick);
+    hash.Add(sim.characterPosition);
+    hash.Add(sim.totalHits);
+    hash.Add(sim.totalWallHits);
+    hash.Add(sim.bullets.Size());
+    hash.AddBytes(sim.bullets.position.data(), sim.bullets.Size() * sizeof(glm::vec3));
+    hash.Add(sim.targets.Size());
+    hash.AddBytes(sim.targets.position.data(), sim.targets.Size() * sizeof(glm::vec3));
+    hash.Add(cameraYaw);
+    hash.Add(cameraPitch);
+    hash.Add(camera.Zoom);
+    return hash.Value();
+}
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     glViewport(0, 0, width, height);
@@ -483,26 +847,14 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
         firstMouse = false;
     }
 
-    float xoffset = xpos - lastX;
-    float yoffset = ypos - lastY;
+    // applied in processInput
+    pendingInput.mouseX += xpos - lastX;
+    pendingInput.mouseY += ypos - lastY;
     lastX = xpos;
     lastY = ypos;
-
-    xoffset *= MOUSE_SENSITIVITY;
-    yoffset *= MOUSE_SENSITIVITY;
-
-    // Rotate camera (not character)
-    characterYaw -= xoffset;
-    cameraYaw -= xoffset;
-    cameraPitch += yoffset;
-
-    if (cameraPitch > 45.0f)
-        cameraPitch = 45.0f;
-    if (cameraPitch < -45.0f)
-        cameraPitch = -45.0f;
 }
 
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
-    camera.ProcessMouseScroll(yoffset);
+    pendingInput.scroll += (float)yoffset;
 }
\ No newline at end of file
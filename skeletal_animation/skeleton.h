@@ -0,0 +1,133 @@
+// skeleton.h
+// Bone hierarchy flattened into arrays, shared by every clip of a model.
+//
+// The assimp node tree is walked once at load time in pre-order, so every
+// node comes after its parent. Evaluating a pose is then one linear pass:
+//
+//     global[i] = global[parent[i]] * local[i]
+//
+// with no recursion and no name lookups. Names are kept only so clips and the
+// model's bone map can be matched against the skeleton when they are loaded.
+
+#ifndef SKELETON_H
+#define SKELETON_H
+
+#include <glm/glm.hpp>
+
+#include <assimp/scene.h>
+
+#include <learnopengl/animdata.h>
+#include <learnopengl/assimp_glm_helpers.h>
+
+#include "bone_palette.h"
+#include "clip_sampler.h"
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+class Skeleton
+{
+public:
+    std::vector<int> parent;          // -1 for the root, otherwise a smaller index
+    std::vector<glm::mat4> bindLocal; // node transform used when a clip has no channel for it
+    std::vector<std::string> name;
+
+    // filled by BindBones
+    std::vector<int> boneId;          // palette slot, -1 for nodes that do not skin anything
+    std::vector<glm::mat4> boneOffset;
+    std::vector<int> unusedPaletteSlots; // palette slots no node writes; filled with identity
+
+    unsigned int NodeCount() const { return (unsigned int)parent.size(); }
+
+    // Flatten an assimp node tree.
+    void Build(const aiNode* root)
+    {
+        parent.clear();
+        bindLocal.clear();
+        name.clear();
+        addNode(root, -1);
+    }
+
+    // Map nodes to palette slots by name, using the model's bone map (the ids
+    // the mesh vertices were skinned with).
+    void BindBones(const std::map<std::string, BoneInfo>& boneInfoMap)
+    {
+        boneId.assign(NodeCount(), -1);
+        boneOffset.assign(NodeCount(), glm::mat4(1.0f));
+        std::vector<char> written(MAX_BONES, 0);
+        for (unsigned int i = 0; i < NodeCount(); ++i)
+        {
+            auto it = boneInfoMap.find(name[i]);
+            if (it != boneInfoMap.end() && it->second.id >= 0 && it->second.id < MAX_BONES)
+            {
+                boneId[i] = it->second.id;
+                boneOffset[i] = it->second.offset;
+                written[it->second.id] = 1;
+            }
+        }
+
+        unusedPaletteSlots.clear();
+        for (int i = 0; i < MAX_BONES; ++i)
+            if (!written[i])
+                unusedPaletteSlots.push_back(i);
+    }
+
+    // True if other has the same nodes in the same order, so clips bound to
+    // one can be played on the other.
+    bool SameHierarchy(const Skeleton& other) const
+    {
+        return parent == other.parent && name == other.name;
+    }
+
+private:
+    void addNode(const aiNode* node, int parentIndex)
+    {
+        int index = (int)parent.size();
+        parent.push_back(parentIndex);
+        bindLocal.push_back(AssimpGLMHelpers::ConvertMatrixToGLMFormat(node->mTransformation));
+        name.push_back(node->mName.C_Str());
+
+        for (unsigned int i = 0; i < node->mNumChildren; i++)
+            addNode(node->mChildren[i], index);
+    }
+};
+
+// One animation clip bound to a skeleton: the clip's keyframe tracks and,
+// for each node, the channel that animates it. Names are matched once here so
+// playback never searches for bones.
+class SkeletonClip
+{
+public:
+    ClipTracks tracks;
+    std::vector<int> channel; // per skeleton node, -1 where the clip does not animate it
+
+    // Take the first animation of scene. Returns false if the scene has none
+    // or its node tree does not match the skeleton.
+    bool Build(const Skeleton& skeleton, const aiScene* scene)
+    {
+        if (!scene || !scene->mRootNode || scene->mNumAnimations == 0)
+            return false;
+        tracks.Load(scene->mAnimations[0]);
+        channel.assign(skeleton.NodeCount(), -1);
+
+        unsigned int next = 0;
+        return matchNode(skeleton, scene->mRootNode, next) && next == skeleton.NodeCount();
+    }
+
+private:
+    bool matchNode(const Skeleton& skeleton, const aiNode* node, unsigned int& next)
+    {
+        if (next >= skeleton.NodeCount() || skeleton.name[next] != node->mName.C_Str())
+            return false;
+        channel[next++] = tracks.FindChannel(node->mName.C_Str());
+
+        for (unsigned int i = 0; i < node->mNumChildren; i++)
+            if (!matchNode(skeleton, node->mChildren[i], next))
+                return false;
+        return true;
+    }
+};
+
+#endif
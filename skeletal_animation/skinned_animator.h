@@ -0,0 +1,111 @@
+// skinned_animator.h
+// Drop-in replacement for learnopengl's Animator that writes the final bone
+// matrices into caller-provided storage (normally the mapped bone palette
+// uniform buffer) instead of keeping its own vector and handing out copies.
+//
+// Poses are evaluated over a flattened Skeleton (see skeleton.h): the clip is
+// sampled for all channels at once (see clip_sampler.h), then one linear pass
+// over parent-ordered nodes builds the palette. No recursion, no bone lookups
+// by name.
+
+#ifndef SKINNED_ANIMATOR_H
+#define SKINNED_ANIMATOR_H
+
+#include <glm/glm.hpp>
+
+#include "bone_palette.h"
+#include "skeleton.h"
+
+#include <vector>
+#include <cmath>
+
+class SkinnedAnimator
+{
+public:
+    SkinnedAnimator(const Skeleton* skeleton, const SkeletonClip* clip)
+        : m_Skeleton(skeleton), m_GlobalTransforms(skeleton->NodeCount())
+    {
+        m_CurrentTime = 0.0f;
+        m_CurrentClip = clip;
+        if (clip)
+            m_Playback.Reset(clip->tracks);
+    }
+
+    void PlayAnimation(const SkeletonClip* clip)
+    {
+        m_CurrentClip = clip;
+        m_CurrentTime = 0.0f;
+        if (clip)
+            m_Playback.Reset(clip->tracks);
+    }
+
+    // Advance the current clip by dt seconds and write MAX_BONES final bone
+    // matrices to palette.
+    void UpdateAnimation(float dt, glm::mat4* palette)
+    {
+        m_DeltaTime = dt;
+        if (!m_CurrentClip)
+        {
+            writeIdentity(palette);
+            return;
+        }
+
+        const ClipTracks& tracks = m_CurrentClip->tracks;
+        m_CurrentTime += tracks.ticksPerSecond * dt;
+        m_CurrentTime = fmod(m_CurrentTime, tracks.duration);
+        EvaluateAt(m_CurrentTime, palette);
+    }
+
+    // Write the current clip's pose at time (in ticks) to palette without
+    // advancing playback. Sampling forward in time is cheapest; see findKey.
+    // Nodes with a zero in nodeMask keep their bind pose (see anim_lod.h).
+    void EvaluateAt(float time, glm::mat4* palette, const char* nodeMask = nullptr)
+    {
+        if (!m_CurrentClip)
+        {
+            writeIdentity(palette);
+            return;
+        }
+        m_CurrentClip->tracks.Sample(time, m_Playback);
+
+        const Skeleton& skeleton = *m_Skeleton;
+        const int* channel = m_CurrentClip->channel.data();
+        const unsigned int nodeCount = skeleton.NodeCount();
+
+        // parents always come before their children
+        for (unsigned int i = 0; i < nodeCount; ++i)
+        {
+            int c = channel[i];
+            bool animated = c >= 0 && (!nodeMask || nodeMask[i]);
+            glm::mat4 local = animated ? composeTransform(m_Playback.pose, (unsigned int)c) : skeleton.bindLocal[i];
+
+            int p = skeleton.parent[i];
+            m_GlobalTransforms[i] = p < 0 ? local : m_GlobalTransforms[p] * local;
+
+            int id = skeleton.boneId[i];
+            if (id >= 0)
+                palette[id] = m_GlobalTransforms[i] * skeleton.boneOffset[i];
+        }
+
+        // the buffer is mapped with invalidate, so slots no node owns still need a value
+        for (int id : skeleton.unusedPaletteSlots)
+            palette[id] = glm::mat4(1.0f);
+    }
+
+private:
+    const Skeleton* m_Skeleton;
+    const SkeletonClip* m_CurrentClip;
+    std::vector<glm::mat4> m_GlobalTransforms;
+    ClipPlayback m_Playback;
+    float m_CurrentTime;
+    float m_DeltaTime;
+
+    // No clip: the mapped palette was invalidated, so fill it with the bind pose.
+    static void writeIdentity(glm::mat4* palette)
+    {
+        for (int i = 0; i < MAX_BONES; ++i)
+            palette[i] = glm::mat4(1.0f);
+    }
+};
+
+#endif
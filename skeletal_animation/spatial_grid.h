@@ -0,0 +1,148 @@
+// spatial_grid.h
+// Uniform grid on the XZ plane, stored as a spatial hash so the arena size never
+// has to be known up front. Used as the broadphase for bullet/target hits:
+// Query for points, QueryBox for the area a bullet swept during a tick.
+//
+// The grid is rebuilt from scratch every tick with a counting sort (count ->
+// prefix sum -> scatter), so after the first few frames it never allocates:
+// all arrays keep their capacity between rebuilds.
+
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+class SpatialGrid
+{
+public:
+    // cellSize should be >= the largest query radius so that the 3x3
+    // neighbourhood around a point is enough to find every overlap.
+    explicit SpatialGrid(float cellSize, unsigned int bucketCount = 4096)
+        : cellSize(cellSize), invCellSize(1.0f / cellSize), bucketMask(roundUpPow2(bucketCount) - 1)
+    {
+        bucketStart.assign(bucketMask + 2, 0);
+    }
+
+    float GetCellSize() const { return cellSize; }
+
+    // Rebuild from count items; positionOf(i) returns the position of item i
+    // and i is the id later reported by Query.
+    template <typename PositionFn>
+    void Build(unsigned int count, PositionFn&& positionOf)
+    {
+        // grow the table with the population so buckets stay short
+        unsigned int wanted = roundUpPow2(count > 64 ? count : 64);
+        if (wanted - 1 > bucketMask)
+        {
+            bucketMask = wanted - 1;
+            bucketStart.assign(bucketMask + 2, 0);
+        }
+        else
+        {
+            std::fill(bucketStart.begin(), bucketStart.end(), 0u);
+        }
+
+        itemBucket.resize(count);
+        entries.resize(count);
+
+        // count
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            glm::vec3 p = positionOf(i);
+            unsigned int b = bucketOf(cellX(p.x), cellZ(p.z));
+            itemBucket[i] = b;
+            ++bucketStart[b + 1];
+        }
+        // prefix sum
+        for (unsigned int b = 1; b < bucketStart.size(); ++b)
+            bucketStart[b] += bucketStart[b - 1];
+        // scatter, using a copy of the bucket starts as write cursors
+        cursor.assign(bucketStart.begin(), bucketStart.end() - 1);
+        for (unsigned int i = 0; i < count; ++i)
+            entries[cursor[itemBucket[i]]++] = i;
+    }
+
+    // Calls fn(id) for every item stored in the 3x3 cells around p. Hash
+    // collisions can report extra items, so callers still do the exact test.
+    template <typename Fn>
+    void Query(const glm::vec3& p, Fn&& fn) const
+    {
+        int cx = cellX(p.x);
+        int cz = cellZ(p.z);
+        unsigned int visited[9];
+        int nVisited = 0;
+        for (int dz = -1; dz <= 1; ++dz)
+        {
+            for (int dx = -1; dx <= 1; ++dx)
+            {
+                unsigned int b = bucketOf(cx + dx, cz + dz);
+                // two neighbouring cells may hash into the same bucket
+                bool seen = false;
+                for (int k = 0; k < nVisited; ++k)
+                    if (visited[k] == b) { seen = true; break; }
+                if (seen)
+                    continue;
+                visited[nVisited++] = b;
+
+                for (unsigned int e = bucketStart[b]; e < bucketStart[b + 1]; ++e)
+                    fn(entries[e]);
+            }
+        }
+    }
+
+    // Calls fn(id) for every item stored in the cells overlapping the XZ
+    // rectangle [lo, hi]. Cells that hash into the same bucket report its
+    // items more than once, so fn must tolerate repeats.
+    template <typename Fn>
+    void QueryBox(const glm::vec3& lo, const glm::vec3& hi, Fn&& fn) const
+    {
+        int x0 = cellX(lo.x), x1 = cellX(hi.x);
+        int z0 = cellZ(lo.z), z1 = cellZ(hi.z);
+        for (int cz = z0; cz <= z1; ++cz)
+            for (int cx = x0; cx <= x1; ++cx)
+            {
+                unsigned int b = bucketOf(cx, cz);
+                for (unsigned int e = bucketStart[b]; e < bucketStart[b + 1]; ++e)
+                    fn(entries[e]);
+            }
+    }
+
+    // Item ids of the last Build in bucket order: items that are close
+    // together come out close together, so a pass that walks them in this
+    // order and queries around each one keeps hitting the same buckets.
+    unsigned int ItemAt(unsigned int e) const { return entries[e]; }
+
+private:
+    float cellSize;
+    float invCellSize;
+    unsigned int bucketMask;
+
+    std::vector<unsigned int> bucketStart; // bucketMask + 2 entries, prefix sums
+    std::vector<unsigned int> cursor;
+    std::vector<unsigned int> itemBucket;
+    std::vector<unsigned int> entries;     // item ids sorted by bucket
+
+    int cellX(float x) const { return (int)std::floor(x * invCellSize); }
+    int cellZ(float z) const { return (int)std::floor(z * invCellSize); }
+
+    unsigned int bucketOf(int cx, int cz) const
+    {
+        // large primes from Teschner et al. 2003, "Optimized Spatial Hashing"
+        uint32_t h = ((uint32_t)cx * 73856093u) ^ ((uint32_t)cz * 19349663u);
+        return h & bucketMask;
+    }
+
+    static unsigned int roundUpPow2(unsigned int v)
+    {
+        unsigned int p = 1;
+        while (p < v) p <<= 1;
+        return p;
+    }
+};
+
+#endif
@@ -0,0 +1,174 @@
+// static_batch.h
+// Level geometry that never moves, merged into one indexed vertex buffer.
+//
+// A level is a list of axis-aligned boxes. At load time every box is
+// pre-transformed into world space and its colour is baked into the vertices,
+// so drawing the whole static level is a single glDrawElements with no
+// per-object uniforms.
+//
+// Level files are plain text, one box per line, '#' starts a comment:
+//
+//     box  center.x center.y center.z  size.x size.y size.z  r g b
+
+#ifndef STATIC_BATCH_H
+#define STATIC_BATCH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct StaticBox
+{
+    glm::vec3 center;
+    glm::vec3 size;
+    glm::vec3 color;
+};
+
+// The arena the demo shipped with: a floor and four walls.
+inline std::vector<StaticBox> defaultArena()
+{
+    const glm::vec3 floorColor(0.4f, 0.4f, 0.4f);
+    const glm::vec3 wallColor(0.2f, 0.2f, 0.2f);
+    return {
+        { glm::vec3(0.0f, 0.0f, 0.0f),  glm::vec3(10.0f, 0.2f, 10.0f), floorColor }, // platform
+        { glm::vec3(0.0f, 1.0f, -5.0f), glm::vec3(10.0f, 2.0f, 0.2f),  wallColor },  // back wall
+        { glm::vec3(0.0f, 1.0f, 5.0f),  glm::vec3(10.0f, 2.0f, 0.2f),  wallColor },  // front
+        { glm::vec3(-5.0f, 1.0f, 0.0f), glm::vec3(0.2f, 2.0f, 10.0f),  wallColor },  // left
+        { glm::vec3(5.0f, 1.0f, 0.0f),  glm::vec3(0.2f, 2.0f, 10.0f),  wallColor },  // right
+    };
+}
+
+// Parse a level file into boxes. Returns false (and leaves boxes untouched)
+// if the file cannot be opened or contains a malformed line.
+inline bool loadLevel(const std::string& path, std::vector<StaticBox>& boxes)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cout << "Level file not found: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<StaticBox> loaded;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        ++lineNumber;
+        std::string::size_type hash = line.find('#');
+        if (hash != std::string::npos)
+            line.erase(hash);
+
+        std::istringstream in(line);
+        std::string kind;
+        if (!(in >> kind))
+            continue; // blank or comment-only line
+
+        StaticBox b;
+        if (kind != "box" ||
+            !(in >> b.center.x >> b.center.y >> b.center.z >> b.size.x >> b.size.y >> b.size.z >> b.color.r >> b.color.g >> b.color.b))
+        {
+            std::cout << "Level parse error at " << path << ":" << lineNumber << std::endl;
+            return false;
+        }
+        loaded.push_back(b);
+    }
+
+    boxes.swap(loaded);
+    return true;
+}
+
+class StaticBatch
+{
+public:
+    unsigned int VAO = 0;
+
+    // Bake the boxes into one vertex/index buffer pair. Vertex layout:
+    // location 0 = world position, location 1 = colour.
+    void Build(const std::vector<StaticBox>& boxes)
+    {
+        // 8 corners and 12 triangles per box; flat colour needs no per-face vertices
+        static const unsigned int boxIndices[36] = {
+            0, 1, 2, 2, 3, 0, // -z
+            4, 6, 5, 6, 4, 7, // +z
+            0, 3, 7, 7, 4, 0, // -x
+            1, 5, 6, 6, 2, 1, // +x
+            0, 4, 5, 5, 1, 0, // -y
+            3, 2, 6, 6, 7, 3  // +y
+        };
+
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        vertices.reserve(boxes.size() * 8 * 6);
+        indices.reserve(boxes.size() * 36);
+
+        for (const StaticBox& b : boxes)
+        {
+            unsigned int base = (unsigned int)(vertices.size() / 6);
+            glm::vec3 h = b.size * 0.5f;
+            for (int c = 0; c < 8; ++c)
+            {
+                // corner order: bottom face (-y) then top face (+y), each -z side first
+                float sx = (c == 1 || c == 2 || c == 5 || c == 6) ? 1.0f : -1.0f;
+                float sy = (c == 2 || c == 3 || c == 6 || c == 7) ? 1.0f : -1.0f;
+                float sz = (c >= 4) ? 1.0f : -1.0f;
+                vertices.push_back(b.center.x + sx * h.x);
+                vertices.push_back(b.center.y + sy * h.y);
+                vertices.push_back(b.center.z + sz * h.z);
+                vertices.push_back(b.color.r);
+                vertices.push_back(b.color.g);
+                vertices.push_back(b.color.b);
+            }
+            for (unsigned int k = 0; k < 36; ++k)
+                indices.push_back(base + boxIndices[k]);
+        }
+        indexCount = (GLsizei)indices.size();
+
+        if (VAO == 0)
+        {
+            glGenVertexArrays(1, &VAO);
+            glGenBuffers(1, &VBO);
+            glGenBuffers(1, &EBO);
+        }
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+        glBindVertexArray(0);
+    }
+
+    void Draw() const
+    {
+        if (indexCount == 0)
+            return;
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+    }
+
+    void Delete()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        VAO = VBO = EBO = 0;
+        indexCount = 0;
+    }
+
+private:
+    unsigned int VBO = 0;
+    unsigned int EBO = 0;
+    GLsizei indexCount = 0;
+};
+
+#endif
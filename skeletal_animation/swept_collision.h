@@ -0,0 +1,108 @@
+// swept_collision.h
+// Segment tests for projectiles: where along its path during one tick a
+// bullet first touches a shape, as a fraction t in [0, 1] of the tick.
+//
+// Testing the whole path instead of the end position means a hit can no
+// longer be stepped over, however far a bullet moves per tick, so the
+// simulation rate can drop without losing hits. A segment that starts inside
+// a shape reports t = 0.
+
+#ifndef SWEPT_COLLISION_H
+#define SWEPT_COLLISION_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+struct Aabb
+{
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+// Segment p0 -> p1 against a sphere.
+inline bool segmentSphere(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& center, float radius, float& t)
+{
+    glm::vec3 d = p1 - p0;
+    glm::vec3 m = p0 - center;
+    float c = glm::dot(m, m) - radius * radius;
+    if (c <= 0.0f)
+    {
+        t = 0.0f;
+        return true;
+    }
+    float a = glm::dot(d, d);
+    float b = glm::dot(m, d);
+    if (a <= 0.0f || b >= 0.0f) // not moving, or moving away
+        return false;
+    float disc = b * b - a * c;
+    if (disc < 0.0f)
+        return false;
+    t = (-b - std::sqrt(disc)) / a;
+    return t <= 1.0f;
+}
+
+// Segment p0 -> p1 against an upright capsule: the points within radius of
+// the vertical axis from (base.x, base.y + yMin, base.z) to (.., base.y + yMax, ..).
+// The capsule is the union of its side cylinder and two end spheres, so the
+// first contact is the earliest of the three.
+inline bool segmentCapsuleY(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& base,
+                            float yMin, float yMax, float radius, float& t)
+{
+    float best = 2.0f, s;
+    if (segmentSphere(p0, p1, base + glm::vec3(0.0f, yMin, 0.0f), radius, s)) best = std::min(best, s);
+    if (segmentSphere(p0, p1, base + glm::vec3(0.0f, yMax, 0.0f), radius, s)) best = std::min(best, s);
+
+    // side: circle test on XZ, then the height at the contact
+    float mx = p0.x - base.x, mz = p0.z - base.z;
+    float dx = p1.x - p0.x, dz = p1.z - p0.z;
+    float c = mx * mx + mz * mz - radius * radius;
+    float a = dx * dx + dz * dz;
+    float b = mx * dx + mz * dz;
+    if (c <= 0.0f)
+        s = 0.0f;
+    else if (a > 0.0f && b < 0.0f && b * b - a * c >= 0.0f)
+        s = (-b - std::sqrt(b * b - a * c)) / a;
+    else
+        s = 2.0f;
+    if (s <= 1.0f)
+    {
+        float y = p0.y + (p1.y - p0.y) * s - base.y;
+        if (y >= yMin && y <= yMax)
+            best = std::min(best, s);
+    }
+
+    if (best > 1.0f)
+        return false;
+    t = best;
+    return true;
+}
+
+// Segment p0 -> p1 against an axis-aligned box (slab test).
+inline bool segmentAabb(const glm::vec3& p0, const glm::vec3& p1, const Aabb& box, float& t)
+{
+    float tMin = 0.0f, tMax = 1.0f;
+    glm::vec3 d = p1 - p0;
+    for (int i = 0; i < 3; ++i)
+    {
+        if (std::fabs(d[i]) < 1e-8f)
+        {
+            if (p0[i] < box.min[i] || p0[i] > box.max[i])
+                return false;
+            continue;
+        }
+        float inv = 1.0f / d[i];
+        float t0 = (box.min[i] - p0[i]) * inv;
+        float t1 = (box.max[i] - p0[i]) * inv;
+        if (t0 > t1) std::swap(t0, t1);
+        tMin = std::max(tMin, t0);
+        tMax = std::min(tMax, t1);
+        if (tMin > tMax)
+            return false;
+    }
+    t = tMin;
+    return true;
+}
+
+#endif
@@ -0,0 +1,20 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;   // already in world space
+layout (location = 1) in vec3 aColor;
+
+// per-frame constants from common/frame_constants.h; this stage reads viewProjection
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 cameraPosition;
+    float time;
+};
+
+out vec3 Color;
+
+void main() {
+    Color = aColor;
+    gl_Position = viewProjection * vec4(aPos, 1.0);
+}